@@ -0,0 +1,91 @@
+/*
+ * bench_ci.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Times createInstance() requests for an instance with many numeric
+ *  properties. With CIM_HOST_PORT set to a port no CIMOM listens on,
+ *  the calls fail right after the request has been generated, so the
+ *  time reported is mostly request generation.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define NUM_PROPS	1000
+#define NUM_ITERS	200
+
+int main()
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*objectpath, *objectpath_r;
+    CMPIInstance	*instance;
+    CMPIStatus		status;
+    struct timeval	tvs, tve;
+    char		name[32];
+    char		*cim_host, *cim_host_port;
+    char		*cim_host_passwd, *cim_host_userid;
+    double		usecs;
+    int			i;
+
+    /* Setup a connection to the CIMOM */
+    cim_host = getenv("CIM_HOST");
+    if (cim_host == NULL)
+	cim_host = "localhost";
+    cim_host_port = getenv("CIM_HOST_PORT");
+    if (cim_host_port == NULL)
+	cim_host_port = "5988";
+    cim_host_userid = getenv("CIM_HOST_USERID");
+    if (cim_host_userid == NULL)
+	cim_host_userid = "root";
+    cim_host_passwd = getenv("CIM_HOST_PASSWD");
+    if (cim_host_passwd == NULL)
+	cim_host_passwd = "password";
+    cc = cmciConnect(cim_host, NULL, cim_host_port,
+			       cim_host_userid, cim_host_passwd, NULL);
+
+    objectpath = newCMPIObjectPath("root/cimv2", "CWS_Authorization", NULL);
+    instance = newCMPIInstance(objectpath, NULL);
+    for (i = 0; i < NUM_PROPS; i++) {
+	CMPIUint64 u64 = 1000003ULL * i;
+	CMPISint32 s32 = -7 * i;
+	CMPIReal64 r64 = i / 4.0;
+
+	sprintf(name, "U64_%d", i);
+	CMSetProperty(instance, name, &u64, CMPI_uint64);
+	sprintf(name, "S32_%d", i);
+	CMSetProperty(instance, name, &s32, CMPI_sint32);
+	sprintf(name, "R64_%d", i);
+	CMSetProperty(instance, name, &r64, CMPI_real64);
+    }
+
+    printf("createInstance() with %d properties, %d calls ...\n",
+	   3 * NUM_PROPS, NUM_ITERS);
+
+    gettimeofday(&tvs, NULL);
+    for (i = 0; i < NUM_ITERS; i++) {
+	objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &status);
+	if (objectpath_r) CMRelease(objectpath_r);
+	if (status.msg) CMRelease(status.msg);
+    }
+    gettimeofday(&tve, NULL);
+
+    usecs = (tve.tv_sec - tvs.tv_sec) * 1e6 + (tve.tv_usec - tvs.tv_usec);
+    printf("last rc=%d, %.1f usecs per call\n", status.rc, usecs / NUM_ITERS);
+
+    CMRelease(instance);
+    CMRelease(objectpath);
+    CMRelease(cc);
+
+    return 0;
+}
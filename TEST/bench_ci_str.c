@@ -0,0 +1,129 @@
+/*
+ * bench_ci_str.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Times createInstance() requests for instances with large string
+ *  properties, once with plain text, once with text that is mostly
+ *  markup to be escaped, and for an instance with a large octet string
+ *  (uint8 array). As with bench_ci, set CIM_HOST_PORT to a port no
+ *  CIMOM listens on to time mostly request generation.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define NUM_PROPS	16
+#define STRING_SIZE	65536
+#define OCTETS		65536
+#define NUM_ITERS	50
+
+static void run(CMCIClient *cc, CMPIObjectPath *objectpath,
+		CMPIInstance *instance, const char *what)
+{
+    CMPIObjectPath	*objectpath_r;
+    CMPIStatus		status;
+    struct timeval	tvs, tve;
+    double		usecs;
+    int			i;
+
+    gettimeofday(&tvs, NULL);
+    for (i = 0; i < NUM_ITERS; i++) {
+	objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &status);
+	if (objectpath_r) CMRelease(objectpath_r);
+	if (status.msg) CMRelease(status.msg);
+    }
+    gettimeofday(&tve, NULL);
+
+    usecs = (tve.tv_sec - tvs.tv_sec) * 1e6 + (tve.tv_usec - tvs.tv_usec);
+    printf("%-16s last rc=%d, %.1f usecs per call\n", what, status.rc,
+	   usecs / NUM_ITERS);
+}
+
+static CMPIInstance *stringInstance(CMPIObjectPath *objectpath,
+				    const char *pattern)
+{
+    CMPIInstance	*instance = newCMPIInstance(objectpath, NULL);
+    char		*value = malloc(STRING_SIZE + 1);
+    char		name[32];
+    int			i, l = strlen(pattern);
+
+    for (i = 0; i < STRING_SIZE; i++)
+	value[i] = pattern[i % l];
+    value[STRING_SIZE] = 0;
+    for (i = 0; i < NUM_PROPS; i++) {
+	sprintf(name, "S_%d", i);
+	CMSetProperty(instance, name, value, CMPI_chars);
+    }
+    free(value);
+    return instance;
+}
+
+int main()
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*objectpath;
+    CMPIInstance	*instance;
+    CMPIArray		*octets;
+    char		*cim_host, *cim_host_port;
+    char		*cim_host_passwd, *cim_host_userid;
+    int			i;
+
+    /* Setup a connection to the CIMOM */
+    cim_host = getenv("CIM_HOST");
+    if (cim_host == NULL)
+	cim_host = "localhost";
+    cim_host_port = getenv("CIM_HOST_PORT");
+    if (cim_host_port == NULL)
+	cim_host_port = "5988";
+    cim_host_userid = getenv("CIM_HOST_USERID");
+    if (cim_host_userid == NULL)
+	cim_host_userid = "root";
+    cim_host_passwd = getenv("CIM_HOST_PASSWD");
+    if (cim_host_passwd == NULL)
+	cim_host_passwd = "password";
+    cc = cmciConnect(cim_host, NULL, cim_host_port,
+			       cim_host_userid, cim_host_passwd, NULL);
+
+    objectpath = newCMPIObjectPath("root/cimv2", "CWS_Authorization", NULL);
+    CMAddKey(objectpath, "Username", "<user & \"co\">", CMPI_chars);
+
+    printf("createInstance() with %d strings of %d bytes or %d octets,"
+	   " %d calls ...\n", NUM_PROPS, STRING_SIZE, OCTETS, NUM_ITERS);
+
+    instance = stringInstance(objectpath,
+			      "The quick brown fox jumps over the lazy dog. ");
+    run(cc, objectpath, instance, "plain strings");
+    CMRelease(instance);
+
+    instance = stringInstance(objectpath, "<a href=\"x&y\">'</a>");
+    run(cc, objectpath, instance, "markup strings");
+    CMRelease(instance);
+
+    instance = newCMPIInstance(objectpath, NULL);
+    octets = newCMPIArray(OCTETS, CMPI_uint8, NULL);
+    for (i = 0; i < OCTETS; i++) {
+	CMPIUint8 u8 = i * 7;
+	CMSetArrayElementAt(octets, i, &u8, CMPI_uint8);
+    }
+    CMSetProperty(instance, "Octets", &octets, CMPI_uint8A);
+    CMRelease(octets);
+    run(cc, objectpath, instance, "octet string");
+    CMRelease(instance);
+
+    CMRelease(objectpath);
+    CMRelease(cc);
+
+    return 0;
+}
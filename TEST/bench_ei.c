@@ -0,0 +1,120 @@
+/*
+ * bench_ei.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Times enumInstances() of the class given as argument, by default
+ *  CIM_ManagedElement, and the release of the enumeration, once with
+ *  the objects allocated one by one and once with CMPI_FLAG_ArenaResult.
+ *  A clone of the first instance must outlive the arena enumeration.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define NUM_ITERS	10
+
+static double usecsSince(struct timeval *tvs)
+{
+    struct timeval	tve;
+
+    gettimeofday(&tve, NULL);
+    return (tve.tv_sec - tvs->tv_sec) * 1e6 + (tve.tv_usec - tvs->tv_usec);
+}
+
+static void run(CMCIClient *cc, CMPIObjectPath *objectpath, CMPIFlags flags,
+		const char *what)
+{
+    CMPIEnumeration	*enm;
+    CMPIInstance	*clone = NULL;
+    CMPIStatus		status;
+    struct timeval	tvs;
+    double		enumerate = 0, release = 0;
+    int			count = 0, i;
+
+    for (i = 0; i < NUM_ITERS; i++) {
+	gettimeofday(&tvs, NULL);
+	enm = cc->ft->enumInstances(cc, objectpath,
+				    flags | CMPI_FLAG_DeepInheritance,
+				    NULL, &status);
+	enumerate += usecsSince(&tvs);
+	if (enm == NULL) {
+	    printf("%-8s rc=%d %s\n", what, status.rc,
+		   status.msg ? CMGetCharPtr(status.msg) : "");
+	    if (status.msg) CMRelease(status.msg);
+	    return;
+	}
+
+	count = CMGetArrayCount(CMToArray(enm, NULL), NULL);
+	if (clone == NULL && CMHasNext(enm, NULL)) {
+	    CMPIInstance *instance = CMGetNext(enm, NULL).value.inst;
+
+	    clone = CMClone(instance, NULL);
+	}
+
+	gettimeofday(&tvs, NULL);
+	CMRelease(enm);
+	release += usecsSince(&tvs);
+    }
+
+    printf("%-8s %d instances, enumerate %.1f msecs, release %.2f msecs\n",
+	   what, count, enumerate / NUM_ITERS / 1000,
+	   release / NUM_ITERS / 1000);
+
+    if (clone) {
+	CMPIObjectPath *path = CMGetObjectPath(clone, NULL);
+	CMPIString *str = CMObjectPathToString(path, NULL);
+
+	printf("%-8s clone of %s has %d properties\n", what,
+	       CMGetCharPtr(str), CMGetPropertyCount(clone, NULL));
+	CMRelease(str);
+	CMRelease(path);
+	CMRelease(clone);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*objectpath;
+    char		*cim_host, *cim_host_port;
+    char		*cim_host_passwd, *cim_host_userid;
+
+    /* Setup a connection to the CIMOM */
+    cim_host = getenv("CIM_HOST");
+    if (cim_host == NULL)
+	cim_host = "localhost";
+    cim_host_port = getenv("CIM_HOST_PORT");
+    if (cim_host_port == NULL)
+	cim_host_port = "5988";
+    cim_host_userid = getenv("CIM_HOST_USERID");
+    if (cim_host_userid == NULL)
+	cim_host_userid = "root";
+    cim_host_passwd = getenv("CIM_HOST_PASSWD");
+    if (cim_host_passwd == NULL)
+	cim_host_passwd = "password";
+    cc = cmciConnect(cim_host, NULL, cim_host_port,
+			       cim_host_userid, cim_host_passwd, NULL);
+
+    objectpath = newCMPIObjectPath("root/cimv2",
+				   argc > 1 ? argv[1] : "CIM_ManagedElement",
+				   NULL);
+
+    run(cc, objectpath, 0, "heap");
+    run(cc, objectpath, CMPI_FLAG_ArenaResult, "arena");
+
+    CMRelease(objectpath);
+    CMRelease(cc);
+
+    return 0;
+}
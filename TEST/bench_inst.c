@@ -0,0 +1,111 @@
+/*
+ * bench_inst.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Times the construction, cloning and destruction of instances with
+ *  an object path and a few properties in 1, 8 and 32 threads, once
+ *  with the per thread node caches and once with SFCC_NODE_CACHE=0,
+ *  i.e. with every node allocated from and freed to malloc. Each run is
+ *  made in a child process, as the setting is read once. No request is
+ *  sent, so no CIMOM is needed.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define NUM_PROPS	10
+#define NUM_ITERS	20000
+
+static void *build(void *arg)
+{
+    CMPIObjectPath	*objectpath;
+    CMPIInstance	*instance, *clone;
+    CMPIUint32		u32;
+    char		name[32];
+    int			i, j;
+
+    for (i = 0; i < NUM_ITERS; i++) {
+	objectpath = newCMPIObjectPath("root/cimv2", "Linux_Process", NULL);
+	CMAddKey(objectpath, "Handle", "4711", CMPI_chars);
+	instance = newCMPIInstance(objectpath, NULL);
+	for (j = 0; j < NUM_PROPS; j++) {
+	    sprintf(name, "Prop_%d", j);
+	    if (j & 1) {
+		u32 = i + j;
+		CMSetProperty(instance, name, &u32, CMPI_uint32);
+	    } else
+		CMSetProperty(instance, name, "some value", CMPI_chars);
+	}
+	clone = CMClone(instance, NULL);
+	CMSetProperty(clone, "Prop_1", &u32, CMPI_uint32);
+	CMRelease(clone);
+	CMRelease(instance);
+	CMRelease(objectpath);
+    }
+    return NULL;
+}
+
+static void run(int threads, const char *what)
+{
+    CMCIClient		*cc;
+    pthread_t		tid[32];
+    struct timeval	tvs, tve;
+    double		usecs;
+    int			i;
+
+    /* The client loads the backend that builds the objects */
+    cc = cmciConnect("localhost", NULL, "5988", NULL, NULL, NULL);
+    if (cc == NULL) {
+	printf("%-12s %2d threads: cannot load the backend\n", what, threads);
+	return;
+    }
+
+    gettimeofday(&tvs, NULL);
+    for (i = 0; i < threads; i++)
+	pthread_create(&tid[i], NULL, build, NULL);
+    for (i = 0; i < threads; i++)
+	pthread_join(tid[i], NULL);
+    gettimeofday(&tve, NULL);
+
+    usecs = (tve.tv_sec - tvs.tv_sec) * 1e6 + (tve.tv_usec - tvs.tv_usec);
+    printf("%-12s %2d threads: %.0f instances per second\n", what, threads,
+	   (double) threads * NUM_ITERS * 1e6 / usecs);
+    fflush(stdout);
+}
+
+int main()
+{
+    static const int	threads[] = { 1, 8, 32 };
+    int			i, cache;
+
+    printf("building, cloning and releasing instances with %d properties,"
+	   " %d per thread ...\n", NUM_PROPS, NUM_ITERS);
+    fflush(stdout);
+
+    for (i = 0; i < 3; i++) {
+	for (cache = 1; cache >= 0; cache--) {
+	    if (fork() == 0) {
+		if (!cache)
+		    setenv("SFCC_NODE_CACHE", "0", 1);
+		run(threads[i], cache ? "node caches" : "malloc");
+		exit(0);
+	    }
+	    wait(NULL);
+	}
+    }
+
+    return 0;
+}
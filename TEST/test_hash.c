@@ -0,0 +1,111 @@
+/*
+ * test_hash.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Test for the hashCMPIObjectPath() and sameCMPIObjectPath() library
+ *  APIs. Paths that differ only in key order or in the case of the
+ *  namespace, class and key names must be equal and hash equally, paths
+ *  with other key values, key types or keys must not be equal. No
+ *  request is sent, so no CIMOM is needed.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <stdio.h>
+
+static int failed;
+
+/* a path with string key a and uint32 key b, b added first if reversed */
+static CMPIObjectPath *path(const char *ns, const char *cn, const char *a,
+                            const char *av, const char *b, int reversed)
+{
+    CMPIObjectPath *op = newCMPIObjectPath(ns, cn, NULL);
+    CMPIUint32 u32 = 5;
+
+    if (reversed)
+        CMAddKey(op, b, &u32, CMPI_uint32);
+    CMAddKey(op, a, av, CMPI_chars);
+    if (!reversed)
+        CMAddKey(op, b, &u32, CMPI_uint32);
+    return op;
+}
+
+static void check(const char *what, CMPIObjectPath *op1, CMPIObjectPath *op2,
+                  int same)
+{
+    if (sameCMPIObjectPath(op1, op2) != same ||
+        sameCMPIObjectPath(op2, op1) != same) {
+        printf("%s: sameCMPIObjectPath() is not %d\n", what, same);
+        failed++;
+    }
+    if (same && hashCMPIObjectPath(op1) != hashCMPIObjectPath(op2)) {
+        printf("%s: hashCMPIObjectPath() differs\n", what);
+        failed++;
+    }
+}
+
+int main()
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*op, *other;
+    CMPIUint64		u64 = 5, hash;
+
+    /* The client loads the backend that builds the object paths */
+    cc = cmciConnect("localhost", NULL, "5988", NULL, NULL, NULL);
+    if (cc == NULL) {
+        printf("cannot load the backend\n");
+        return 1;
+    }
+
+    op = path("root/cimv2", "CIM_Disk", "Alpha", "x", "Beta", 0);
+
+    other = path("root/cimv2", "CIM_Disk", "Alpha", "x", "Beta", 1);
+    check("key order", op, other, 1);
+    CMRelease(other);
+
+    other = path("root/cimv2", "CIM_Disk", "alpha", "x", "BETA", 0);
+    check("key name case", op, other, 1);
+    CMRelease(other);
+
+    other = path("ROOT/CIMV2", "cim_disk", "Alpha", "x", "Beta", 0);
+    check("namespace and class name case", op, other, 1);
+    CMRelease(other);
+
+    other = path("root/cimv2", "CIM_Disk", "Alpha", "X", "Beta", 0);
+    check("key value case", op, other, 0);
+    CMRelease(other);
+
+    other = path("root/cimv2", "CIM_Disk", "Alpha", "y", "Beta", 0);
+    check("key value", op, other, 0);
+    CMRelease(other);
+
+    other = newCMPIObjectPath("root/cimv2", "CIM_Disk", NULL);
+    CMAddKey(other, "Alpha", "x", CMPI_chars);
+    check("missing key", op, other, 0);
+    CMAddKey(other, "Beta", &u64, CMPI_uint64);
+    check("key type", op, other, 0);
+    CMRelease(other);
+
+    /* the hash is recomputed once the path is modified */
+    other = path("root/cimv2", "CIM_Disk", "Alpha", "x", "Beta", 1);
+    hash = hashCMPIObjectPath(other);
+    CMAddKey(other, "Gamma", "z", CMPI_chars);
+    check("added key", op, other, 0);
+    if (hashCMPIObjectPath(other) == hash) {
+        printf("added key: hashCMPIObjectPath() unchanged\n");
+        failed++;
+    }
+    CMRelease(other);
+
+    printf("object path hash and equality: %d errors\n", failed);
+    CMRelease(op);
+    CMRelease(cc);
+    return failed != 0;
+}
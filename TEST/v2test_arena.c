@@ -0,0 +1,227 @@
+/*
+ * v2test_arena.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Modifies the instances of an enumInstances() result kept in an arena
+ *  (CMPI_FLAG_ArenaResult) from several threads: properties are changed,
+ *  added and filtered, keys, namespace and class name of references are
+ *  set. The changes must be visible, survive in clones and be released
+ *  with the enumeration, which a memory checker run verifies. A canned
+ *  response is served on ARENA_PORT (default 5997), so no CIMOM is
+ *  needed.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define INSTANCES 40
+#define THREADS   4
+
+static char response[INSTANCES * 1024 + 1024];
+static CMPIInstance *inst[INSTANCES];
+static int listenFd, failed;
+static pthread_mutex_t failedLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void buildResponse(void)
+{
+    char *s = response;
+    int i;
+
+    s += sprintf(s, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                 "<CIM CIMVERSION=\"2.0\" DTDVERSION=\"2.0\">"
+                 "<MESSAGE ID=\"4711\" PROTOCOLVERSION=\"1.0\"><SIMPLERSP>"
+                 "<IMETHODRESPONSE NAME=\"EnumerateInstances\">"
+                 "<IRETURNVALUE>\n");
+    for (i = 0; i < INSTANCES; i++)
+        s += sprintf(s, "<VALUE.NAMEDINSTANCE>"
+                     "<INSTANCENAME CLASSNAME=\"Test_Disk\">"
+                     "<KEYBINDING NAME=\"Id\"><KEYVALUE VALUETYPE=\"string\">"
+                     "d%d</KEYVALUE></KEYBINDING></INSTANCENAME>"
+                     "<INSTANCE CLASSNAME=\"Test_Disk\">"
+                     "<PROPERTY NAME=\"Id\" TYPE=\"string\"><VALUE>d%d</VALUE>"
+                     "</PROPERTY>"
+                     "<PROPERTY NAME=\"Label\" TYPE=\"string\"><VALUE>disk %d"
+                     "</VALUE></PROPERTY>"
+                     "<PROPERTY.REFERENCE NAME=\"Parent\" "
+                     "REFERENCECLASS=\"Test_Host\"><VALUE.REFERENCE>"
+                     "<INSTANCENAME CLASSNAME=\"Test_Host\">"
+                     "<KEYBINDING NAME=\"Name\"><KEYVALUE VALUETYPE=\"string\">"
+                     "h%d</KEYVALUE></KEYBINDING></INSTANCENAME>"
+                     "</VALUE.REFERENCE></PROPERTY.REFERENCE>"
+                     "</INSTANCE></VALUE.NAMEDINSTANCE>\n", i, i, i, i / 2);
+    sprintf(s, "</IRETURNVALUE></IMETHODRESPONSE></SIMPLERSP></MESSAGE>"
+            "</CIM>\n");
+}
+
+/* answers every request on a connection with the canned response */
+static void *serve(void *arg)
+{
+    char buf[8192], hdr[256], *end, *cl;
+    int fd, len, have, body;
+
+    while ((fd = accept(listenFd, NULL, NULL)) >= 0) {
+        have = 0;
+        for (;;) {
+            len = read(fd, buf + have, sizeof(buf) - 1 - have);
+            if (len <= 0)
+                break;
+            have += len;
+            buf[have] = 0;
+            if ((end = strstr(buf, "\r\n\r\n")) == NULL)
+                continue;
+            cl = strstr(buf, "Content-Length:");
+            body = cl ? atoi(cl + 15) : 0;
+            if (have < end + 4 - buf + body)
+                continue;
+            len = sprintf(hdr, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: application/xml; charset=\"utf-8\"\r\n"
+                          "CIMOperation: MethodResponse\r\n"
+                          "Content-Length: %d\r\n\r\n", (int) strlen(response));
+            if (write(fd, hdr, len) != len ||
+                write(fd, response, strlen(response)) != (int) strlen(response))
+                break;
+            have -= end + 4 - buf + body;
+            memmove(buf, end + 4 + body, have);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static void fail(int i, const char *what)
+{
+    pthread_mutex_lock(&failedLock);
+    printf("instance %d: %s\n", i, what);
+    failed++;
+    pthread_mutex_unlock(&failedLock);
+}
+
+/* checks the changes made by modify() */
+static void check(int i, CMPIInstance *ci)
+{
+    CMPIObjectPath *ref;
+    CMPIString *path;
+    CMPIData d;
+
+    d = CMGetProperty(ci, "Label", NULL);
+    if (d.type != CMPI_string || strcmp(CMGetCharPtr(d.value.string), "changed"))
+        fail(i, "Label not changed");
+    d = CMGetProperty(ci, "Extra", NULL);
+    if (d.type != CMPI_string || strcmp(CMGetCharPtr(d.value.string), "added"))
+        fail(i, "Extra not added");
+
+    ref = CMGetProperty(ci, "Parent", NULL).value.ref;
+    path = CMObjectPathToString(ref, NULL);
+    if (strncmp(CMGetCharPtr(path), "root/test:Test_Other.", 21) ||
+        strstr(CMGetCharPtr(path), "Slot=\"s\"") == NULL)
+        fail(i, "Parent not changed");
+    CMRelease(path);
+}
+
+/* changes every step-th instance from the first on */
+static void modify(int first, int step)
+{
+    char *filter[] = { "Label", "Extra", NULL };
+    CMPIObjectPath *ref;
+    int i;
+
+    for (i = first; i < INSTANCES; i += step) {
+        CMSetProperty(inst[i], "Label", "changed", CMPI_chars);
+        CMSetProperty(inst[i], "Extra", "added", CMPI_chars);
+        ref = CMGetProperty(inst[i], "Parent", NULL).value.ref;
+        CMAddKey(ref, "Slot", "s", CMPI_chars);
+        CMSetNameSpace(ref, "root/test");
+        CMSetClassName(ref, "Test_Other");
+        if (i % 3 == 0)
+            inst[i]->ft->setPropertyFilter(inst[i], filter, NULL);
+        check(i, inst[i]);
+    }
+}
+
+static void *run(void *arg)
+{
+    modify((int) (long) arg, THREADS);
+    return NULL;
+}
+
+int main()
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*op;
+    CMPIEnumeration	*enm;
+    CMPIInstance	*clone;
+    CMPIStatus		status;
+    struct sockaddr_in	sin;
+    pthread_t		server, tid[THREADS];
+    char		*port = getenv("ARENA_PORT");
+    int			i, on = 1;
+
+    if (port == NULL)
+        port = "5997";
+
+    buildResponse();
+    listenFd = socket(PF_INET, SOCK_STREAM, 0);
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(atoi(port));
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, (struct sockaddr *) &sin, sizeof(sin)) ||
+        listen(listenFd, 4)) {
+        printf("cannot listen on port %s\n", port);
+        return 1;
+    }
+    pthread_create(&server, NULL, serve, NULL);
+
+    cc = cmciConnect("localhost", NULL, port, NULL, NULL, NULL);
+    if (cc == NULL) {
+        printf("cannot load the backend\n");
+        return 1;
+    }
+    op = newCMPIObjectPath("root/cimv2", "Test_Disk", NULL);
+    enm = cc->ft->enumInstances(cc, op, CMPI_FLAG_ArenaResult, NULL, &status);
+    if (enm == NULL || status.rc) {
+        printf("enumInstances() rc=%d\n", status.rc);
+        return 1;
+    }
+    for (i = 0; CMHasNext(enm, NULL) && i < INSTANCES; i++)
+        inst[i] = CMGetNext(enm, NULL).value.inst;
+    if (i != INSTANCES) {
+        printf("%d instances returned\n", i);
+        return 1;
+    }
+
+    /* every other one here, then all of them from several threads */
+    modify(0, 2);
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&tid[i], NULL, run, (void *) (long) i);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(tid[i], NULL);
+
+    clone = CMClone(inst[1], NULL);
+    CMRelease(enm);
+    check(1, clone);
+    CMSetProperty(clone, "Label", "changed", CMPI_chars);
+    check(1, clone);
+    CMRelease(clone);
+
+    printf("%d instances modified, %d failures\n", INSTANCES, failed);
+    CMRelease(op);
+    CMRelease(cc);
+    return failed != 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * v2test_dt.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Checks CIMCDateTime conversions between the binary and the string
+ *  form against the C library: absolute times formatted in the local
+ *  time zone (set TZ to try others), strings with UTC offsets, and
+ *  intervals. Then times parsing and formatting. Needs no CIMOM.
+ */
+#include <cimc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define NUM_ITERS 1000000
+
+static CIMCEnv *ce;
+static int errors;
+
+/*
+ * The string form of secs.usecs the way strftime() formats it, into
+ * str of size bytes, which must hold at least 26.
+ */
+static void reference(time_t secs, long usecs, char *str, size_t size)
+{
+    struct tm tm;
+    long utc;
+
+    localtime_r(&secs, &tm);
+    utc = tm.tm_gmtoff / 60;
+    strftime(str, 16, "%Y%m%d%H%M%S.", &tm);
+    /* the fields are reduced to their width, as in a CIM datetime */
+    snprintf(str + 15, size - 15, "%06ld%c%03ld", usecs % 1000000,
+             utc < 0 ? '-' : '+', (utc < 0 ? -utc : utc) % 1000);
+}
+
+static void checkBinary(CIMCUint64 bin, CIMCBoolean interval,
+                        const char *expected)
+{
+    CIMCDateTime *dt, *dt2;
+    CIMCString *str;
+
+    dt = ce->ft->newDateTimeFromBinary(ce, bin, interval, NULL);
+    str = dt->ft->getStringFormat(dt, NULL);
+    if (strcmp((char *) str->hdl, expected)) {
+        printf(" %llu formatted as %s, expected %s\n",
+               (unsigned long long) bin, (char *) str->hdl, expected);
+        errors++;
+    }
+    dt2 = ce->ft->newDateTimeFromChars(ce, (char *) str->hdl, NULL);
+    if (dt2->ft->getBinaryFormat(dt2, NULL) != bin ||
+        dt2->ft->isInterval(dt2, NULL) != interval) {
+        printf(" %s parsed as %llu, expected %llu\n", (char *) str->hdl,
+               (unsigned long long) dt2->ft->getBinaryFormat(dt2, NULL),
+               (unsigned long long) bin);
+        errors++;
+    }
+    str->ft->release(str);
+    dt->ft->release(dt);
+    dt2->ft->release(dt2);
+}
+
+static void checkChars(const char *chars, CIMCUint64 expected)
+{
+    CIMCDateTime *dt = ce->ft->newDateTimeFromChars(ce, chars, NULL);
+
+    if (dt->ft->getBinaryFormat(dt, NULL) != expected) {
+        printf(" %s parsed as %llu, expected %llu\n", chars,
+               (unsigned long long) dt->ft->getBinaryFormat(dt, NULL),
+               (unsigned long long) expected);
+        errors++;
+    }
+    dt->ft->release(dt);
+}
+
+static double usecsSince(struct timeval *tvs)
+{
+    struct timeval tve;
+
+    gettimeofday(&tve, NULL);
+    return (tve.tv_sec - tvs->tv_sec) * 1e6 + (tve.tv_usec - tvs->tv_usec);
+}
+
+int main()
+{
+    CIMCDateTime *dt;
+    CIMCStatus status;
+    struct timeval tvs;
+    struct tm tm;
+    char *msg = NULL, str[32];
+    time_t secs;
+    CIMCUint64 sum = 0;
+    int rc, i;
+
+    ce = NewCIMCEnv("XML", 0, &rc, &msg);
+    if (ce == NULL) {
+        printf(" failed to load the XML interface: %s\n", msg);
+        return 1;
+    }
+
+    /* absolute times from 1970 to 2037, with odd microseconds */
+    srand(46);
+    for (i = 0; i < 100000; i++) {
+        secs = (time_t) ((double) rand() / RAND_MAX * 2145916800.0);
+        reference(secs, i % 1000000, str, sizeof(str));
+        checkBinary(secs * 1000000ULL + i % 1000000, 0, str);
+    }
+
+    /* UTC offsets are taken from the string, not from the local zone */
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 105;
+    tm.tm_mon = 4;
+    tm.tm_mday = 3;
+    tm.tm_hour = 10;
+    tm.tm_min = 43;
+    tm.tm_sec = 54;
+    secs = timegm(&tm);
+    checkChars("20050503104354.123456+000", secs * 1000000ULL + 123456);
+    checkChars("20050503104354.123456+060",
+               (secs - 3600) * 1000000ULL + 123456);
+    checkChars("20050503104354.123456-330",
+               (secs + 19800) * 1000000ULL + 123456);
+    checkChars("19700101000000.000000+000", 0);
+
+    /* intervals */
+    checkBinary(0, 1, "00000000000000.000000:000");
+    checkBinary(((((12345678ULL * 24 + 23) * 60 + 59) * 60) + 58) * 1000000ULL
+                + 999999, 1, "12345678235958.999999:000");
+    checkChars("00000001000001.000001:000", 86401000001ULL);
+
+    dt = ce->ft->newDateTimeFromChars(ce, "20050503104354.123456*000",
+                                      &status);
+    if (dt != NULL || status.rc != CIMC_RC_ERR_INVALID_PARAMETER) {
+        printf(" an invalid UTC offset sign was accepted\n");
+        errors++;
+    }
+
+    printf(" datetime conversions: %d errors\n", errors);
+
+    gettimeofday(&tvs, NULL);
+    for (i = 0; i < NUM_ITERS; i++) {
+        dt = ce->ft->newDateTimeFromChars(ce, "20050503104354.123456+060",
+                                          NULL);
+        sum += dt->ft->getBinaryFormat(dt, NULL);
+        dt->ft->release(dt);
+    }
+    printf(" newDateTimeFromChars: %.1f nsecs per call\n",
+           usecsSince(&tvs) * 1000 / NUM_ITERS);
+
+    gettimeofday(&tvs, NULL);
+    for (i = 0; i < NUM_ITERS; i++) {
+        dt = ce->ft->newDateTimeFromBinary(ce, sum + i * 1000000ULL, 0,
+                                           NULL);
+        dt->ft->release(dt);
+    }
+    printf(" newDateTimeFromBinary: %.1f nsecs per call\n",
+           usecsSince(&tvs) * 1000 / NUM_ITERS);
+
+    ce->ft->release(ce);
+
+    return errors != 0;
+}
+
+/* end */
@@ -0,0 +1,496 @@
+/*
+ * v2test_il.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Load test for the indication listener. Starts a listener on
+ *  IL_PORT (default 5999) and posts indications to it from several
+ *  sender threads, first with one connection per indication, then
+ *  reusing persistent connections. Reports how many indications were
+ *  delivered and at which rate. Repeats this with a listener on the UNIX
+ *  socket IL_SOCKET (default /tmp/v2test_il.socket). Then runs NUM_LISTENERS listeners on the
+ *  following ports side by side and checks that each one delivers what
+ *  was sent to it, also while the others are being stopped. Finally
+ *  checks that a listener on the port after those refuses malformed
+ *  requests and keeps working.
+ */
+#include <cimc.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define NUM_SENDERS	8
+#define NUM_INDICATIONS	20000
+#define NUM_LISTENERS	16
+
+static const char *indication =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<CIM CIMVERSION=\"2.0\" DTDVERSION=\"2.0\">"
+    "<MESSAGE ID=\"1\" PROTOCOLVERSION=\"1.0\"><SIMPLEEXPREQ>"
+    "<EXPMETHODCALL NAME=\"ExportIndication\">"
+    "<EXPPARAMVALUE NAME=\"NewIndication\">"
+    "<INSTANCE CLASSNAME=\"CIM_AlertIndication\">"
+    "<PROPERTY NAME=\"IndicationIdentifier\" TYPE=\"string\"><VALUE>load</VALUE></PROPERTY>"
+    "<PROPERTY NAME=\"PerceivedSeverity\" TYPE=\"uint16\"><VALUE>2</VALUE></PROPERTY>"
+    "<PROPERTY NAME=\"Description\" TYPE=\"string\"><VALUE>listener load test</VALUE></PROPERTY>"
+    "</INSTANCE></EXPPARAMVALUE></EXPMETHODCALL>"
+    "</SIMPLEEXPREQ></MESSAGE></CIM>\n";
+
+static int port;
+static char *socketPath;	/* connect here instead of port if set */
+static char request[4096];
+static int received;
+static int failed;
+
+static void indicationReceived(CIMCInstance *ind)
+{
+    __sync_fetch_and_add(&received, 1);
+    ind->ft->release(ind);
+}
+
+static int openConnection(int port)
+{
+    struct sockaddr_in sin;
+    struct sockaddr_un sunaddr;
+    int fd;
+
+    if (socketPath) {
+        fd = socket(PF_UNIX, SOCK_STREAM, 0);
+        memset(&sunaddr, 0, sizeof(sunaddr));
+        sunaddr.sun_family = AF_UNIX;
+        strncpy(sunaddr.sun_path, socketPath, sizeof(sunaddr.sun_path) - 1);
+        if (connect(fd, (struct sockaddr *) &sunaddr, sizeof(sunaddr))) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    fd = socket(PF_INET, SOCK_STREAM, 0);
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *) &sin, sizeof(sin))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Posts an indication on *fd, opening a connection if *fd is -1. Leaves
+ * *fd open if the listener keeps the connection alive.
+ */
+static int postIndication(int port, int *fd)
+{
+    char buf[512];
+    int n = 0, r, len = strlen(request);
+
+    if (*fd < 0 && (*fd = openConnection(port)) < 0) {
+        return 1;
+    }
+    if (write(*fd, request, len) != len) {
+        close(*fd);
+        *fd = -1;
+        return 1;
+    }
+    /* the response has no body */
+    while (n < sizeof(buf) - 1 &&
+           (r = read(*fd, buf + n, sizeof(buf) - 1 - n)) > 0) {
+        n += r;
+        buf[n] = 0;
+        if (strstr(buf, "\r\n\r\n")) break;
+    }
+    buf[n] = 0;
+    if (strstr(buf, "Keep-Alive") == NULL) {
+        close(*fd);
+        *fd = -1;
+    }
+    return strstr(buf, " 200 ") == NULL;
+}
+
+static void *sender(void *parm)
+{
+    int persistent = *(int *) parm;
+    int k, fd = -1;
+
+    for (k = 0; k < NUM_INDICATIONS / NUM_SENDERS; k++) {
+        if (postIndication(port, &fd)) {
+            __sync_fetch_and_add(&failed, 1);
+        }
+        if (!persistent && fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return NULL;
+}
+
+static int run(int persistent)
+{
+    pthread_t senders[NUM_SENDERS];
+    struct timeval tvs, tve;
+    double secs;
+    int k, sent = NUM_INDICATIONS / NUM_SENDERS * NUM_SENDERS;
+
+    received = failed = 0;
+    gettimeofday(&tvs, NULL);
+    for (k = 0; k < NUM_SENDERS; k++) {
+        pthread_create(&senders[k], NULL, sender, &persistent);
+    }
+    for (k = 0; k < NUM_SENDERS; k++) {
+        pthread_join(senders[k], NULL);
+    }
+    for (k = 0; k < 100 && received + failed < sent; k++) {
+        usleep(50000);
+    }
+    gettimeofday(&tve, NULL);
+
+    secs = (tve.tv_sec - tvs.tv_sec) + (tve.tv_usec - tvs.tv_usec) / 1e6;
+    printf(" %d senders, %s: %d indications sent, %d delivered, %d failed"
+           " in %.2f s (%.0f/s)\n", NUM_SENDERS,
+           persistent ? "persistent connections" : "connection per indication",
+           sent, received, failed, secs, received / secs);
+    return received != sent;
+}
+
+static int multiReceived[NUM_LISTENERS];
+
+/* one callback per listener, to tell the deliveries apart */
+#define MULTI_CALLBACK(n) \
+static void multiReceived##n(CIMCInstance *ind) \
+{ \
+    __sync_fetch_and_add(&multiReceived[n], 1); \
+    ind->ft->release(ind); \
+}
+MULTI_CALLBACK(0)  MULTI_CALLBACK(1)  MULTI_CALLBACK(2)  MULTI_CALLBACK(3)
+MULTI_CALLBACK(4)  MULTI_CALLBACK(5)  MULTI_CALLBACK(6)  MULTI_CALLBACK(7)
+MULTI_CALLBACK(8)  MULTI_CALLBACK(9)  MULTI_CALLBACK(10) MULTI_CALLBACK(11)
+MULTI_CALLBACK(12) MULTI_CALLBACK(13) MULTI_CALLBACK(14) MULTI_CALLBACK(15)
+
+static void (*multiCallbacks[NUM_LISTENERS]) (CIMCInstance *) = {
+    multiReceived0,  multiReceived1,  multiReceived2,  multiReceived3,
+    multiReceived4,  multiReceived5,  multiReceived6,  multiReceived7,
+    multiReceived8,  multiReceived9,  multiReceived10, multiReceived11,
+    multiReceived12, multiReceived13, multiReceived14, multiReceived15
+};
+
+static int multiFailed[NUM_LISTENERS];
+
+static void *multiSender(void *parm)
+{
+    int n = (int) (long) parm;
+    int k, fd = -1;
+
+    for (k = 0; k < NUM_INDICATIONS / NUM_LISTENERS; k++) {
+        if (postIndication(port + 1 + n, &fd)) {
+            multiFailed[n]++;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return NULL;
+}
+
+/*
+ * Drives NUM_LISTENERS listeners in parallel, then stops them one by
+ * one, checking after each stop that the remaining ones still deliver.
+ */
+static int runMulti(CIMCEnv *ce)
+{
+    CIMCIndicationListener *il[NUM_LISTENERS];
+    CIMCIndicationListenerStats stats;
+    CIMCStatus status;
+    pthread_t senders[NUM_LISTENERS];
+    struct timeval tvs, tve;
+    double secs;
+    int k, n, p, fd, rc = 0, sent = 0, delivered = 0;
+
+    for (n = 0; n < NUM_LISTENERS; n++) {
+        p = port + 1 + n;
+        il[n] = ce->ft->newIndicationListener(ce, 0, &p, NULL,
+                                              multiCallbacks[n], &status);
+        il[n]->ft->setOption(il[n], CIMC_IL_OPT_Workers, 2);
+        il[n]->ft->setOption(il[n], CIMC_IL_OPT_KeepAliveMax, 1000);
+        status = il[n]->ft->start(il[n]);
+        if (status.rc) {
+            printf(" failed to start listener %d on port %d: %s\n", n, p,
+                   status.msg ? (char *) status.msg->hdl : "");
+            return 1;
+        }
+    }
+
+    gettimeofday(&tvs, NULL);
+    for (n = 0; n < NUM_LISTENERS; n++) {
+        pthread_create(&senders[n], NULL, multiSender, (void *) (long) n);
+    }
+    for (n = 0; n < NUM_LISTENERS; n++) {
+        pthread_join(senders[n], NULL);
+    }
+    for (k = 0; k < 100; k++) {
+        for (n = 0; n < NUM_LISTENERS; n++) {
+            if (multiReceived[n] + multiFailed[n] <
+                NUM_INDICATIONS / NUM_LISTENERS) break;
+        }
+        if (n == NUM_LISTENERS) break;
+        usleep(50000);
+    }
+    gettimeofday(&tve, NULL);
+
+    for (n = 0; n < NUM_LISTENERS; n++) {
+        sent += NUM_INDICATIONS / NUM_LISTENERS;
+        delivered += multiReceived[n];
+        il[n]->ft->getStatistics(il[n], &stats);
+        if (multiReceived[n] != NUM_INDICATIONS / NUM_LISTENERS ||
+            stats.delivered != multiReceived[n]) {
+            printf(" listener %d delivered %d of %d\n", n, multiReceived[n],
+                   NUM_INDICATIONS / NUM_LISTENERS);
+            rc = 1;
+        }
+    }
+    secs = (tve.tv_sec - tvs.tv_sec) + (tve.tv_usec - tvs.tv_usec) / 1e6;
+    printf(" %d listeners: %d indications sent, %d delivered"
+           " in %.2f s (%.0f/s)\n", NUM_LISTENERS, sent, delivered, secs,
+           delivered / secs);
+
+    for (n = 0; n < NUM_LISTENERS; n++) {
+        il[n]->ft->stop(il[n]);
+        for (k = n + 1; k < NUM_LISTENERS; k++) {
+            fd = -1;
+            if (postIndication(port + 1 + k, &fd)) {
+                printf(" listener %d stopped after stopping listener %d\n",
+                       k, n);
+                rc = 1;
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        il[n]->ft->release(il[n]);
+    }
+    return rc;
+}
+
+/*
+ * Sends the request headers with the given Content-Length and no body
+ * on a new connection, returns the status line of the response.
+ */
+static char *sendLength(int port, const char *length, char *buf, int size)
+{
+    char head[512];
+    int fd, n = 0, r;
+
+    buf[0] = 0;
+    if ((fd = openConnection(port)) < 0) {
+        return buf;
+    }
+    snprintf(head, sizeof(head),
+             "POST /cimlistener HTTP/1.1\r\n"
+             "Host: localhost\r\n"
+             "Content-Length: %s\r\n"
+             "\r\n", length);
+    if (write(fd, head, strlen(head)) == strlen(head)) {
+        while (n < size - 1 && (r = read(fd, buf + n, size - 1 - n)) > 0) {
+            n += r;
+        }
+    }
+    buf[n] = 0;
+    buf[strcspn(buf, "\r\n")] = 0;
+    close(fd);
+    return buf;
+}
+
+/*
+ * Posts requests with a broken or too large Content-Length to a
+ * listener with a small CIMC_IL_OPT_MaxPayload, which must refuse them
+ * without reading a body and still deliver indications afterwards.
+ * Then stalls within a payload, which must not keep stop() waiting for
+ * the worker reading it.
+ */
+static int runHostile(CIMCEnv *ce)
+{
+    static const struct {
+        const char *length, *status;
+    } bad[] = {
+        { "-1", " 400 " },
+        { "12abc", " 400 " },
+        { "", " 400 " },
+        { "99999999999999999999", " 400 " },
+        { "2147483647", " 413 " },
+        { "4097", " 413 " },
+    };
+    CIMCIndicationListener *il;
+    CIMCStatus status;
+    struct timeval tvs, tve;
+    char buf[512];
+    double secs;
+    int k, p = port + 1 + NUM_LISTENERS, fd, stalled, rc = 0;
+
+    received = 0;
+    il = ce->ft->newIndicationListener(ce, 0, &p, NULL,
+                                       indicationReceived, &status);
+    il->ft->setOption(il, CIMC_IL_OPT_MaxPayload, 4096);
+    status = il->ft->start(il);
+    if (status.rc) {
+        printf(" failed to start the listener on port %d: %s\n", p,
+               status.msg ? (char *) status.msg->hdl : "");
+        il->ft->release(il);
+        return 1;
+    }
+
+    for (k = 0; k < sizeof(bad) / sizeof(bad[0]); k++) {
+        if (strstr(sendLength(p, bad[k].length, buf, sizeof(buf)),
+                   bad[k].status) == NULL) {
+            printf(" Content-Length: %s answered with \"%s\"\n",
+                   bad[k].length, buf);
+            rc = 1;
+        }
+    }
+    fd = -1;
+    if (postIndication(p, &fd)) {
+        printf(" listener stopped after bad requests\n");
+        rc = 1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    for (k = 0; k < 100 && received == 0; k++) {
+        usleep(10000);
+    }
+
+    stalled = openConnection(p);
+    snprintf(buf, sizeof(buf),
+             "POST /cimlistener HTTP/1.1\r\n"
+             "Host: localhost\r\n"
+             "Content-Length: 4000\r\n"
+             "\r\n<?x");
+    if (stalled < 0 || write(stalled, buf, strlen(buf)) != strlen(buf)) {
+        printf(" cannot send a stalled request\n");
+        rc = 1;
+    }
+    usleep(200000);
+    gettimeofday(&tvs, NULL);
+    il->ft->stop(il);
+    gettimeofday(&tve, NULL);
+    secs = (tve.tv_sec - tvs.tv_sec) + (tve.tv_usec - tvs.tv_usec) / 1e6;
+    if (secs > 2) {
+        printf(" stop() waited %.2f s for a stalled request\n", secs);
+        rc = 1;
+    }
+    if (stalled >= 0) {
+        close(stalled);
+    }
+    il->ft->release(il);
+    printf(" %d malformed requests refused, %d indication delivered,"
+           " stopped within %.2f s\n", (int) (sizeof(bad) / sizeof(bad[0])),
+           received, secs);
+    return rc || received != 1;
+}
+
+/*
+ * Runs both load tests against a listener on port, or on socketPath if
+ * that is set.
+ */
+static int runListener(CIMCEnv *ce)
+{
+    CIMCIndicationListener *il;
+    CIMCStatus status;
+    CIMCIndicationListenerStats stats;
+    int rc;
+
+    il = ce->ft->newIndicationListener(ce, 0, &port, &socketPath,
+                                       indicationReceived, &status);
+    il->ft->setOption(il, CIMC_IL_OPT_Backlog, 1024);
+    il->ft->setOption(il, CIMC_IL_OPT_Workers, 4);
+    il->ft->setOption(il, CIMC_IL_OPT_KeepAliveMax, 1000);
+    status = il->ft->start(il);
+    if (status.rc) {
+        printf(" failed to start the listener: %d %s\n", status.rc,
+               status.msg ? (char *) status.msg->hdl : "");
+        il->ft->release(il);
+        return 1;
+    }
+    sleep(1);
+
+    if (socketPath) {
+        printf(" listening on UNIX socket %s\n", socketPath);
+    }
+    else {
+        printf(" listening on port %d\n", port);
+    }
+    rc = run(0);
+    rc |= run(1);
+
+    il->ft->stop(il);
+    il->ft->getStatistics(il, &stats);
+    printf(" queue: %llu enqueued, %llu delivered, %llu dropped,"
+           " latency %llu us average, %llu us max\n",
+           stats.enqueued, stats.delivered, stats.dropped,
+           stats.delivered ? stats.latencyTotal / stats.delivered : 0,
+           stats.latencyMax);
+    printf(" connections: %llu accepted, %llu requests, %llu bad,"
+           " %llu timed out, %llu disconnected, %llu accept errors,"
+           " %llu poll errors\n",
+           stats.connections, stats.requests, stats.badRequests,
+           stats.timeouts, stats.disconnects, stats.acceptErrors,
+           stats.pollErrors);
+    il->ft->release(il);
+    return rc;
+}
+
+int main()
+{
+    CIMCEnv *ce;
+    char *msg = NULL, *il_port, *il_socket;
+    int rc;
+
+    il_port = getenv("IL_PORT");
+    port = il_port ? atoi(il_port) : 5999;
+    il_socket = getenv("IL_SOCKET");
+
+    snprintf(request, sizeof(request),
+             "POST /cimlistener HTTP/1.1\r\n"
+             "Host: localhost\r\n"
+             "Content-Type: application/xml; charset=\"utf-8\"\r\n"
+             "Content-Length: %d\r\n"
+             "CIMExport: MethodRequest\r\n"
+             "CIMExportMethod: ExportIndication\r\n"
+             "\r\n%s", (int) strlen(indication), indication);
+
+    ce = NewCIMCEnv("XML", 0, &rc, &msg);
+    if (ce == NULL) {
+        printf(" failed to load the XML interface: %s\n", msg);
+        return 1;
+    }
+
+    rc = runListener(ce);
+    socketPath = il_socket ? il_socket : "/tmp/v2test_il.socket";
+    rc |= runListener(ce);
+    socketPath = NULL;
+
+    rc |= runMulti(ce);
+    rc |= runHostile(ce);
+    ce->ft->release(ce);
+
+    return rc;
+}
+
+/* end */
@@ -0,0 +1,191 @@
+/*
+ * v2test_il_corpus.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Robustness test for the CIM-XML parser. Starts an indication
+ *  listener on IL_PORT (default 5998) and posts each file of the
+ *  corpus directory given as argument (default: corpus) to it. The
+ *  corpus holds malformed and unexpected messages, most of them found
+ *  by fuzzing. After each file a valid indication is posted, which the
+ *  listener must still deliver. Reports how many files the listener
+ *  counted as parse errors.
+ */
+#include <cimc.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static const char *indication =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<CIM CIMVERSION=\"2.0\" DTDVERSION=\"2.0\">"
+    "<MESSAGE ID=\"1\" PROTOCOLVERSION=\"1.0\"><SIMPLEEXPREQ>"
+    "<EXPMETHODCALL NAME=\"ExportIndication\">"
+    "<EXPPARAMVALUE NAME=\"NewIndication\">"
+    "<INSTANCE CLASSNAME=\"CIM_AlertIndication\">"
+    "<PROPERTY NAME=\"IndicationIdentifier\" TYPE=\"string\"><VALUE>alive</VALUE></PROPERTY>"
+    "</INSTANCE></EXPPARAMVALUE></EXPMETHODCALL>"
+    "</SIMPLEEXPREQ></MESSAGE></CIM>\n";
+
+static int port;
+static int alive;
+static int received;
+
+static void indicationReceived(CIMCInstance *ind)
+{
+    CIMCData d = ind->ft->getProperty(ind, "IndicationIdentifier", NULL);
+
+    if (d.state == 0 && d.type == CIMC_string && d.value.string &&
+        strcmp((char *) d.value.string->hdl, "alive") == 0) {
+        __sync_fetch_and_add(&alive, 1);
+    }
+    __sync_fetch_and_add(&received, 1);
+    ind->ft->release(ind);
+}
+
+/* Posts body on a new connection. Returns 0 if the listener answered. */
+static int post(const char *body, int length)
+{
+    struct sockaddr_in sin;
+    char hdr[256], buf[512];
+    int fd, n = 0, r, hlen;
+
+    fd = socket(PF_INET, SOCK_STREAM, 0);
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *) &sin, sizeof(sin))) {
+        close(fd);
+        return 1;
+    }
+    hlen = snprintf(hdr, sizeof(hdr),
+                    "POST /cimlistener HTTP/1.1\r\n"
+                    "Host: localhost\r\n"
+                    "Content-Type: application/xml; charset=\"utf-8\"\r\n"
+                    "Content-Length: %d\r\n"
+                    "CIMExport: MethodRequest\r\n"
+                    "CIMExportMethod: ExportIndication\r\n"
+                    "Connection: close\r\n"
+                    "\r\n", length);
+    if (write(fd, hdr, hlen) != hlen ||
+        write(fd, body, length) != length) {
+        close(fd);
+        return 1;
+    }
+    while (n < sizeof(buf) - 1 &&
+           (r = read(fd, buf + n, sizeof(buf) - 1 - n)) > 0) {
+        n += r;
+    }
+    buf[n] = 0;
+    close(fd);
+    return strncmp(buf, "HTTP/1.1 ", 9) != 0;
+}
+
+static char *readFile(const char *path, int *length)
+{
+    FILE *f = fopen(path, "r");
+    char *data;
+    long size;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = (char *) malloc(size + 1);
+    *length = fread(data, 1, size, f);
+    data[*length] = 0;
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char *argv[])
+{
+    CIMCEnv *ce;
+    CIMCIndicationListener *il;
+    CIMCIndicationListenerStats stats;
+    CIMCStatus status;
+    char *msg = NULL, *il_port, *data, path[1024];
+    const char *corpus = argc > 1 ? argv[1] : "corpus";
+    struct dirent *de;
+    DIR *dir;
+    int rc, length, k, files = 0, failed = 0;
+
+    il_port = getenv("IL_PORT");
+    port = il_port ? atoi(il_port) : 5998;
+
+    dir = opendir(corpus);
+    if (dir == NULL) {
+        printf(" cannot open the corpus directory %s\n", corpus);
+        return 1;
+    }
+
+    ce = NewCIMCEnv("XML", 0, &rc, &msg);
+    if (ce == NULL) {
+        printf(" failed to load the XML interface: %s\n", msg);
+        return 1;
+    }
+
+    il = ce->ft->newIndicationListener(ce, 0, &port, NULL,
+                                       indicationReceived, &status);
+    status = il->ft->start(il);
+    if (status.rc) {
+        printf(" failed to start the listener: %d %s\n", status.rc,
+               status.msg ? (char *) status.msg->hdl : "");
+        il->ft->release(il);
+        ce->ft->release(ce);
+        return 1;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", corpus, de->d_name);
+        data = readFile(path, &length);
+        if (data == NULL) {
+            continue;
+        }
+        files++;
+        rc = post(data, length);
+        free(data);
+
+        /* the listener must have survived the file */
+        rc |= post(indication, strlen(indication));
+        for (k = 0; k < 100 && alive < files; k++) {
+            usleep(50000);
+        }
+        if (rc || alive < files) {
+            printf(" %s: listener did not recover\n", de->d_name);
+            failed++;
+            break;
+        }
+    }
+    closedir(dir);
+
+    il->ft->stop(il);
+    il->ft->getStatistics(il, &stats);
+    printf(" %d corpus files posted, %llu parse errors, %d other"
+           " indications delivered, %d failed\n", files, stats.parseErrors,
+           received - alive, failed);
+    il->ft->release(il);
+    ce->ft->release(ce);
+
+    return failed != 0 || files == 0;
+}
+
+/* end */
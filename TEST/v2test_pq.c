@@ -0,0 +1,203 @@
+/*
+ * v2test_pq.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Checks the property qualifiers and the property order of several
+ *  instances of one class returned by enumInstances(). The instances
+ *  share a parsed class layout, yet each must report its own qualifier
+ *  values, no qualifiers it did not have, and its properties in the
+ *  order they were sent. A canned response is served on PQ_PORT
+ *  (default 5998), so no CIMOM is needed.
+ */
+#include <cmci.h>
+#include <native.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define INSTANCE(id, props)						\
+    "<VALUE.NAMEDINSTANCE><INSTANCENAME CLASSNAME=\"Test_Disk\">"	\
+    "<KEYBINDING NAME=\"Id\"><KEYVALUE VALUETYPE=\"string\">" id	\
+    "</KEYVALUE></KEYBINDING></INSTANCENAME>"				\
+    "<INSTANCE CLASSNAME=\"Test_Disk\">"				\
+    "<PROPERTY NAME=\"Id\" TYPE=\"string\"><VALUE>" id "</VALUE></PROPERTY>" \
+    props "</INSTANCE></VALUE.NAMEDINSTANCE>"
+
+#define SIZE(units)							\
+    "<PROPERTY NAME=\"Size\" TYPE=\"uint64\">" units			\
+    "<VALUE>4096</VALUE></PROPERTY>"
+
+#define UNITS(u)							\
+    "<QUALIFIER NAME=\"Units\" TYPE=\"string\"><VALUE>" u "</VALUE></QUALIFIER>"
+
+#define LABEL								\
+    "<PROPERTY NAME=\"Label\" TYPE=\"string\"><VALUE>disk</VALUE></PROPERTY>"
+
+static const char *response =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<CIM CIMVERSION=\"2.0\" DTDVERSION=\"2.0\">"
+    "<MESSAGE ID=\"4711\" PROTOCOLVERSION=\"1.0\"><SIMPLERSP>"
+    "<IMETHODRESPONSE NAME=\"EnumerateInstances\"><IRETURNVALUE>"
+    INSTANCE("a", SIZE(UNITS("Bytes")) LABEL)
+    INSTANCE("b", SIZE(UNITS("KiloBytes")) LABEL)
+    INSTANCE("c", SIZE("") LABEL)
+    INSTANCE("d", SIZE(UNITS("Bytes")) LABEL)
+    INSTANCE("e", LABEL SIZE(UNITS("Bytes")))
+    "</IRETURNVALUE></IMETHODRESPONSE></SIMPLERSP></MESSAGE></CIM>\n";
+
+/* expected Units qualifier of Size, NULL if none, and the property order */
+static const struct {
+    const char *units;
+    const char *order[3];
+} expected[] = {
+    { "Bytes",     { "Id", "Size", "Label" } },
+    { "KiloBytes", { "Id", "Size", "Label" } },
+    { NULL,        { "Id", "Size", "Label" } },
+    { "Bytes",     { "Id", "Size", "Label" } },
+    { "Bytes",     { "Id", "Label", "Size" } },
+};
+
+static int listenFd;
+
+/* answers every request on a connection with the canned response */
+static void *serve(void *arg)
+{
+    char buf[8192], hdr[256], *end, *cl;
+    int fd, len, have, body;
+
+    while ((fd = accept(listenFd, NULL, NULL)) >= 0) {
+        have = 0;
+        for (;;) {
+            len = read(fd, buf + have, sizeof(buf) - 1 - have);
+            if (len <= 0)
+                break;
+            have += len;
+            buf[have] = 0;
+            if ((end = strstr(buf, "\r\n\r\n")) == NULL)
+                continue;
+            cl = strstr(buf, "Content-Length:");
+            body = cl ? atoi(cl + 15) : 0;
+            if (have < end + 4 - buf + body)
+                continue;
+            len = sprintf(hdr, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: application/xml; charset=\"utf-8\"\r\n"
+                          "CIMOperation: MethodResponse\r\n"
+                          "Content-Length: %d\r\n\r\n", (int) strlen(response));
+            if (write(fd, hdr, len) != len ||
+                write(fd, response, strlen(response)) != (int) strlen(response))
+                break;
+            have -= end + 4 - buf + body;
+            memmove(buf, end + 4 + body, have);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+int main()
+{
+    CMCIClient		*cc;
+    CMPIObjectPath	*op;
+    CMPIEnumeration	*enm;
+    CMPIInstance	*ci;
+    CMPIStatus		status;
+    CMPIString		*name;
+    CMPIData		d;
+    struct sockaddr_in	sin;
+    pthread_t		tid;
+    char		*port = getenv("PQ_PORT");
+    int			i, j, failed = 0, on = 1;
+
+    if (port == NULL)
+        port = "5998";
+
+    listenFd = socket(PF_INET, SOCK_STREAM, 0);
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(atoi(port));
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, (struct sockaddr *) &sin, sizeof(sin)) ||
+        listen(listenFd, 4)) {
+        printf("cannot listen on port %s\n", port);
+        return 1;
+    }
+    pthread_create(&tid, NULL, serve, NULL);
+
+    cc = cmciConnect("localhost", NULL, port, NULL, NULL, NULL);
+    if (cc == NULL) {
+        printf("cannot load the backend\n");
+        return 1;
+    }
+    op = newCMPIObjectPath("root/cimv2", "Test_Disk", NULL);
+    enm = cc->ft->enumInstances(cc, op, CMPI_FLAG_IncludeQualifiers, NULL,
+                                &status);
+    if (enm == NULL || status.rc) {
+        printf("enumInstances() rc=%d\n", status.rc);
+        return 1;
+    }
+
+    for (i = 0; CMHasNext(enm, NULL); i++) {
+        ci = CMGetNext(enm, NULL).value.inst;
+        if (i >= (int) (sizeof(expected) / sizeof(expected[0]))) {
+            printf("instance %d: not expected\n", i);
+            failed++;
+            continue;
+        }
+
+        d = ci->ft->getPropertyQualifier(ci, "Size", "Units", &status);
+        if (expected[i].units == NULL ? status.rc == CMPI_RC_OK :
+            status.rc != CMPI_RC_OK ||
+            strcmp(CMGetCharPtr(d.value.string), expected[i].units)) {
+            printf("instance %d: Size has Units %s, expected %s\n", i,
+                   status.rc ? "(none)" : CMGetCharPtr(d.value.string),
+                   expected[i].units ? expected[i].units : "(none)");
+            failed++;
+        }
+        if (ci->ft->getPropertyQualifierCount(ci, "Size", NULL) !=
+            (expected[i].units != NULL)) {
+            printf("instance %d: Size has %d qualifiers\n", i,
+                   ci->ft->getPropertyQualifierCount(ci, "Size", NULL));
+            failed++;
+        }
+
+        if (CMGetPropertyCount(ci, NULL) != 3) {
+            printf("instance %d: %d properties\n", i,
+                   CMGetPropertyCount(ci, NULL));
+            failed++;
+            continue;
+        }
+        for (j = 0; j < 3; j++) {
+            CMGetPropertyAt(ci, j, &name, NULL);
+            if (strcasecmp(CMGetCharPtr(name), expected[i].order[j])) {
+                printf("instance %d: property %d is %s, expected %s\n", i, j,
+                       CMGetCharPtr(name), expected[i].order[j]);
+                failed++;
+            }
+            CMRelease(name);
+        }
+    }
+    if (i != (int) (sizeof(expected) / sizeof(expected[0]))) {
+        printf("%d instances returned\n", i);
+        failed++;
+    }
+
+    printf("%d instances checked, %d failures\n", i, failed);
+    CMRelease(enm);
+    CMRelease(op);
+    CMRelease(cc);
+    return failed != 0;
+}
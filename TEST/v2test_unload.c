@@ -0,0 +1,82 @@
+/*
+ * v2test_unload.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ *  Checks that threads which released objects, and so filled their
+ *  node caches, can exit after ReleaseCIMCEnv() unloaded the backend.
+ *  Then loads it again and does the same. Needs no CIMOM.
+ */
+#include <cimc.h>
+#include <stdio.h>
+#include <pthread.h>
+
+static CIMCEnv *ce;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int released, unloaded;
+
+/* creates and releases objects, then waits for the unload and exits */
+static void *worker(void *arg)
+{
+    CIMCObjectPath *op;
+    CIMCInstance *inst;
+    int k;
+
+    for (k = 0; k < 100; k++) {
+        op = ce->ft->newObjectPath(ce, "root/cimv2", "Test_Disk", NULL);
+        inst = ce->ft->newInstance(ce, op, NULL);
+        inst->ft->release(inst);
+        op->ft->release(op);
+    }
+
+    pthread_mutex_lock(&lock);
+    released++;
+    pthread_cond_broadcast(&cond);
+    while (!unloaded)
+        pthread_cond_wait(&cond, &lock);
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int main()
+{
+    pthread_t tid[4];
+    char *msg;
+    int rc, round, i;
+
+    for (round = 0; round < 2; round++) {
+        ce = NewCIMCEnv("XML", 0, &rc, &msg);
+        if (ce == NULL) {
+            printf("cannot load the backend: %s\n", msg);
+            return 1;
+        }
+
+        released = unloaded = 0;
+        for (i = 0; i < 4; i++)
+            pthread_create(&tid[i], NULL, worker, NULL);
+        pthread_mutex_lock(&lock);
+        while (released < 4)
+            pthread_cond_wait(&cond, &lock);
+        pthread_mutex_unlock(&lock);
+
+        ReleaseCIMCEnv(ce);
+
+        pthread_mutex_lock(&lock);
+        unloaded = 1;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        for (i = 0; i < 4; i++)
+            pthread_join(tid[i], NULL);
+    }
+
+    printf("threads exited after unload: 0 errors\n");
+    return 0;
+}
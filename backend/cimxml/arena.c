@@ -0,0 +1,547 @@
+/*!
+  \file arena.c
+  \brief Arenas holding all native CMPI objects of one response, and
+  per thread caches of small object nodes.
+
+  While an arena is in use by a thread, the native objects it creates
+  are carved out of large chunks owned by the arena instead of being
+  allocated one by one, and releasing the arena frees all of them at
+  once, chunk by chunk. Freeing memory of an arena does nothing, so
+  releasing an object of an arena does nothing either.
+
+  Chunks are aligned to their size and entered into a table indexed by
+  chunk address, which tells for any pointer whether, and to which
+  arena, it belongs. The table has three levels and covers the whole
+  address space. It is read by all threads without a lock, so its
+  entries are set and cleared atomically, and its lower levels, once
+  allocated, are kept for the life of the process; a middle level spans
+  256 TB and a leaf 8 GB of addresses, so there are only a few. Clones
+  of arena objects made outside of their arena use this to copy instead
+  of sharing the payload, so that they outlive it. Functions modifying
+  an object allocate from the arena of the object while doing so, see
+  native_enter_arena(), so that what they add is freed with it.
+
+  Outside of arenas, the fixed size nodes of properties, qualifiers,
+  object paths, instances and strings are taken from and returned to a
+  free list per size class and thread. Each list keeps a limited number
+  of nodes, so that threads releasing what others allocated do not hoard
+  memory; the rest goes back to malloc. The lists are emptied when their
+  thread exits while the library is loaded. Setting SFCC_NODE_CACHE to
+  the number of nodes to keep per list, or to 0 to disable the lists,
+  e.g. for memory debuggers, overrides the default.
+
+  THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+  ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+  CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+
+  You can obtain a current copy of the Eclipse Public License from
+  http://www.opensource.org/licenses/eclipse-1.0.php
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <limits.h>
+#include "cmcidt.h"
+#include "cmcift.h"
+#include "native.h"
+
+#ifdef DMALLOC
+#include "dmalloc.h"
+#endif
+
+#define CHUNK_BITS	18
+#define CHUNK_SIZE	( (size_t) 1 << CHUNK_BITS )
+#define LEAF_BITS	15		/* of the middle level too */
+#define LEAF_MASK	( ( (uintptr_t) 1 << LEAF_BITS ) - 1 )
+#define PTR_BITS	( sizeof ( uintptr_t ) * CHAR_BIT )
+#define ROOT_BITS	( ( PTR_BITS > CHUNK_BITS + 2 * LEAF_BITS )?	\
+			  PTR_BITS - CHUNK_BITS - 2 * LEAF_BITS: 0 )
+
+//! Allocations larger than this get a chunk of their own.
+#define LARGE_SIZE	( CHUNK_SIZE / 4 )
+
+//! Header at the start of every chunk.
+struct native_chunk {
+	struct native_chunk * next;	//!< Chunk allocated before.
+	size_t size;			//!< A multiple of CHUNK_SIZE.
+};
+
+//! Heap memory freed together with an arena.
+struct native_adopted {
+	struct native_adopted * next;
+	void * ptr;
+};
+
+struct native_arena {
+	struct native_chunk * chunks;	//!< Most recent chunk first.
+	char * next;			//!< Free part of the current chunk.
+	char * end;
+	pthread_mutex_t lock;		//!< Protects adopted.
+	struct native_adopted * adopted;
+	pthread_mutex_t write;		//!< Held while objects are modified.
+};
+
+#define NODE_ALIGN	16
+#define NODE_CLASSES	8		/* of up to 128 bytes */
+#define NODE_CACHE	256		/* default nodes kept per class */
+
+//! A free node, linked into the free list of its size class.
+struct native_node {
+	struct native_node * next;
+};
+
+//! Free nodes of one thread.
+struct native_node_cache {
+	struct native_node * free[NODE_CLASSES];
+	unsigned int count[NODE_CLASSES];
+	int registered;			//!< Emptied when the thread exits.
+};
+
+//! Owner of every chunk sized piece of the address space, by address.
+static void * table[(size_t) 1 << ROOT_BITS];
+static int used;
+static __thread struct native_arena * current;
+
+static pthread_once_t nodeOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t nodeKey;
+static int nodeKeyed;			/* nodeKey was created */
+static unsigned int nodeLimit;
+static __thread struct native_node_cache nodes;
+
+
+/****************************************************************************/
+
+
+//! The table level in slot, allocated first if create is set.
+static void ** __level ( void ** slot, int create )
+{
+	void ** level = (void **) __atomic_load_n ( slot, __ATOMIC_ACQUIRE );
+
+	if ( level == NULL && create ) {
+		level = (void **) calloc ( LEAF_MASK + 1, sizeof ( void * ) );
+		if ( level == NULL ) return NULL;
+		if ( ! __sync_bool_compare_and_swap ( slot, NULL, level ) ) {
+			free ( level );
+			level = (void **) __atomic_load_n ( slot,
+							    __ATOMIC_ACQUIRE );
+		}
+	}
+	return level;
+}
+
+
+//! The leaf of the table holding the owner of chunk index.
+static struct native_arena ** __leaf ( uintptr_t index, int create )
+{
+	void ** middle = __level ( &table[index >> ( 2 * LEAF_BITS )],
+				   create );
+
+	if ( middle == NULL ) return NULL;
+	return (struct native_arena **)
+		__level ( &middle[( index >> LEAF_BITS ) & LEAF_MASK], create );
+}
+
+
+static struct native_arena * __arena_of ( const void * ptr )
+{
+	uintptr_t index = (uintptr_t) ptr >> CHUNK_BITS;
+	struct native_arena ** leaf;
+
+	if ( ! __atomic_load_n ( &used, __ATOMIC_ACQUIRE ) ) return NULL;
+	leaf = __leaf ( index, 0 );
+	return ( leaf )?
+		__atomic_load_n ( &leaf[index & LEAF_MASK], __ATOMIC_ACQUIRE ):
+		NULL;
+}
+
+
+static int __enter ( struct native_chunk * c, struct native_arena * a )
+{
+	uintptr_t index = (uintptr_t) c >> CHUNK_BITS;
+	uintptr_t last  = index + ( c->size >> CHUNK_BITS );
+
+	for ( ; index < last; index++ ) {
+		struct native_arena ** leaf = __leaf ( index, 1 );
+
+		if ( leaf == NULL ) return -1;
+		__atomic_store_n ( &leaf[index & LEAF_MASK], a, __ATOMIC_RELEASE );
+	}
+	return 0;
+}
+
+
+static void __leave ( struct native_chunk * c )
+{
+	uintptr_t index = (uintptr_t) c >> CHUNK_BITS;
+	uintptr_t last  = index + ( c->size >> CHUNK_BITS );
+
+	for ( ; index < last; index++ ) {
+		struct native_arena ** leaf = __leaf ( index, 0 );
+
+		if ( leaf )
+			__atomic_store_n ( &leaf[index & LEAF_MASK], NULL,
+					   __ATOMIC_RELEASE );
+	}
+}
+
+
+static struct native_chunk * __new_chunk ( struct native_arena * a,
+					   size_t size )
+{
+	struct native_chunk * c;
+
+	size = ( size + CHUNK_SIZE - 1 ) & ~ ( CHUNK_SIZE - 1 );
+	if ( size == 0 || posix_memalign ( (void **) &c, CHUNK_SIZE, size ) )
+		return NULL;
+
+	c->size   = size;
+	if ( __enter ( c, a ) ) {
+		__leave ( c );
+		free ( c );
+		return NULL;
+	}
+	c->next   = a->chunks;
+	a->chunks = c;
+	return c;
+}
+
+
+/**
+ * Every allocation is preceded by its size, rounded up to 8 bytes, for
+ * native_realloc().
+ */
+static void * __alloc ( struct native_arena * a, size_t size )
+{
+	size_t need = ( sizeof ( size_t ) + size + 7 ) & ~ (size_t) 7;
+	size_t * p;
+
+	if ( need < size ) return NULL;
+
+	if ( need > (size_t) ( a->end - a->next ) ) {
+		struct native_chunk * c;
+
+		if ( need > LARGE_SIZE ) {
+			c = __new_chunk ( a, sizeof ( *c ) + need );
+			if ( c == NULL ) return NULL;
+			p = (size_t *) ( c + 1 );
+			*p = need - sizeof ( size_t );
+			return p + 1;
+		}
+		if ( ( c = __new_chunk ( a, CHUNK_SIZE ) ) == NULL )
+			return NULL;
+		a->next = (char *) ( c + 1 );
+		a->end  = (char *) c + CHUNK_SIZE;
+	}
+
+	p = (size_t *) a->next;
+	a->next += need;
+	*p = need - sizeof ( size_t );
+	return p + 1;
+}
+
+
+/****************************************************************************/
+
+
+struct native_arena * native_new_arena ( void )
+{
+	struct native_arena * a = (struct native_arena *)
+		calloc ( 1, sizeof ( struct native_arena ) );
+
+	pthread_mutex_init ( &a->lock, NULL );
+	pthread_mutex_init ( &a->write, NULL );
+	__atomic_store_n ( &used, 1, __ATOMIC_RELEASE );
+	return a;
+}
+
+
+//! Frees all memory of the arena, and the heap memory it adopted.
+void native_release_arena ( struct native_arena * a )
+{
+	struct native_chunk * c;
+	struct native_adopted * h;
+
+	if ( a == NULL ) return;
+
+	while ( ( c = a->chunks ) ) {
+		__leave ( c );
+		a->chunks = c->next;
+		free ( c );
+	}
+	while ( ( h = a->adopted ) ) {
+		a->adopted = h->next;
+		free ( h->ptr );
+		free ( h );
+	}
+	pthread_mutex_destroy ( &a->lock );
+	pthread_mutex_destroy ( &a->write );
+	free ( a );
+}
+
+
+//! Makes the calling thread allocate from a, or from the heap if NULL.
+/*!
+  Returns the arena used before, to be restored when done.
+ */
+struct native_arena * native_use_arena ( struct native_arena * a )
+{
+	struct native_arena * prev = current;
+
+	current = a;
+	return prev;
+}
+
+
+//! Makes the calling thread allocate where obj is while modifying it.
+/*!
+  Memory allocated for an arena object, e.g. for a property set on an
+  instance of an enumeration, is then taken from and freed with its
+  arena, and memory for a heap object from the heap. Modifications of
+  objects of one arena made by other threads than the one filling it
+  are serialised. Returns the arena to pass to native_leave_arena().
+ */
+struct native_arena * native_enter_arena ( const void * obj )
+{
+	struct native_arena * a = __arena_of ( obj );
+	struct native_arena * prev = current;
+
+	if ( a != prev ) {
+		if ( a ) pthread_mutex_lock ( &a->write );
+		current = a;
+	}
+	return prev;
+}
+
+
+//! Ends what native_enter_arena() returning prev started.
+void native_leave_arena ( struct native_arena * prev )
+{
+	struct native_arena * a = current;
+
+	if ( a != prev ) {
+		current = prev;
+		if ( a ) pthread_mutex_unlock ( &a->write );
+	}
+}
+
+
+//! Tells whether ptr belongs to any arena.
+int native_in_arena ( const void * ptr )
+{
+	return __arena_of ( ptr ) != NULL;
+}
+
+
+//! Tells whether ptr is from where the calling thread allocates now.
+/*!
+  Objects may share their payload with a clone only if this holds for
+  them; otherwise the clone has to be a copy.
+ */
+int native_arena_local ( const void * ptr )
+{
+	return __arena_of ( ptr ) == current;
+}
+
+
+//! Has the heap memory ptr freed with the arena of owner, if any.
+/*!
+  Returns 0 if owner is not from an arena; ptr is then left alone. This
+  is for caches filled in after an arena object was created, possibly
+  by another thread.
+ */
+int native_arena_adopt ( const void * owner, void * ptr )
+{
+	struct native_arena * a = __arena_of ( owner );
+	struct native_adopted * h;
+
+	if ( a == NULL ) return 0;
+
+	h = (struct native_adopted *) malloc ( sizeof ( *h ) );
+	h->ptr = ptr;
+	pthread_mutex_lock ( &a->lock );
+	h->next = a->adopted;
+	a->adopted = h;
+	pthread_mutex_unlock ( &a->lock );
+	return 1;
+}
+
+
+/****************************************************************************/
+
+
+void * native_malloc ( size_t size )
+{
+	return ( current )? __alloc ( current, size ): malloc ( size );
+}
+
+
+void * native_calloc ( size_t nmemb, size_t size )
+{
+	void * p;
+
+	if ( current == NULL ) return calloc ( nmemb, size );
+
+	if ( size && nmemb > (size_t) -1 / size ) return NULL;
+	if ( ( p = __alloc ( current, nmemb * size ) ) )
+		memset ( p, 0, nmemb * size );
+	return p;
+}
+
+
+/**
+ * Memory of an arena grows in place if it was the last allocation made
+ * from its chunk, or else is copied to where the calling thread
+ * allocates now.
+ */
+void * native_realloc ( void * ptr, size_t size )
+{
+	struct native_arena * a;
+	size_t old;
+	void * p;
+
+	if ( ptr == NULL ) return native_malloc ( size );
+	if ( ( a = __arena_of ( ptr ) ) == NULL ) return realloc ( ptr, size );
+
+	old = ( (size_t *) ptr )[-1];
+	if ( size <= old ) return ptr;
+
+	if ( a == current && (char *) ptr + old == a->next ) {
+		size_t more = ( size - old + 7 ) & ~ (size_t) 7;
+
+		if ( more >= size - old &&
+		     more <= (size_t) ( a->end - a->next ) ) {
+			a->next += more;
+			( (size_t *) ptr )[-1] = old + more;
+			return ptr;
+		}
+	}
+
+	if ( ( p = native_malloc ( size ) ) )
+		memcpy ( p, ptr, old );
+	return p;
+}
+
+
+char * native_strdup ( const char * str )
+{
+	size_t len = strlen ( str ) + 1;
+	char * p = (char *) native_malloc ( len );
+
+	if ( p ) memcpy ( p, str, len );
+	return p;
+}
+
+
+void native_free ( void * ptr )
+{
+	if ( ! __arena_of ( ptr ) ) free ( ptr );
+}
+
+
+/****************************************************************************/
+
+
+static void __drain_nodes ( void * c )
+{
+	struct native_node_cache * cache = (struct native_node_cache *) c;
+	struct native_node * n;
+	int i;
+
+	for ( i = 0; i < NODE_CLASSES; i++ ) {
+		while ( ( n = cache->free[i] ) ) {
+			cache->free[i] = n->next;
+			free ( n );
+		}
+		cache->count[i] = 0;
+	}
+	cache->registered = 0;
+}
+
+
+static void __init_nodes ( void )
+{
+	char * limit = getenv ( "SFCC_NODE_CACHE" );
+
+	nodeLimit = NODE_CACHE;
+	if ( limit && *limit ) {
+		unsigned long l = strtoul ( limit, NULL, 10 );
+
+		nodeLimit = ( l > INT_MAX )? INT_MAX: l;
+	}
+	if ( pthread_key_create ( &nodeKey, __drain_nodes ) == 0 )
+		nodeKeyed = 1;
+	else	nodeLimit = 0;
+}
+
+
+/**
+ * Runs when the library is unloaded, e.g. by ReleaseCIMCEnv(), so that
+ * threads exiting later do not call __drain_nodes() any more. Only the
+ * calling thread's nodes can be freed here, those of other threads are
+ * left to the process.
+ */
+static void __attribute__ (( destructor )) __fini_nodes ( void )
+{
+	if ( nodeKeyed ) {
+		pthread_key_delete ( nodeKey );
+		__drain_nodes ( &nodes );
+	}
+}
+
+
+//! Allocates a zero filled node of size bytes.
+/*!
+  Nodes must be released with native_release_node() and the same size,
+  or a smaller one, as the size class is derived from it.
+ */
+void * native_new_node ( size_t size )
+{
+	unsigned int c = ( size - 1 ) / NODE_ALIGN;
+	struct native_node * n;
+
+	if ( current ) return native_calloc ( 1, size );
+
+	if ( c >= NODE_CLASSES ) return calloc ( 1, size );
+
+	if ( ( n = nodes.free[c] ) ) {
+		nodes.free[c] = n->next;
+		nodes.count[c]--;
+		memset ( n, 0, size );
+		return n;
+	}
+	return calloc ( 1, ( c + 1 ) * NODE_ALIGN );
+}
+
+
+void native_release_node ( void * node, size_t size )
+{
+	unsigned int c = ( size - 1 ) / NODE_ALIGN;
+	struct native_node * n = (struct native_node *) node;
+
+	if ( n == NULL || __arena_of ( n ) ) return;
+
+	if ( c < NODE_CLASSES ) {
+		pthread_once ( &nodeOnce, __init_nodes );
+		if ( nodes.count[c] < nodeLimit ) {
+			if ( ! nodes.registered ) {
+				pthread_setspecific ( nodeKey, &nodes );
+				nodes.registered = 1;
+			}
+			n->next = nodes.free[c];
+			nodes.free[c] = n;
+			nodes.count[c]++;
+			return;
+		}
+	}
+	free ( n );
+}
+
+
+/****************************************************************************/
+
+/*** Local Variables:  ***/
+/*** mode: C           ***/
+/*** c-basic-offset: 8 ***/
+/*** End:              ***/
@@ -57,7 +57,7 @@ static CMPIStatus __aft_release ( CMPIArgs * args )
 	if ( a ) {
 
 		propertyFT.release ( a->data );
-		free ( a );
+		native_free ( a );
 
 		CMReturn ( CMPI_RC_OK );
 	}
@@ -85,12 +85,16 @@ static CMPIStatus __aft_addArg ( CMPIArgs * args,
 				 CMPIType type )
 {
 	struct native_args * a = (struct native_args *) args;
-
-	CMReturn ( ( propertyFT.addProperty ( &a->data,
+	struct native_arena * prev = native_enter_arena ( a );
+	int exists = propertyFT.addProperty ( &a->data,
 					      name,
 					      type,
-					      0,
-					      value ) )?
+					      ( value == NULL ) ?
+					         CMPI_nullValue : 0,
+					      value );
+
+	native_leave_arena ( prev );
+	CMReturn ( ( exists )?
 		   CMPI_RC_ERR_ALREADY_EXISTS:
 		   CMPI_RC_OK );
 }
@@ -142,7 +146,7 @@ static struct native_args * __new_empty_args ( CMPIStatus * rc )
 	};
 
 	struct native_args * args = (struct native_args *)
-		calloc ( 1, sizeof ( struct native_args ) );
+		native_calloc ( 1, sizeof ( struct native_args ) );
 
 	args->args      = a;
         args->data = 0;
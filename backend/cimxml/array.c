@@ -43,11 +43,20 @@ struct native_array_item {
 };
 
 
+/*
+ * Arrays of a fixed width type keep their elements packed, width bytes
+ * each, with a bit per element in nulls telling whether it is null.
+ * All other arrays keep a native_array_item per element in data.
+ */
 struct native_array {
    CMPIArray array;
    CMPICount size, max, dynamic;
    CMPIType type;
    struct native_array_item * data;
+   size_t width;
+   char * packed;
+   unsigned char * nulls;
+   CMPICount nullCount;
 };
 
 
@@ -57,10 +66,63 @@ static struct native_array * __new_empty_array ( CMPICount,
 
 /*****************************************************************************/
 
+static size_t __packed_width ( CMPIType type )
+{
+   switch ( type ) {
+   case CMPI_boolean:
+   case CMPI_uint8:
+   case CMPI_sint8:
+      return 1;
+   case CMPI_char16:
+   case CMPI_uint16:
+   case CMPI_sint16:
+      return 2;
+   case CMPI_uint32:
+   case CMPI_sint32:
+   case CMPI_real32:
+      return 4;
+   case CMPI_uint64:
+   case CMPI_sint64:
+   case CMPI_real64:
+      return 8;
+   }
+   return 0;
+}
+
+static int __is_NULL ( struct native_array * a, CMPICount i )
+{
+   if ( a->width ) {
+      return ( a->nulls[i / 8] >> ( i % 8 ) ) & 1;
+   }
+   return ( a->data[i].state & CMPI_nullValue ) != 0;
+}
+
+static void __set_packed_NULL ( struct native_array * a, CMPICount i,
+     int null )
+{
+   unsigned char bit = 1 << ( i % 8 );
+
+   if ( ! ( a->nulls[i / 8] & bit ) == ! null ) {
+      return;
+   }
+   if ( null ) {
+      a->nulls[i / 8] |= bit;
+      a->nullCount++;
+   } else {
+      a->nulls[i / 8] &= ~bit;
+      a->nullCount--;
+   }
+}
+
 static void __make_NULL ( struct native_array * a,
      int from, int to, int release )
 {
    for ( ; from <= to; from++ ) {
+      if ( a->width ) {
+         __set_packed_NULL ( a, from, 1 );
+         continue;
+      }
+
       a->data[from].state = CMPI_nullValue;
 
       if ( release ) {
@@ -69,17 +131,62 @@ static void __make_NULL ( struct native_array * a,
    }
 }
 
+/*
+ * Resizes the storage to a->max elements. The elements from index from
+ * on are null; in packed arrays they are counted as null elements once
+ * they are within the size.
+ */
+static void __resize ( struct native_array * a, CMPICount from )
+{
+   if ( a->width ) {
+      a->packed = (char *) native_realloc ( a->packed, a->max * a->width );
+      a->nulls  = (unsigned char *) native_realloc ( a->nulls, ( a->max + 7 ) / 8 );
+      memset ( a->packed + from * a->width, 0,
+               ( a->max - from ) * a->width );
+      for ( ; from < a->max && from % 8; from++ ) {
+         a->nulls[from / 8] |= 1 << ( from % 8 );
+      }
+      if ( from < a->max ) {
+         memset ( a->nulls + from / 8, 0xff, ( a->max + 7 ) / 8 - from / 8 );
+      }
+   } else {
+      a->data = (struct native_array_item *)
+         native_realloc ( a->data, a->max * sizeof ( struct native_array_item ) );
+      memset ( a->data + from, 0,
+               ( a->max - from ) * sizeof ( struct native_array_item ) );
+      if ( a->max > from ) {
+         __make_NULL ( a, from, a->max - 1, 0 );
+      }
+   }
+}
+
+/* Switches the element type of an empty array. */
+static void __set_type ( struct native_array * a, CMPIType type )
+{
+   native_free ( a->data );
+   native_free ( a->packed );
+   native_free ( a->nulls );
+   a->data      = NULL;
+   a->packed    = NULL;
+   a->nulls     = NULL;
+   a->nullCount = 0;
+   a->type      = type;
+   a->width     = __packed_width ( type );
+   __resize ( a, 0 );
+}
+
 void native_array_increase_size(CMPIArray * array, CMPICount increment)
 {
    struct native_array *a = (struct native_array *) array;
 
    if ((a->size+increment)>a->max) {
-      if (a->size==0) a->max=8;
-      else while ((a->size+increment)>a->max) a->max*=2;
-      a->data = (struct native_array_item *)
-         realloc(a->data, a->max * sizeof(struct native_array_item));
-      memset(&a->data[a->size], 0, sizeof(struct native_array_item) * increment);
+      CMPICount max = a->max;
+
+      if (a->max==0) a->max=8;
+      while ((a->size+increment)>a->max) a->max*=2;
+      __resize(a, max);
    }
+   if (a->width) a->nullCount += increment;
    a->size += increment;
 }
 
@@ -90,7 +197,9 @@ static CMPIStatus __aft_release ( CMPIArray * array )
 
    if ( a ) {
 
-      int i = a->size;
+      int i = a->width ? 0 : a->size;
+
+      if ( native_in_arena ( a ) ) CMReturn ( CMPI_RC_OK );
 
       while ( i-- ) {
          if ( ! ( a->data[i].state & CMPI_nullValue ) ) {
@@ -98,8 +207,10 @@ static CMPIStatus __aft_release ( CMPIArray * array )
          }
       }
 
-      free ( a->data );
-      free ( a );
+      native_free ( a->data );
+      native_free ( a->packed );
+      native_free ( a->nulls );
+      native_free ( a );
 
       CMReturn ( CMPI_RC_OK );
    }
@@ -116,6 +227,13 @@ static CMPIArray * __aft_clone ( CMPIArray * array, CMPIStatus * rc )
 
    int i = a->size;
 
+   if ( a->width ) {
+      memcpy ( new->packed, a->packed, a->size * a->width );
+      memcpy ( new->nulls, a->nulls, ( a->size + 7 ) / 8 );
+      new->nullCount = a->nullCount;
+      i = 0;
+   }
+
    while ( i-- && tmp.rc == CMPI_RC_OK ) {
       new->data[i].state = a->data[i].state;
       if ( ! ( new->data[i].state & CMPI_nullValue ) ) {
@@ -154,8 +272,13 @@ static CMPIData __aft_getElementAt ( CMPIArray * array, CMPICount index, CMPISta
    CMPIData result = { a->type, CMPI_badValue };
 
    if ( index < a->size ) {
-      result.state = a->data[index].state;
-      result.value = a->data[index].value;
+      if ( a->width ) {
+         result.state = __is_NULL ( a, index ) ? CMPI_nullValue : 0;
+         memcpy ( &result.value, a->packed + index * a->width, a->width );
+      } else {
+         result.state = a->data[index].state;
+         result.value = a->data[index].value;
+      }
    }
 
    CMSetStatus ( rc, CMPI_RC_OK );
@@ -188,12 +311,18 @@ static CMPIStatus setElementAt ( CMPIArray * array, CMPICount index, CMPIValue *
 
       if ( type == CMPI_null ) {
 
-         if ( ! ( a->data[index].state & CMPI_nullValue ) ) {
+         if ( ! __is_NULL ( a, index ) ) {
             __make_NULL ( a, index, index, 1 );
          }
          CMReturn ( CMPI_RC_OK );
       }
 
+      if ( a->width && ( opt || type == a->type ) ) {
+         memcpy ( a->packed + index * a->width, val, a->width );
+         __set_packed_NULL ( a, index, 0 );
+         CMReturn ( CMPI_RC_OK );
+      }
+
       if ( opt || type == a->type ) {
 
          CMPIStatus rc = {CMPI_RC_OK, NULL};
@@ -212,7 +341,11 @@ static CMPIStatus setElementAt ( CMPIArray * array, CMPICount index, CMPIValue *
 static CMPIStatus __aft_setElementAt ( CMPIArray * array, CMPICount index, CMPIValue * val,
           CMPIType type )
 { 
-   return setElementAt(array,index,val,type,0);
+   struct native_arena *prev = native_enter_arena(array);
+   CMPIStatus rc = setElementAt(array,index,val,type,0);
+
+   native_leave_arena(prev);
+   return rc;
 }
 
 
@@ -234,12 +367,13 @@ static struct native_array * __new_empty_array ( CMPICount size, CMPIType type,
    };
 
    struct native_array * array = (struct native_array *)
-      calloc ( 1, sizeof ( struct native_array ) );
+      native_calloc ( 1, sizeof ( struct native_array ) );
 
    array->array     = a;
 
    type        &= ~CMPI_ARRAY;
    array->type  = ( type == CMPI_chars )? CMPI_string: type;
+   array->width = __packed_width ( array->type );
    array->size  = size;
  
    if (array->size == 0) {
@@ -251,10 +385,10 @@ static struct native_array * __new_empty_array ( CMPICount size, CMPIType type,
       array->dynamic = 0;
    }    
      
-   array->data  = (struct native_array_item *) 
-      calloc ( 1, array->max * sizeof ( struct native_array_item ) );
-
-   __make_NULL ( array, 0, array->max - 1, 0 );
+   __resize ( array, 0 );
+   if ( array->width ) {
+      array->nullCount = array->size;
+   }
 
    CMSetStatus ( rc, CMPI_RC_OK );
    return array;
@@ -270,12 +404,51 @@ CMPIStatus simpleArrayAdd(CMPIArray * array, CMPIValue * val, CMPIType type)
 {
    struct native_array * a = (struct native_array *) array;
    if (a->dynamic) {
-      if (a->size == 0) a->type = type;
+      if (a->size == 0 && type != a->type) __set_type(a, type);
       setElementAt(array, a->size, val, type,1);
    }   
    CMReturn ( CMPI_RC_ERR_FAILED );
 } 
 
+/*
+ * Hands the element at index over to the caller, who becomes responsible
+ * for releasing it. The array keeps a null element in its place.
+ */
+CMPIData simpleArrayTake(CMPIArray * array, CMPICount index)
+{
+   struct native_array * a = (struct native_array *) array;
+   CMPIData result = __aft_getElementAt(array, index, NULL);
+
+   if ( index < a->size ) {
+      __make_NULL ( a, index, index, 0 );
+   }
+   return result;
+}
+
+/*
+ * Returns the elements of an array of a fixed width type as a block of
+ * *count elements of the array's type, or NULL for other arrays. *nulls
+ * is set to a bit per element, set for null elements, or to NULL if no
+ * element is null. The block is valid until the array is changed or
+ * released.
+ */
+const void * native_array_packed ( const CMPIArray * array, CMPICount * count,
+                                  const unsigned char ** nulls )
+{
+   const struct native_array * a = (const struct native_array *) array;
+
+   if ( a == NULL || a->width == 0 ) {
+      return NULL;
+   }
+   if ( count ) {
+      *count = a->size;
+   }
+   if ( nulls ) {
+      *nulls = a->nullCount ? a->nulls : NULL;
+   }
+   return a->packed;
+}
+
 /****************************************************************************/
 
 /*** Local Variables:  ***/
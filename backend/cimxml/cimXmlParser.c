@@ -34,6 +34,8 @@
 
 #include <pthread.h>
 
+extern void releaseLayouts(ParserControl *parm);
+
 #ifdef LARGE_VOL_SUPPORT
 
 // New begin
@@ -75,7 +77,7 @@ inline void INCOFF (enumScanInfo * esi ){
 
 int sfccFreeSection(ParserControl * );
 void * enumScanThrd(struct native_enum *);
-int sfccLex(parseUnion * , ParserControl * );
+int sfccLex(ParserToken * , ParserControl * );
 char * getNextSection(struct _CMCIConnection * );
 int checkTag(char * , int );
 
@@ -95,10 +97,39 @@ typedef struct tags {
 #define TAG(t) t,(sizeof(t)-1)
 
 
-static void Throw(XmlBuffer * xb, char *msg)
-{
-   printf("*** Error: %s\n", msg);
-   exit(1);
+#define PARSE_ERROR_EXCERPT 64
+#define PARSE_ERROR_SIZE 512
+
+/*
+ * Abandons parsing xb, see startParsing(). The error text names the
+ * offset and quotes a bounded excerpt of the XML found there.
+ */
+void throwParseError(XmlBuffer * xb, const char *msg)
+{
+   char excerpt[PARSE_ERROR_EXCERPT + 1];
+   char *text;
+   long n, k;
+
+   n = xb->last - xb->cur;
+   if (n < 0)
+      n = 0;
+   if (n > PARSE_ERROR_EXCERPT)
+      n = PARSE_ERROR_EXCERPT;
+   /* the lexer leaves NULs behind attribute values and contents */
+   for (k = 0; k < n; k++)
+      excerpt[k] = isprint((unsigned char) xb->cur[k]) ? xb->cur[k] : ' ';
+   excerpt[k] = 0;
+
+   text = (char *) malloc(PARSE_ERROR_SIZE);
+   snprintf(text, PARSE_ERROR_SIZE, "Parse error at offset %ld: %.300s: \"%s\"",
+            (long) (xb->cur - xb->base), msg, excerpt);
+   if (xb->errorJump == NULL) {
+      printf("*** Error: %s\n", text);
+      exit(1);
+   }
+   free(xb->errorText);
+   xb->errorText = text;
+   longjmp(*xb->errorJump, 1);
 }
 
 static XmlBuffer *newXmlBuffer(const char *s)
@@ -111,6 +142,8 @@ static XmlBuffer *newXmlBuffer(const char *s)
    xb->nulledChar = 0;
    xb->eTagFound = 0;
    xb->etag = 0;
+   xb->errorJump = NULL;
+   xb->errorText = NULL;
    return xb;
 }
 
@@ -118,13 +151,12 @@ static void releaseXmlBuffer(XmlBuffer *xb)
 {
 	  if(xb->base)
        free (xb->base);
+    free (xb->errorText);
     free (xb);
 }
 
 inline void skipWS(XmlBuffer * xb)
 {
-   static int c = 0;
-   c++;
    while (*xb->cur <= ' ' && xb->last > xb->cur)
       xb->cur++;
 }
@@ -153,6 +185,8 @@ inline char *nextTag(XmlBuffer * xb)
       xb->nulledChar = 0;
       return xb->cur + 1;
    }
+   if (xb->cur >= xb->last)
+      return NULL;
    skipWS(xb);
    if (*xb->cur == '<')
       return xb->cur + 1;
@@ -173,7 +207,8 @@ static char skipTag(XmlBuffer * xb)
 {
    while (*xb->cur != '>' && xb->last > xb->cur)
       xb->cur++;
-   xb->cur++;
+   if (xb->last > xb->cur)
+      xb->cur++;
    return *xb->cur;
 }
 
@@ -192,14 +227,12 @@ static int getWord(XmlBuffer * xb, const char *w, int xCase)
 
 static int tagEquals(XmlBuffer * xb, const char *t)
 {
-   char *start = NULL;
+   char *start = xb->cur;
    int sz = 0;
-   if (*xb->cur == 0) {
+   if (*xb->cur == 0 && xb->cur < xb->last) {
       xb->cur++;
       sz = 1;
    }                            // why is this needed ?
-   else
-      start = xb->cur;
    skipWS(xb);
    if (sz || getChar(xb, '<')) {
       skipWS(xb);
@@ -240,7 +273,7 @@ static int attrsOk(XmlBuffer * xb, const XmlElement * e, XmlAttr * r,
                   goto ok;
                }
                else
-                  Throw(xb, "'=' expected in attribute list");
+                  throwParseError(xb, "'=' expected in attribute list");
             }
          }
       }
@@ -252,10 +285,18 @@ static int attrsOk(XmlBuffer * xb, const XmlElement * e, XmlAttr * r,
       strcat(ptr, " (");
       strcat(ptr, word);
       strcat(ptr, ")");
-      Throw(xb, ptr);
+      throwParseError(xb, ptr);
     ok:;
    }
 
+   for (n = 0; (e + n)->attr; n++) {
+      if ((e + n)->required && wa[n] == 0) {
+         ptr = (char *) alloca(strlen(tag) + strlen((e + n)->attr) + 32);
+         sprintf(ptr, "Missing attribute %s for %s", (e + n)->attr, tag);
+         throwParseError(xb, ptr);
+      }
+   }
+
    if (getChars(xb, "/>")) {
       xb->eTagFound = 1;
       xb->etag = etag;
@@ -280,7 +321,7 @@ static int attrsOk(XmlBuffer * xb, const XmlElement * e, XmlAttr * r,
    strcat(ptr, word);
    strcat(ptr," ");
    strcat(ptr, tag);
-   Throw(xb, ptr);
+   throwParseError(xb, ptr);
    return -1;
 }
 
@@ -294,15 +335,80 @@ static char *getValue(XmlBuffer * xb, const char *v)
    if ((dlm = getChar(xb, '"')) || (dlm = getChar(xb, '\''))) {
       start = xb->cur;
       while (*xb->cur != dlm) {
+         if (xb->cur >= xb->last)
+            throwParseError(xb, "unterminated attribute value");
          xb->cur++;
       }
       *xb->cur = 0;
       xb->cur++;
       return start;
    }
+   throwParseError(xb, "quoted attribute value expected");
    return NULL;
 }
 
+/*
+ * attrsOk() for the tags of an instance, see ParserPlan. While a plan is
+ * replayed, attribute text equal to the recorded one is taken as is;
+ * while it is recorded, the text and value offsets are kept.
+ */
+static int planAttrsOk(ParserControl * parm, const XmlElement * e,
+                       XmlAttr * r, const char *tag, int etag)
+{
+   XmlBuffer *xb = parm->xmb;
+   ParserPlanStep *step;
+   char *start = xb->cur;
+   int n, len, off;
+
+   parm->planHit = 0;
+   if (parm->plan == NULL || parm->planMode == planOff)
+      return attrsOk(xb, e, r, tag, etag);
+
+   step = parm->plan->steps + parm->planStep;
+   len = step->attrsLen;
+   if (parm->planMode == planReplay) {
+      if (len == 0 || xb->last - start < len
+          || memcmp(start, step->attrs, len) != 0)
+         return attrsOk(xb, e, r, tag, etag);
+      for (n = 0; (e + n)->attr; n++) {
+         if ((off = step->attrOffs[2 * n]) >= 0) {
+            (r + n)->attr = start + off;
+            start[step->attrOffs[2 * n + 1]] = 0;
+         }
+      }
+      xb->cur = start + len;
+      xb->eTagFound = len > 1 && step->attrs[len - 2] == '/';
+      if (xb->eTagFound)
+         xb->etag = etag;
+      parm->planHit = 1;
+      return 1;
+   }
+
+   attrsOk(xb, e, r, tag, etag);
+   if (step->attrs == NULL) {
+      len = xb->cur - start;
+      step->attrs = (char *) parser_malloc(parm->heap, len);
+      memcpy(step->attrs, start, len);
+      for (n = 0; (e + n)->attr; n++);
+      step->attrOffs = (int *) parser_malloc(parm->heap,
+                                             (2 * n + 1) * sizeof(int));
+      for (n = 0; (e + n)->attr; n++) {
+         if ((r + n)->attr) {
+            /* put back the quote getValue() replaced by a NUL */
+            off = (r + n)->attr - start;
+            step->attrOffs[2 * n] = off;
+            step->attrOffs[2 * n + 1] = off + strlen((r + n)->attr);
+            step->attrs[step->attrOffs[2 * n + 1]] = (r + n)->attr[-1];
+         }
+         else
+            step->attrOffs[2 * n] = step->attrOffs[2 * n + 1] = -1;
+      }
+      step->attrsLen = len;
+      parm->planHit = 1;
+   }
+   return 1;
+}
+
 
 
 static char *getContent(XmlBuffer * xb)
@@ -351,16 +457,50 @@ static xmlCmpiType xmlCmpiTypes[] = {
    {"instance", CMPI_instance}
 };
 
+/*
+ * Embedded instances are received as CDATA, whatever the TYPE attribute
+ * says, so "instance" does not count here.
+ */
 CMPIType xmlToCmpiType(char *xmlTypeStr)
 {
     int i;
     if (xmlTypeStr != NULL)
         for (i = 0; i < (sizeof(xmlCmpiTypes) / sizeof(xmlCmpiType)); i++)
-            if (strcasecmp(xmlTypeStr, xmlCmpiTypes[i].str) == 0)
+            if (xmlCmpiTypes[i].type != CMPI_instance &&
+                strcasecmp(xmlTypeStr, xmlCmpiTypes[i].str) == 0)
                 return xmlCmpiTypes[i].type;
     return CMPI_null;
 }
 
+/* TYPE of an element holding plain values; references have their own */
+static CMPIType valueTypeAttr(XmlBuffer * xb, char *type, const char *tag)
+{
+   /* room for the message with a tag name cut to 32 characters */
+   char msg[sizeof("TYPE=\"reference\" not allowed for ") + 32];
+   CMPIType t = xmlToCmpiType(type);
+
+   if (t == CMPI_ref) {
+      snprintf(msg, sizeof(msg), "TYPE=\"reference\" not allowed for %.32s",
+               tag);
+      throwParseError(xb, msg);
+   }
+   return t;
+}
+
+/* valueTypeAttr() of the attributes planAttrsOk() just took */
+static CMPIType planValueType(ParserControl * parm, char *type,
+                              const char *tag)
+{
+   ParserPlanStep *step;
+
+   if (!parm->planHit)
+      return valueTypeAttr(parm->xmb, type, tag);
+   step = parm->plan->steps + parm->planStep;
+   if (parm->planMode == planRecord)
+      step->valueType = valueTypeAttr(parm->xmb, type, tag);
+   return step->valueType;
+}
+
 char * cmpiToXmlType(CMPIType cmpiType)
 {
     int i;
@@ -408,7 +548,7 @@ static int procCim(parseUnion * lvalp, ParserControl * parm)
 static int procMessage(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"ID"},
+      {"ID", 1},
       {"PROTOCOLVERSION"},
       {NULL}
    };
@@ -441,7 +581,7 @@ static int procSimpleResp(parseUnion * lvalp, ParserControl * parm)
 static int procIMethodResp(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -460,7 +600,7 @@ static int procIMethodResp(parseUnion * lvalp, ParserControl * parm)
 static int procMethodResp(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -481,7 +621,7 @@ static int procMethodResp(parseUnion * lvalp, ParserControl * parm)
 static int procErrorResp(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"CODE"},
+      {"CODE", 1},
       {"DESCRIPTION"},
       {NULL}
    };
@@ -525,6 +665,7 @@ static int procRetValue(parseUnion * lvalp, ParserControl * parm)
       int i;
       memset(attr, 0, sizeof(attr));
       if (attrsOk(parm->xmb, elm, attr, "RETURNVALUE", ZTOK_RETVALUE)) {
+         memset(&lvalp->xtokReturnValue, 0, sizeof(XtokReturnValue));
          lvalp->xtokReturnValue.type = CMPI_null;
          if (attr[0].attr) {
             lvalp->xtokReturnValue.type = xmlToCmpiType(attr[0].attr);
@@ -618,7 +759,7 @@ static int procObjectPath(parseUnion * lvalp, ParserControl * parm)
 static int procNameSpace(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -636,7 +777,7 @@ static int procNameSpace(parseUnion * lvalp, ParserControl * parm)
 static int procParamValue(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {"PARAMTYPE"},
       {"EMBEDDEDOBJECT"},
       {NULL}
@@ -647,6 +788,7 @@ static int procParamValue(parseUnion * lvalp, ParserControl * parm)
    memset(attr, 0, sizeof(attr));
    if (tagEquals(parm->xmb, "PARAMVALUE")) {
       if (attrsOk(parm->xmb, elm, attr, "PARAMVALUE", ZTOK_PARAMVALUE)) {
+         memset(&lvalp->xtokParamValue, 0, sizeof(XtokParamValue));
          lvalp->xtokParamValue.name = attr[0].attr;
          lvalp->xtokParamValue.type = CMPI_null;
          if (attr[1].attr) {
@@ -661,7 +803,7 @@ static int procParamValue(parseUnion * lvalp, ParserControl * parm)
 static int procClassName(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -679,7 +821,7 @@ static int procClassName(parseUnion * lvalp, ParserControl * parm)
 static int procInstanceName(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"CLASSNAME"},
+      {"CLASSNAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -698,14 +840,14 @@ static int procInstanceName(parseUnion * lvalp, ParserControl * parm)
 static int procKeyBinding(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
 
    memset(attr, 0, sizeof(attr));
    if (tagEquals(parm->xmb, "KEYBINDING")) {
-      if (attrsOk(parm->xmb, elm, attr, "KEYBINDING", ZTOK_KEYBINDING)) {
+      if (planAttrsOk(parm, elm, attr, "KEYBINDING", ZTOK_KEYBINDING)) {
          lvalp->xtokKeyBinding.name = attr[0].attr;
          return XTOK_KEYBINDING;
       }
@@ -716,7 +858,7 @@ static int procKeyBinding(parseUnion * lvalp, ParserControl * parm)
 static int procInstance(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"CLASSNAME"},
+      {"CLASSNAME", 1},
       {NULL}
    };
    XmlAttr attr[1];
@@ -735,7 +877,7 @@ static int procInstance(parseUnion * lvalp, ParserControl * parm)
 static int procClass(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-      {"NAME"},
+      {"NAME", 1},
       {"SUPERCLASS"},
       {NULL}
    };
@@ -766,10 +908,13 @@ static int procKeyValue(parseUnion * lvalp, ParserControl * parm)
 
    memset(attr, 0, sizeof(attr));
    if (tagEquals(parm->xmb, "KEYVALUE")) {
-      if (attrsOk(parm->xmb, elm, attr, "KEYVALUE", ZTOK_KEYVALUE)) {
+      if (planAttrsOk(parm, elm, attr, "KEYVALUE", ZTOK_KEYVALUE)) {
+         if (attr[0].attr && strcasecmp(attr[0].attr, "ref") == 0)
+            throwParseError(parm->xmb, "VALUETYPE of KEYVALUE must be "
+                            "string, boolean or numeric");
          val = getContent(parm->xmb);
          lvalp->xtokKeyValue.valueType = attr[0].attr;
-         lvalp->xtokKeyValue.value = val;
+         lvalp->xtokKeyValue.value = val ? val : "";
          return XTOK_KEYVALUE;
       }
    }
@@ -799,7 +944,7 @@ static int procValue(parseUnion * lvalp, ParserControl * parm)
    XmlAttr attr[1];
    if (tagEquals(parm->xmb, "VALUE")) {
       char *v;
-      if (attrsOk(parm->xmb, elm, attr, "VALUE", ZTOK_VALUE)) {
+      if (planAttrsOk(parm, elm, attr, "VALUE", ZTOK_VALUE)) {
          v=getContent(parm->xmb);
          lvalp->xtokValue.data.value = v;
          return XTOK_VALUE;
@@ -815,7 +960,7 @@ static int procValueArray(parseUnion * lvalp, ParserControl * parm)
    };
    XmlAttr attr[1];
    if (tagEquals(parm->xmb, "VALUE.ARRAY")) {
-      if (attrsOk(parm->xmb, elm, attr, "VALUE.ARRAY",
+      if (planAttrsOk(parm, elm, attr, "VALUE.ARRAY",
            ZTOK_VALUEARRAY)) {
          lvalp->xtokValueArray.max = 16;
          lvalp->xtokValueArray.next = 0;
@@ -921,7 +1066,7 @@ static int procValueObjectWithPath(parseUnion * lvalp, ParserControl * parm)
 
 static int procQualifier(parseUnion * lvalp, ParserControl * parm)
 {
-   static XmlElement elm[] = { {"NAME"},
+   static XmlElement elm[] = { {"NAME", 1},
    {"TYPE"},
    {"PROPAGATED"},
    {"OVERRIDABLE"},
@@ -938,7 +1083,8 @@ static int procQualifier(parseUnion * lvalp, ParserControl * parm)
       if (attrsOk(parm->xmb, elm, attr, "QUALIFIER", ZTOK_QUALIFIER)) {
          memset(&lvalp->xtokQualifier, 0, sizeof(XtokQualifier));
          lvalp->xtokQualifier.name = attr[0].attr;
-         lvalp->xtokQualifier.type = xmlToCmpiType(attr[1].attr);
+         lvalp->xtokQualifier.type = valueTypeAttr(parm->xmb, attr[1].attr,
+                                                    "QUALIFIER");
          if (attr[2].attr)
             lvalp->xtokQualifier.propagated = !strcasecmp(attr[2].attr, "true");
          if (attr[3].attr)
@@ -960,7 +1106,7 @@ static int procQualifier(parseUnion * lvalp, ParserControl * parm)
 
 static int procProperty(parseUnion * lvalp, ParserControl * parm)
 {
-   static XmlElement elm[] = { {"NAME"},
+   static XmlElement elm[] = { {"NAME", 1},
    {"TYPE"},
    {"CLASSORIGIN"},
    {"PROPAGATED"},
@@ -974,12 +1120,13 @@ static int procProperty(parseUnion * lvalp, ParserControl * parm)
    if (tagEquals(parm->xmb, "PROPERTY")) {
       attr[1].attr = NULL;
       lvalp->xtokProperty.valueType = (CMPIType) 1;
-      if (attrsOk(parm->xmb, elm, attr, "PROPERTY", ZTOK_PROPERTY)) {
+      if (planAttrsOk(parm, elm, attr, "PROPERTY", ZTOK_PROPERTY)) {
          memset(&lvalp->xtokProperty, 0, sizeof(XtokProperty));
          lvalp->xtokProperty.name = attr[0].attr;
          lvalp->xtokProperty.valueType = CMPI_null;
          if (attr[1].attr)
-            lvalp->xtokProperty.valueType = xmlToCmpiType(attr[1].attr);
+            lvalp->xtokProperty.valueType =
+                planValueType(parm, attr[1].attr, "PROPERTY");
          lvalp->xtokProperty.classOrigin = attr[2].attr;
          if (attr[3].attr)
             lvalp->xtokProperty.propagated = !strcasecmp(attr[3].attr, "true");
@@ -992,7 +1139,7 @@ static int procProperty(parseUnion * lvalp, ParserControl * parm)
 
 static int procPropertyArray(parseUnion * lvalp, ParserControl * parm)
 {
-   static XmlElement elmPA[] = { {"NAME"},
+   static XmlElement elmPA[] = { {"NAME", 1},
    {"TYPE"},
    {"CLASSORIGIN"},
    {"PROPAGATED"},
@@ -1005,12 +1152,14 @@ static int procPropertyArray(parseUnion * lvalp, ParserControl * parm)
 
    memset(attr, 0, sizeof(attr));
    if (tagEquals(parm->xmb, "PROPERTY.ARRAY")) {
-      if (attrsOk(parm->xmb, elmPA, attr, "PROPERTY.ARRAY", ZTOK_PROPERTYARRAY)) {
+      if (planAttrsOk(parm, elmPA, attr, "PROPERTY.ARRAY",
+                      ZTOK_PROPERTYARRAY)) {
          memset(&lvalp->xtokProperty, 0, sizeof(XtokProperty));
          lvalp->xtokProperty.name = attr[0].attr;
          lvalp->xtokProperty.valueType = CMPI_null;
          if (attr[1].attr)
-            lvalp->xtokProperty.valueType = xmlToCmpiType(attr[1].attr);
+            lvalp->xtokProperty.valueType =
+                planValueType(parm, attr[1].attr, "PROPERTY.ARRAY");
          lvalp->xtokProperty.classOrigin = attr[2].attr;
          if (attr[3].attr)
             lvalp->xtokProperty.propagated = !strcasecmp(attr[3].attr, "true");
@@ -1025,7 +1174,7 @@ static int procPropertyArray(parseUnion * lvalp, ParserControl * parm)
 
 static int procPropertyReference(parseUnion * lvalp, ParserControl * parm)
 {
-   static XmlElement elm[] = { {"NAME"},
+   static XmlElement elm[] = { {"NAME", 1},
    {"REFERENCECLASS"},
    {"CLASSORIGIN"},
    {"PROPAGATED"},
@@ -1036,7 +1185,8 @@ static int procPropertyReference(parseUnion * lvalp, ParserControl * parm)
    memset(attr, 0, sizeof(attr));
    if (tagEquals(parm->xmb, "PROPERTY.REFERENCE")) {
       attr[1].attr = NULL;
-      if (attrsOk(parm->xmb, elm, attr, "PROPERTY.REFERENCE", ZTOK_PROPERTYREFERENCE)) {
+      if (planAttrsOk(parm, elm, attr, "PROPERTY.REFERENCE",
+                      ZTOK_PROPERTYREFERENCE)) {
          memset(&lvalp->xtokProperty, 0, sizeof(XtokProperty));
          lvalp->xtokProperty.valueType = CMPI_ref;
          lvalp->xtokProperty.name = attr[0].attr;
@@ -1053,7 +1203,7 @@ static int procPropertyReference(parseUnion * lvalp, ParserControl * parm)
 
 static int procMethod(parseUnion * lvalp, ParserControl * parm)
 {
-   static XmlElement elm[] = { {"NAME"},
+   static XmlElement elm[] = { {"NAME", 1},
    {"TYPE"},
    {"CLASSORIGIN"},
    {"PROPAGATED"},
@@ -1083,7 +1233,7 @@ static int procMethod(parseUnion * lvalp, ParserControl * parm)
 static int procParam(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] =
-   { {"NAME"},
+   { {"NAME", 1},
      {"TYPE"},
      {NULL}
    };
@@ -1109,7 +1259,7 @@ static int procParam(parseUnion * lvalp, ParserControl * parm)
 static int procParamArray(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] =
-   { {"NAME"},
+   { {"NAME", 1},
      {"TYPE"},
      {"ARRAYSIZE"},
      {NULL}
@@ -1137,7 +1287,7 @@ static int procParamArray(parseUnion * lvalp, ParserControl * parm)
 static int procParamRef(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] =
-   { {"NAME"},
+   { {"NAME", 1},
      {"REFERENCECLASS"},
      {NULL}
    };
@@ -1161,7 +1311,7 @@ static int procParamRef(parseUnion * lvalp, ParserControl * parm)
 static int procParamRefArray(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] =
-   { {"NAME"},
+   { {"NAME", 1},
      {"REFERENCECLASS"},
      {"ARRAYSIZE"},
      {NULL}
@@ -1204,7 +1354,7 @@ static int procSimpleExpReq(parseUnion * lvalp, ParserControl * parm)
 static int procExportMethodCall(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-     {"NAME"},
+     {"NAME", 1},
       {NULL}
    };
    XmlAttr   attr[1];
@@ -1223,7 +1373,7 @@ static int procExportMethodCall(parseUnion * lvalp, ParserControl * parm)
 static int procExParamValue(parseUnion * lvalp, ParserControl * parm)
 {
    static XmlElement elm[] = {
-     {"NAME"},
+     {"NAME", 1},
       {NULL}
    };
    XmlAttr   attr[1];
@@ -1320,169 +1470,344 @@ static Tags tags[] = {
 
 #ifndef LARGE_VOL_SUPPORT
 
-int sfccLex(parseUnion * lvalp, ParserControl * parm)
+/*
+ * Returns the tag index if next is the tag the replayed plan expects,
+ * -1 otherwise. A tag that differs from the plan ends the replay for
+ * the rest of the instance.
+ */
+static int planMatch(ParserControl * parm, const char *next, int end)
+{
+   ParserPlan *p = parm->plan;
+   int s = parm->planStep + 1, i;
+   char c;
+
+   if (parm->planMode != planReplay)
+      return -1;
+   if (s < p->numSteps && (p->steps[s].tag < 0) == end) {
+      i = end ? ~p->steps[s].tag : p->steps[s].tag;
+      if (strncmp(next, tags[i].tag, tags[i].tagLen) == 0) {
+         /* stricter than nextEquals(), "VALUE" is no match for VALUE.ARRAY */
+         c = next[tags[i].tagLen];
+         if (c == '>' || c == '/' || c == 0 || isspace((unsigned char) c)) {
+            parm->planStep = s;
+            return i;
+         }
+      }
+   }
+   parm->planMode = planOff;
+   return -1;
+}
+
+/* Appends the tag found by the full lookup to the recorded plan */
+static void planAdd(ParserControl * parm, int i, int end)
 {
-   int i, rc;
+   ParserPlan *p = parm->plan;
+   ParserPlanStep *step;
+
+   if (parm->planMode != planRecord)
+      return;
+   /* CDATA is matched by the catch-all entry, which a plan cannot check */
+   if (tags[i].process == procCdata || p->numSteps == PARSER_PLAN_MAX_STEPS) {
+      parm->planMode = planOff;
+      return;
+   }
+   if (p->numSteps == p->maxSteps) {
+      p->maxSteps = p->maxSteps ? p->maxSteps * 2 : 32;
+      p->steps = (ParserPlanStep *) parser_realloc(parm->heap, p->steps,
+                                   p->maxSteps * sizeof(ParserPlanStep));
+   }
+   step = p->steps + p->numSteps;
+   memset(step, 0, sizeof(ParserPlanStep));
+   step->tag = end ? ~i : i;
+   parm->planStep = p->numSteps++;
+}
+
+/*
+ * Follows the INSTANCE and INSTANCENAME nesting of the lexed tokens. The
+ * first element of a class records a plan, the following ones replay it.
+ */
+static int planToken(ParserControl * parm, ParserToken * token)
+{
+   ParserPlan *p;
+   char *cn;
+
+   switch (token->type) {
+   case XTOK_INSTANCE:
+   case XTOK_INSTANCENAME:
+      if (parm->plan) {
+         if (token->type == parm->plan->type)
+            parm->planDepth++;
+         break;
+      }
+      cn = token->type == XTOK_INSTANCE ?
+          token->value.xtokInstance.className :
+          token->value.xtokInstanceName.className;
+      for (p = parm->plans; p; p = p->next) {
+         if (p->type == token->type && strcasecmp(p->className, cn) == 0)
+            break;
+      }
+      if (p == NULL) {
+         p = (ParserPlan *) parser_calloc(parm->heap, 1, sizeof(ParserPlan));
+         p->type = token->type;
+         p->className = (char *) parser_strdup(parm->heap, cn);
+         p->next = parm->plans;
+         parm->plans = p;
+         parm->planMode = planRecord;
+      }
+      else if (p->complete)
+         parm->planMode = planReplay;
+      else
+         parm->planMode = planOff;
+      parm->plan = p;
+      parm->planStep = -1;
+      parm->planDepth = 1;
+      break;
+   case ZTOK_INSTANCE:
+   case ZTOK_INSTANCENAME:
+      if (parm->plan == NULL
+          || (token->type == ZTOK_INSTANCE) != (parm->plan->type == XTOK_INSTANCE)
+          || --parm->planDepth)
+         break;
+      if (parm->planMode == planRecord)
+         parm->plan->complete = 1;
+      parm->plan = NULL;
+      parm->planMode = planOff;
+      break;
+   }
+   return token->type;
+}
+
+int sfccLex(ParserToken * token, ParserControl * parm)
+{
+   int i;
    char *next;
 
+   token->hasValue = 0;
    for (;;) {
       next = nextTag(parm->xmb);
       if (next == NULL) {
-         return 0;
+         return token->type = 0;
       }
 //      fprintf(stderr,"--- token: %.32s\n",next); //usefull for debugging
       if (parm->xmb->eTagFound) {
          parm->xmb->eTagFound = 0;
-         return parm->xmb->etag;
+         token->type = parm->xmb->etag;
+         return planToken(parm, token);
       }
 
       if (*next == '/') {
-         for (i = 0; i < TAGS_NITEMS; i++) {
-            if (nextEquals(next + 1, tags[i].tag, tags[i].tagLen) == 1) {
-               skipTag(parm->xmb);
-               return tags[i].etag;
+         if ((i = planMatch(parm, next + 1, 1)) < 0) {
+            for (i = 0; i < TAGS_NITEMS; i++) {
+               if (nextEquals(next + 1, tags[i].tag, tags[i].tagLen) == 1)
+                  break;
             }
+            if (i == TAGS_NITEMS)
+               break;
+            planAdd(parm, i, 1);
          }
+         skipTag(parm->xmb);
+         token->type = tags[i].etag;
+         return planToken(parm, token);
       }
 
       else {
          if (strncmp(parm->xmb->cur, "<!--", 4) == 0) {
-            parm->xmb->cur = strstr(parm->xmb->cur, "-->") + 3;
+            char *end = strstr(parm->xmb->cur, "-->");
+            if (end == NULL)
+               throwParseError(parm->xmb, "unterminated comment");
+            parm->xmb->cur = end + 3;
             continue;
          }
-         for (i = 0; i < TAGS_NITEMS; i++) {
-            if (nextEquals(next, tags[i].tag, tags[i].tagLen) == 1) {
-//	       printf("+++ %d\n",i);
-               rc=tags[i].process(lvalp, parm);
-               return rc;
+         if ((i = planMatch(parm, next, 0)) < 0) {
+            for (i = 0; i < TAGS_NITEMS; i++) {
+               if (nextEquals(next, tags[i].tag, tags[i].tagLen) == 1)
+                  break;
             }
+            if (i == TAGS_NITEMS)
+               break;
+            planAdd(parm, i, 0);
          }
+//	 printf("+++ %d\n",i);
+         token->hasValue = 1;
+         token->type = tags[i].process(&token->value, parm);
+         return planToken(parm, token);
       }
-      break;
    }
-   return 0;
+   return token->type = 0;
 }
 #endif
 
-static pthread_mutex_t scan_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-ResponseHdr scanCimXmlResponse(const char *xmlData, CMPIObjectPath *cop)
+static ResponseHdr scanXmlBuffer(XmlBuffer *xmb, CMPIObjectPath *cop,
+                                 ParserSelect *select)
 {
-
-   pthread_mutex_lock(&scan_mutex);
    ParserControl control;
 #if DEBUG
    extern int do_debug;
 
    if (do_debug)
-       fprintf(stderr,"*** CIMOM response: %s\n", xmlData);
+       fprintf(stderr,"*** CIMOM response: %s\n", xmb->base);
 #endif
 
    memset(&control,0,sizeof(control));
 
-   XmlBuffer *xmb = newXmlBuffer(xmlData);
    control.xmb = xmb;
    control.respHdr.xmlBuffer = xmb;
 
    control.respHdr.rvArray=newCMPIArray(0,0,NULL);
 
    control.requestObjectPath = cop;
+   control.select = select;
 
    control.heap = parser_heap_init();
 
    control.respHdr.rc = startParsing(&control);
 
+   releaseLayouts(&control);
    parser_heap_term(control.heap);
 
+   control.respHdr.xmlBuffer = NULL;
+   return control.respHdr;
+}
+
+ResponseHdr scanCimXmlResponse(const char *xmlData, CMPIObjectPath *cop)
+{
+   XmlBuffer *xmb = newXmlBuffer(xmlData);
+   ResponseHdr rh = scanXmlBuffer(xmb, cop, NULL);
+
    releaseXmlBuffer(xmb);
+   return rh;
+}
 
-   pthread_mutex_unlock(&scan_mutex);
+/*
+ * Like scanCimXmlResponse(), but parses xmlData where it is instead of
+ * working on a copy. The parser modifies xmlData, which must be NUL
+ * terminated. Exported instances not chosen by select are skipped.
+ */
+ResponseHdr scanCimXmlResponseInPlace(char *xmlData, CMPIObjectPath *cop,
+                                      ParserSelect *select)
+{
+   XmlBuffer xmb;
 
-   return control.respHdr;
+   memset(&xmb, 0, sizeof(xmb));
+   xmb.base = xmb.cur = xmlData;
+   xmb.last = xmlData + strlen(xmlData);
+   return scanXmlBuffer(&xmb, cop, select);
 }
 
-#define PARSER_HEAP_INCREMENT 100
+#define PARSER_HEAP_CHUNK 2048
+#define PARSER_HEAP_MAX_CHUNK (1024 * 1024)
+
+/* each block is preceded by its size, which parser_realloc() needs */
+#define PARSER_HEAP_ALIGN(sz) (((sz) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
 
 ParserHeap* parser_heap_init()
 {
-  return calloc(1,sizeof(ParserHeap));
-}
+  /* the first chunk is allocated with the heap */
+  ParserHeap *ph = malloc(sizeof(ParserHeap) + PARSER_HEAP_CHUNK);
 
-void parser_heap_term(ParserHeap* ph)
-{
-  int i;
   if (ph) {
-    for (i=ph->numBlocks - 1; i >= 0; i--) {
-      void * blk = ph->blocks[i];
-      if (blk != NULL)
-	  free(ph->blocks[i]);
-    }
-    free(ph->blocks);
-    free(ph);
+    ph->cur = (char*)(ph + 1);
+    ph->end = ph->cur + PARSER_HEAP_CHUNK;
+    ph->chunkSize = PARSER_HEAP_CHUNK * 2;
+    ph->chunks = NULL;
   }
+  return ph;
 }
 
-static int parser_heap_grow(ParserHeap *ph)
+void parser_heap_term(ParserHeap* ph)
 {
+  ParserHeapChunk *c, *next;
+
   if (ph) {
-    if (ph->numBlocks >= ph->capacity) {
-      ph->blocks = realloc(ph->blocks,
-			   sizeof(void*)*(ph->capacity+PARSER_HEAP_INCREMENT));
-      if (ph->blocks) {
-	ph->capacity += PARSER_HEAP_INCREMENT;
-      } else {
-	return -1;
-      }
+    for (c = ph->chunks; c; c = next) {
+      next = c->next;
+      free(c);
     }
-    ph->numBlocks += 1; 
-    return ph->numBlocks - 1;
-  } else {
-    return -1;
+    free(ph);
   }
 }
 
 void* parser_malloc(ParserHeap *ph, size_t sz)
 {
-  int idx = parser_heap_grow(ph);
-  if (idx >= 0) {
-    return (ph->blocks[idx]=malloc(sz));
-  } else {
+  size_t need = sizeof(size_t) + PARSER_HEAP_ALIGN(sz);
+  size_t size;
+  ParserHeapChunk *c;
+  char *p;
+
+  if (ph == NULL) {
     return NULL;
   }
+  if ((size_t) (ph->end - ph->cur) < need) {
+    /* large blocks get a chunk of their own, keeping the current one */
+    size = ph->chunkSize;
+    if (need > size / 4) {
+      size = need;
+    }
+    c = malloc(PARSER_HEAP_ALIGN(sizeof(ParserHeapChunk)) + size);
+    if (c == NULL) {
+      return NULL;
+    }
+    c->next = ph->chunks;
+    ph->chunks = c;
+    p = (char*)c + PARSER_HEAP_ALIGN(sizeof(ParserHeapChunk));
+    if (size == need) {
+      *(size_t*)p = sz;
+      return p + sizeof(size_t);
+    }
+    ph->cur = p;
+    ph->end = p + size;
+    if (ph->chunkSize < PARSER_HEAP_MAX_CHUNK) {
+      ph->chunkSize *= 2;
+    }
+  }
+  p = ph->cur;
+  ph->cur += need;
+  *(size_t*)p = sz;
+  return p + sizeof(size_t);
 }
 
 void* parser_calloc(ParserHeap *ph, size_t num, size_t sz)
 {
-  int idx = parser_heap_grow(ph);
-  if (idx >= 0) {
-    return (ph->blocks[idx]=calloc(num,sz));
-  } else {
-    return NULL;
+  void *p = parser_malloc(ph, num * sz);
+
+  if (p) {
+    memset(p, 0, num * sz);
   }
+  return p;
 }
 
 void* parser_realloc(ParserHeap *ph, void *p, size_t sz)
 {
-   int i;
-   for (i=ph->numBlocks - 1; i >= 0; i--) 
-      if(ph->blocks[i]==p) ph->blocks[i]=NULL;
+  size_t old;
+  void *n;
 
-  int idx = parser_heap_grow(ph);
-  if (idx >= 0) {
-    return (ph->blocks[idx]=realloc(p,sz));
-  } else {
-    return NULL;
+  if (p == NULL) {
+    return parser_malloc(ph, sz);
+  }
+  old = ((size_t*)p)[-1];
+  /* the last block grows in place */
+  if ((char*)p + PARSER_HEAP_ALIGN(old) == ph->cur &&
+      (size_t) (ph->end - (char*)p) >= PARSER_HEAP_ALIGN(sz)) {
+    ph->cur = (char*)p + PARSER_HEAP_ALIGN(sz);
+    ((size_t*)p)[-1] = sz;
+    return p;
   }
+  n = parser_malloc(ph, sz);
+  if (n) {
+    memcpy(n, p, old < sz ? old : sz);
+  }
+  return n;
 }
 
 void* parser_strdup(ParserHeap *ph, const char *s)
 {
-  int idx = parser_heap_grow(ph);
-  if (idx >= 0) {
-    return (ph->blocks[idx]=strdup(s));
-  } else {
-    return NULL;
+  size_t len = strlen(s) + 1;
+  char *p = parser_malloc(ph, len);
+
+  if (p) {
+    memcpy(p, s, len);
   }
+  return p;
 }
 
 #if LARGE_VOL_SUPPORT
@@ -1552,6 +1877,8 @@ void * enumScanThrd(struct native_enum *NatEnum)
    }
        
    control.respHdr.rc = startParsing(&control);
+
+   releaseLayouts(&control);
      
    /*
     * releaseXmlBuffer free's that last con->asynRCntl.escanInfo.section 
@@ -1567,12 +1894,13 @@ void * enumScanThrd(struct native_enum *NatEnum)
     
 }
 
-int sfccLex(parseUnion * lvalp, ParserControl * parm)
+int sfccLex(ParserToken * token, ParserControl * parm)
 {
    int i, rc;
    char *next;
    char *nextSection ;
 
+   token->hasValue = 0;
    for (;;) {
    	
    	  if(parm->econ) {
@@ -1594,19 +1922,19 @@ int sfccLex(parseUnion * lvalp, ParserControl * parm)
       
       next = nextTag(parm->xmb);
       if (next == NULL) {
-         return 0;
+         return token->type = 0;
       }
 //      fprintf(stderr,"--- token: %.32s\n",next); //usefull for debugging
       if (parm->xmb->eTagFound) {
          parm->xmb->eTagFound = 0;
-         return parm->xmb->etag;
+         return token->type = parm->xmb->etag;
       }
 
       if (*next == '/') {
          for (i = 0; i < TAGS_NITEMS; i++) {
             if (nextEquals(next + 1, tags[i].tag, tags[i].tagLen) == 1) {
                skipTag(parm->xmb);
-               return tags[i].etag;
+               return token->type = tags[i].etag;
             }
          }
       }
@@ -1624,14 +1952,15 @@ int sfccLex(parseUnion * lvalp, ParserControl * parm)
          for (i = 0; i < TAGS_NITEMS; i++) {
             if (nextEquals(next, tags[i].tag, tags[i].tagLen) == 1) {
 //	       printf("+++ %d\n",i);
-               rc=tags[i].process(lvalp, parm);
-               return rc;
+               token->hasValue = 1;
+               rc=tags[i].process(&token->value, parm);
+               return token->type = rc;
             }
          }
       }
       break;
    }
-   return 0;
+   return token->type = 0;
 }
 
 char * getNextSection(struct _CMCIConnection * con)
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <setjmp.h>
 
 #include "cmcidt.h"
 #include "cmcift.h"
@@ -65,10 +66,13 @@ typedef struct xmlBuffer {
    char eTagFound;
    int etag;
    char nulledChar;
+   jmp_buf *errorJump;          /* where throwParseError() returns to */
+   char *errorText;             /* set by throwParseError() */
 } XmlBuffer;
 
 typedef struct xmlElement {
    char *attr;
+   int required;                /* attrsOk() rejects the tag without it */
 } XmlElement;
 
 typedef struct xmlAttr {
@@ -417,21 +421,35 @@ typedef struct responseHdr {
 } ResponseHdr;
 
 
+/*
+ * Memory for the tokens of one response. Allocations are carved from a
+ * few chunks, which parser_heap_term() frees at once.
+ */
+typedef struct parser_heap_chunk {
+  struct parser_heap_chunk *next;
+} ParserHeapChunk;
+
 typedef struct parser_heap {
-  size_t  capacity;
-  size_t  numBlocks;
-  void  **blocks;
+  char   *cur, *end;            /* free space in the current chunk */
+  size_t  chunkSize;            /* of the next chunk */
+  ParserHeapChunk *chunks;      /* all but the one allocated with the heap */
 } ParserHeap;
- 
-typedef struct parser_control {
-   XmlBuffer *xmb;
-   ResponseHdr respHdr;
-   CMPIObjectPath *requestObjectPath;
-   ParserHeap *heap;
-#ifdef LARGE_VOL_SUPPORT
-   CMCIConnection * econ ; /* enumeration connection */
-#endif
-} ParserControl;
+
+typedef struct parser_layout {
+   char *className;
+   struct native_layout *layout;
+} ParserLayout;
+
+/*
+ * Lets the caller of scanCimXmlResponseInPlace() choose the exported
+ * instances to build and the properties to build them with, see
+ * selectProperties()
+ */
+typedef struct parser_select {
+   int (*match)(struct parser_select *sel, const char *className,
+                XtokProperties *ps);   /* 0 skips */
+   char **propertyList;     /* NULL terminated, NULL for all properties */
+} ParserSelect;
 
 
 /* Tokens.  */
@@ -584,6 +602,79 @@ typedef union parseUnion
    XtokSimpleRespContent         xtokSimpleRespContent;
 } parseUnion;
 
+/*
+ * A token read by sfccLex(). Start tags fill in the value, end tags
+ * leave it alone.
+ */
+typedef struct parser_token {
+   int type;                /* XTOK_ or ZTOK_ value, 0 at the end */
+   int hasValue;            /* value not yet handed to the grammar */
+   parseUnion value;
+} ParserToken;
+
+#define PARSER_LOOKAHEAD 4  /* tokens in the ring, a power of 2 */
+
+/*
+ * One tag of an instance as sfccLex() saw it, see ParserPlan. attrs
+ * holds the raw attribute list up to and including the closing > or />,
+ * attrOffs the start and end offsets of each attribute value in it, -1
+ * for an attribute that was not given.
+ */
+typedef struct parser_plan_step {
+   int tag;                 /* index in tags[], ~index for an end tag */
+   int attrsLen;            /* 0 if the attributes were not recorded */
+   char *attrs;
+   int *attrOffs;
+   CMPIType valueType;      /* TYPE of a PROPERTY or PROPERTY.ARRAY */
+} ParserPlanStep;
+
+/*
+ * The tags of the first instance (or instance name) of a class in a
+ * response. The following ones of that class are lexed by checking for
+ * the expected tag and attribute text only, falling back to the full
+ * tag lookup at the first difference.
+ */
+typedef struct parser_plan {
+   struct parser_plan *next;
+   int type;                /* XTOK_INSTANCE or XTOK_INSTANCENAME */
+   char *className;
+   int complete;            /* recorded up to </INSTANCE> */
+   int numSteps, maxSteps;
+   ParserPlanStep *steps;
+} ParserPlan;
+
+#define PARSER_PLAN_MAX_STEPS 4096
+
+typedef enum parserPlanMode {
+   planOff,
+   planRecord,
+   planReplay
+} ParserPlanMode;
+
+typedef struct parser_control {
+   XmlBuffer *xmb;
+   ResponseHdr respHdr;
+   CMPIObjectPath *requestObjectPath;
+   ParserHeap *heap;
+   ParserLayout *layouts;   /* class layouts shared by the parsed instances */
+   int numLayouts;
+   ParserSelect *select;    /* exported instances wanted, NULL for all */
+   ParserToken tokens[PARSER_LOOKAHEAD];  /* lexed tokens, see grammar.c */
+   unsigned tokenCur;       /* token the grammar is looking at */
+   unsigned tokenNext;      /* token the grammar gets next */
+   unsigned tokenEnd;       /* one past the last lexed token */
+   int ct;                  /* type of the token at tokenCur */
+   ParserPlan *plans;       /* instance plans, on heap */
+   ParserPlan *plan;        /* plan of the instance being lexed */
+   ParserPlanMode planMode;
+   int planStep;            /* last step matched or recorded */
+   int planDepth;           /* INSTANCE nesting within plan */
+   int planHit;             /* attributes of planStep taken or recorded */
+#ifdef LARGE_VOL_SUPPORT
+   CMCIConnection * econ ; /* enumeration connection */
+#endif
+} ParserControl;
+
 
 ParserHeap* parser_heap_init();
 void parser_heap_term(ParserHeap* ph);
@@ -593,8 +684,12 @@ void* parser_realloc(ParserHeap *ph, void *p, size_t sz);
 void* parser_strdup(ParserHeap *ph, const char *s);
 
 extern ResponseHdr scanCimXmlResponse(const char *xmlData, CMPIObjectPath *cop);
+extern ResponseHdr scanCimXmlResponseInPlace(char *xmlData, CMPIObjectPath *cop,
+                                             ParserSelect *select);
 extern void freeCimXmlResponse(ResponseHdr * hdr);
-extern int sfccLex(parseUnion * lvalp, ParserControl * parm);
+extern int sfccLex(ParserToken * token, ParserControl * parm);
+extern int startParsing(ParserControl * parm);
+extern void throwParseError(XmlBuffer * xb, const char *msg);
 
 #ifdef __cplusplus
  }
@@ -117,8 +117,8 @@ static void addXmlReference(UtilStringBuffer *sb, CMPIObjectPath * cop);
 extern UtilList *getNameSpaceComponents(CMPIObjectPath * cop);
 extern void pathToXml(UtilStringBuffer *sb, CMPIObjectPath *cop);
 extern char *value2Chars(CMPIType type, CMPIValue * value);
-extern char *pathToChars(CMPIObjectPath * cop, CMPIStatus * rc, char *str,
-								 int uri);
+extern void value2StringBuffer(UtilStringBuffer *sb, CMPIType type, CMPIValue * value);
+extern const char *getPathChars(CMPIObjectPath * cop, int uri);
 char * cmpiToXmlType(CMPIType cmpiType);
 
 #if DEBUG
@@ -351,6 +351,7 @@ static CMPIStatus releaseConnection(CMCIConnection *con)
   if (con->mBody) CMRelease(con->mBody);
   if (con->mUri) CMRelease(con->mUri);
   if (con->mUserPass) CMRelease(con->mUserPass);
+  if (con->mCimObject) CMRelease(con->mCimObject);
   if (con->mResponse) CMRelease(con->mResponse);
   if (con->mStatus.msg) CMRelease(con->mStatus.msg);
 
@@ -387,7 +388,7 @@ static char* genRequest(ClientEnc *cle, const char *op,
    CMCIClientData   *cld = &cle->data;
    UtilList 	    *nsc;
    char		    method[256]    = "CIMMethod: ";
-   char		    CimObject[512] = "CIMObject: ";
+   UtilStringBuffer *CimObject     = con->mCimObject;
    char		    *nsp;
 
    if (!con->mHandle) return "Unable to initialize curl interface.";
@@ -465,20 +466,23 @@ static char* genRequest(ClientEnc *cle, const char *op,
    con->mHeaders = curl_slist_append(con->mHeaders, method);
 
    // Add CIMObject header with cop's namespace, class, keys
+   CimObject->ft->reset(CimObject);
+   CimObject->ft->appendChars(CimObject, "CIMObject: ");
    if (classWithKeys)
-       pathToChars(cop, NULL, &CimObject[11], 1);
+       CimObject->ft->appendChars(CimObject, getPathChars(cop, 1));
    else {
        nsc = getNameSpaceComponents(cop);
        nsp = nsc->ft->getFirst(nsc);
        while (nsp != NULL) {
-	   strcat(CimObject, nsp);
+	   CimObject->ft->appendChars(CimObject, nsp);
 	   free(nsp); /* VM: freeing strdup'ed memory - should be part of release */
            if ((nsp = nsc->ft->getNext(nsc)) != NULL)
-	       strcat(CimObject, "%2F");
+	       CimObject->ft->appendChars(CimObject, "%2F");
        }
        CMRelease(nsc);
    }
-   con->mHeaders = curl_slist_append(con->mHeaders, CimObject);
+   con->mHeaders = curl_slist_append(con->mHeaders,
+				     CimObject->ft->getCharPtr(CimObject));
 
    // Set all of the headers for the request
    curl_easy_setopt(con->mHandle, CURLOPT_HTTPHEADER, con->mHeaders);
@@ -592,6 +596,7 @@ CMCIConnection *initConnection(CMCIClientData *cld)
    c->mBody = UtilFactory->newStringBuffer(256);
    c->mUri = UtilFactory->newStringBuffer(256);
    c->mUserPass = UtilFactory->newStringBuffer(64);
+   c->mCimObject = UtilFactory->newStringBuffer(256);
    c->mResponse = UtilFactory->newStringBuffer(2048);
 
    return c;
@@ -615,9 +620,16 @@ static const XmlSpecialChar XmlEscapes[] = {
 #define LargestXmlEscapeSize 6 /* From above */
 #define SizeofXmlEscapes (sizeof(XmlEscapes)/sizeof(XmlSpecialChar))
 
+/* 1 + index in XmlEscapes of each character, 0 if it needs no escape */
+static const unsigned char XmlEscapeIndex[256] = {
+     [0x22] = 1, [0x26] = 2, [0x27] = 3, [0x3c] = 4, [0x3e] = 5
+};
+
 char XmlToAscii(char **XmlStr);
 char * XmlToAsciiStr(char *XmlStr);
+char * XmlToAsciiStrInPlace(char *XmlStr);
 char * AsciiToXmlStr(char *Ap);
+void AsciiToXmlStringBuffer(UtilStringBuffer *sb, const char *AsciiStr);
 
 char XmlToAscii(char **XmlStr)
 {
@@ -641,55 +653,94 @@ char XmlToAscii(char **XmlStr)
 
 char * XmlToAsciiStr(char *XmlStr)
 {
-    char *AsciiStr = malloc(strlen(XmlStr) + 1); /* assume ascii <= xml len */
-    char *Ap = AsciiStr;
-    char *Xp = XmlStr;
+    if (XmlStr == NULL)                  /* empty VALUE element */
+        return NULL;
+    return XmlToAsciiStrInPlace(strdup(XmlStr));
+}
+
+/*
+ * Decodes the entities of XmlStr where it is, the text only gets
+ * shorter. Text without an '&' is not written to.
+ */
+char * XmlToAsciiStrInPlace(char *XmlStr)
+{
+    char *Ap, *Xp;
+
+    if (XmlStr == NULL || (Xp = strchr(XmlStr, '&')) == NULL)
+        return XmlStr;
+    Ap = Xp;
     while (*Xp != '\0')
     {
         *Ap++ = XmlToAscii(&Xp);
     }
     *Ap = '\0';
-    return AsciiStr;
+    return XmlStr;
 }
 
 char * AsciiToXmlStr(char *AsciiStr)
 {
-    char *Ap = NULL;
-    char *XmlStr = NULL; 
-    int  Xlen;
-    int  i;
-    int buflen;
-    if (AsciiStr) {
-      buflen = strlen(AsciiStr) + 1;
-      XmlStr = malloc(buflen);
-    }
-    if (XmlStr) {
-        Xlen = 0;
-        for (Ap = AsciiStr; *Ap != '\0'; Ap++)
-        {
-            for (i = 0; i < SizeofXmlEscapes; ++i)
-                if (*Ap == XmlEscapes[i].XmlAscii)
-                    break;
-
-            if (buflen <= Xlen + LargestXmlEscapeSize) {
-                buflen = 2 * buflen;
-                XmlStr = realloc(XmlStr,buflen);
-                if (XmlStr == NULL) {
-                    return NULL;
-                }
-            }
+    UtilStringBuffer *sb;
+    char *XmlStr;
+
+    if (AsciiStr == NULL)
+        return NULL;
+    sb = UtilFactory->newStringBuffer(strlen(AsciiStr) + 1);
+    AsciiToXmlStringBuffer(sb, AsciiStr);
+    XmlStr = (char *) sb->hdl;          /* taken over from sb */
+    sb->hdl = NULL;
+    sb->ft->release(sb);
+    return XmlStr;
+}
+
+/*
+ * Appends AsciiStr to sb with the XmlEscapes characters escaped. Text
+ * is copied to a local buffer a character at a time until a run of 16
+ * needs no escape; the rest of such a run is found by strcspn(), which
+ * goes a vector at a time, and appended straight from AsciiStr. A
+ * string without escapes thus takes a single appendBlock().
+ */
+void AsciiToXmlStringBuffer(UtilStringBuffer *sb, const char *AsciiStr)
+{
+    char buf[256];
+    const char *e;
+    size_t n, len = 0;
+    unsigned char c;
 
-            if (i < SizeofXmlEscapes)
+    for (;;)
+    {
+        if (len > sizeof(buf) - 16 - LargestXmlEscapeSize)
+        {
+            sb->ft->appendBlock(sb, buf, len);
+            len = 0;
+        }
+        for (n = 0; n < 16; n++)
+        {
+            c = AsciiStr[n];
+            if (c == 0 || XmlEscapeIndex[c])
+                break;
+            buf[len + n] = c;
+        }
+        len += n;
+        AsciiStr += n;
+        if (n == 16)
+        {
+            n = strcspn(AsciiStr, "\"&'<>");
+            if (n)
             {
-                memcpy(XmlStr + Xlen, XmlEscapes[i].XmlEscape, XmlEscapes[i].XmlEscapeSize);
-                Xlen += XmlEscapes[i].XmlEscapeSize;
+                sb->ft->appendBlock(sb, buf, len);
+                sb->ft->appendBlock(sb, (void *) AsciiStr, n);
+                len = 0;
+                AsciiStr += n;
             }
-            else
-                XmlStr[Xlen++] = *Ap;
         }
-        XmlStr[Xlen] = '\0';
+        if ((c = *AsciiStr) == 0)
+            break;
+        for (e = XmlEscapes[XmlEscapeIndex[c] - 1].XmlEscape; *e; e++)
+            buf[len++] = *e;
+        AsciiStr++;
     }
-    return XmlStr;
+    if (len)
+        sb->ft->appendBlock(sb, buf, len);
 }
 
 /*--------------------------------------------------------------------------*/
@@ -729,6 +780,54 @@ static inline void emitdeep(UtilStringBuffer *sb, int f)
 
 /* --------------------------------------------------------------------------*/
 
+static void addXmlValueChars(UtilStringBuffer *sb, CMPIType type, CMPIValue *value)
+{
+    char *cv;
+
+    if (type == CMPI_string || type == CMPI_chars)
+    {
+        if (type == CMPI_string)
+            cv = value->string ? (char *) value->string->hdl : "NULL";
+        else
+            cv = value->chars ? value->chars : "NULL";
+        AsciiToXmlStringBuffer(sb, cv);
+    }
+    else value2StringBuffer(sb, type, value);
+}
+
+/*
+ * Appends the VALUEs of n octets, taken from a packed uint8 array,
+ * formatted in a local buffer.
+ */
+static void addXmlOctets(UtilStringBuffer *sb, const unsigned char *octets,
+                         int n)
+{
+    static const char head[] = "<VALUE>", tail[] = "</VALUE>\n";
+    char buf[512], *p = buf;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        unsigned char o = octets[i];
+
+        if (p - buf > sizeof(buf) - 32)
+        {
+            sb->ft->appendBlock(sb, buf, p - buf);
+            p = buf;
+        }
+        memcpy(p, head, sizeof(head) - 1);
+        p += sizeof(head) - 1;
+        if (o >= 100)
+            *p++ = '0' + o / 100;
+        if (o >= 10)
+            *p++ = '0' + o / 10 % 10;
+        *p++ = '0' + o % 10;
+        memcpy(p, tail, sizeof(tail) - 1);
+        p += sizeof(tail) - 1;
+    }
+    sb->ft->appendBlock(sb, buf, p - buf);
+}
+
 static void addXmlValue(UtilStringBuffer *sb, 
                         char *ContainerTag,
                         char *ContainerType,
@@ -739,11 +838,9 @@ static void addXmlValue(UtilStringBuffer *sb,
     char      *arrayStr   = isArray ? ".ARRAY" : "";
     CMPIType  valtyp      = data.type & ~CMPI_ARRAY; 
     char      *xmlTypeStr = cmpiToXmlType(valtyp);
-    char      *cv;
-    int       i, n;
+    int       i, n = isArray ? CMGetArrayCount(data.value.array, NULL) : 0;
     /* If empty data item, skip out without outputting */
-    if ((data.state & CMPI_nullValue) ||
-        (isArray && (n = CMGetArrayCount(data.value.array, NULL)) == 0) )
+    if ((data.state & CMPI_nullValue) || (isArray && n == 0))
     {
         return;
     }
@@ -762,19 +859,18 @@ static void addXmlValue(UtilStringBuffer *sb,
     if (isArray)
     {
         CMPIArray *arr   = data.value.array;
+        CMPICount count  = 0;
+        const unsigned char *octets = valtyp == CMPI_uint8 ?
+            native_array_packed(arr, &count, NULL) : NULL;
         sb->ft->appendChars(sb, "<VALUE.ARRAY>\n");
-        for (i = 0; i < n; ++i)
+        if (octets)
+            addXmlOctets(sb, octets, count);
+        else for (i = 0; i < n; ++i)
         {
             CMPIData ele = CMGetArrayElementAt(arr, i, NULL);
-            cv = value2Chars(valtyp, &ele.value);
-            if (valtyp == CMPI_string || valtyp == CMPI_chars)
-            {
-                char *xmlValStr  = AsciiToXmlStr(cv);
-                if (cv) free(cv);
-                cv = xmlValStr;
-            }
-            sb->ft->append3Chars(sb, "<VALUE>", cv, "</VALUE>\n");
-            free (cv);
+            sb->ft->appendChars(sb, "<VALUE>");
+            addXmlValueChars(sb, valtyp, &ele.value);
+            sb->ft->appendChars(sb, "</VALUE>\n");
         }
         sb->ft->appendChars(sb, "</VALUE.ARRAY>\n");
     }
@@ -784,15 +880,9 @@ static void addXmlValue(UtilStringBuffer *sb,
     }
     else 
     {
-        cv = value2Chars(valtyp, &(data.value));
-        if (valtyp == CMPI_string || valtyp == CMPI_chars)
-        {
-            char *xmlValStr  = AsciiToXmlStr(cv);
-            if (cv) free(cv);
-            cv = xmlValStr;
-        }
-        sb->ft->append3Chars(sb, "<VALUE>", cv, "</VALUE>\n");
-        free(cv);
+        sb->ft->appendChars(sb, "<VALUE>");
+        addXmlValueChars(sb, valtyp, &(data.value));
+        sb->ft->appendChars(sb, "</VALUE>\n");
     }
     if(strcasecmp(ContainerTag, "PARAMVALUE")) {
     	sb->ft->append5Chars(sb, "</", ContainerTag, arrayStr, ">", "\n");
@@ -1058,6 +1148,25 @@ static CMPIStatus releaseClient(CMCIClient * mb)
   return rc;
 }
 
+/*
+ * Parses the response to an enumeration request. With CMPI_FLAG_ArenaResult
+ * the objects of the result are allocated from a new arena, which is to be
+ * handed over to the enumeration, or released if the request failed.
+ */
+static ResponseHdr scanEnumResponse(CMCIConnection *con, CMPIObjectPath *cop,
+                                    CMPIFlags flags,
+                                    struct native_arena **arena)
+{
+   struct native_arena *prev;
+   ResponseHdr rh;
+
+   *arena = (flags & CMPI_FLAG_ArenaResult) ? native_new_arena() : NULL;
+   prev = native_use_arena(*arena);
+   rh = scanCimXmlResponse(CMGetCharPtr(con->mResponse), cop);
+   native_use_arena(prev);
+   return rh;
+}
+
 #ifndef LARGE_VOL_SUPPORT
 
 /* --------------------------------------------------------------------------*/
@@ -1666,6 +1775,7 @@ static CMPIEnumeration * enumInstances(
     char             *error;
     ResponseHdr	     rh;
     CMPIEnumeration   *retval;
+    struct native_arena *arena;
 
     START_TIMING(EnumerateInstances);
     SET_DEBUG();
@@ -1710,12 +1820,13 @@ static CMPIEnumeration * enumInstances(
 
     CMRelease(sb);
 
-    rh = scanCimXmlResponse(CMGetCharPtr(con->mResponse), cop);
+    rh = scanEnumResponse(con, cop, flags, &arena);
 
     if (rh.errCode != 0) {
         CMSetStatusWithChars(rc, rh.errCode, rh.description);
         free(rh.description);
         CMRelease(rh.rvArray);
+        native_release_arena(arena);
         END_TIMING(_T_FAILED);
         return NULL;
     }
@@ -1727,7 +1838,7 @@ static CMPIEnumeration * enumInstances(
 #endif
 
     CMSetStatus(rc, CMPI_RC_OK);
-    retval = newCMPIEnumeration(rh.rvArray, NULL);
+    retval = native_new_CMPIEnumeration_fromArena(rh.rvArray, arena, NULL);
     END_TIMING(_T_GOOD);
     return retval;
 }
@@ -1784,6 +1895,7 @@ static CMPIEnumeration * associators(
    UtilStringBuffer	*sb = UtilFactory->newStringBuffer(2048);
    char			*error;
    CMPIEnumeration      *retval;
+   struct native_arena  *arena;
 
    START_TIMING(Associators);
    SET_DEBUG();
@@ -1852,12 +1964,13 @@ static CMPIEnumeration * associators(
 
    CMRelease(sb);
 
-   ResponseHdr rh=scanCimXmlResponse(CMGetCharPtr(con->mResponse),cop);
+   ResponseHdr rh = scanEnumResponse(con, cop, flags, &arena);
 
    if (rh.errCode != 0) {
       CMSetStatusWithChars(rc, rh.errCode, rh.description);
       free(rh.description);
       CMRelease(rh.rvArray);
+      native_release_arena(arena);
       END_TIMING(_T_FAILED);
       return NULL;
    }
@@ -1869,7 +1982,7 @@ static CMPIEnumeration * associators(
 #endif
 
    CMSetStatus(rc, CMPI_RC_OK);
-   retval = newCMPIEnumeration(rh.rvArray, NULL);
+   retval = native_new_CMPIEnumeration_fromArena(rh.rvArray, arena, NULL);
    END_TIMING(_T_GOOD);
    return retval;
 }
@@ -2017,6 +2130,7 @@ static CMPIEnumeration * references(
    UtilStringBuffer	*sb = UtilFactory->newStringBuffer(2048);
    char			*error;
    CMPIEnumeration      *retval;
+   struct native_arena  *arena;
 
    START_TIMING(References);
    SET_DEBUG();
@@ -2072,12 +2186,13 @@ static CMPIEnumeration * references(
 
    CMRelease(sb);
 
-   ResponseHdr rh=scanCimXmlResponse(CMGetCharPtr(con->mResponse),cop);
+   ResponseHdr rh = scanEnumResponse(con, cop, flags, &arena);
 
    if (rh.errCode!=0) {
       CMSetStatusWithChars(rc,rh.errCode,rh.description);
       free(rh.description);
       CMRelease(rh.rvArray);
+      native_release_arena(arena);
       END_TIMING(_T_FAILED);
       return NULL;
    }
@@ -2089,7 +2204,7 @@ static CMPIEnumeration * references(
 #endif
 
    CMSetStatus(rc,CMPI_RC_OK);
-   retval = newCMPIEnumeration(rh.rvArray, NULL);
+   retval = native_new_CMPIEnumeration_fromArena(rh.rvArray, arena, NULL);
    END_TIMING(_T_GOOD);
    return retval;
 }
@@ -2449,7 +2564,6 @@ static CMPIStatus setProperty(
    ResponseHdr      rh;
    CMPIString	    *cn;
    CMPIStatus	    rc = {CMPI_RC_OK, NULL};
-   char             *cv;
 
    START_TIMING(SetProperty);
    SET_DEBUG();
@@ -2467,10 +2581,9 @@ static CMPIStatus setProperty(
         name, "</VALUE>\n</IPARAMVALUE>");
 
    /* Add the new value */
-   sb->ft->append3Chars(sb,
-        "<IPARAMVALUE NAME=\"NewValue\">\n<VALUE>",
-        cv=value2Chars(type,value), "</VALUE>\n</IPARAMVALUE>");
-   if(cv) free(cv);
+   sb->ft->appendChars(sb, "<IPARAMVALUE NAME=\"NewValue\">\n<VALUE>");
+   addXmlValueChars(sb, type, value);
+   sb->ft->appendChars(sb, "</VALUE>\n</IPARAMVALUE>");
 
    /* Add the objectpath */
    cn = cop->ft->getClassName(cop,NULL);
@@ -2810,6 +2923,7 @@ static CMPIEnumeration * enumClasses(
    char             *error;
    CMPIEnumeration  *retval;
    ResponseHdr	     rh;
+   struct native_arena *arena;
 
    START_TIMING(EnumerateClasses);
    SET_DEBUG();
@@ -2850,12 +2964,13 @@ static CMPIEnumeration * enumClasses(
 
    CMRelease(sb);
 
-   rh = scanCimXmlResponse(CMGetCharPtr(con->mResponse), cop);
+   rh = scanEnumResponse(con, cop, flags, &arena);
 
    if (rh.errCode != 0) {
       CMSetStatusWithChars(rc, rh.errCode, rh.description);
       free(rh.description);
       CMRelease(rh.rvArray);
+      native_release_arena(arena);
       END_TIMING(_T_FAILED);
       return NULL;
    }
@@ -2867,7 +2982,7 @@ static CMPIEnumeration * enumClasses(
 #endif
 
    CMSetStatus(rc, CMPI_RC_OK);
-   retval = newCMPIEnumeration(rh.rvArray, NULL);
+   retval = native_new_CMPIEnumeration_fromArena(rh.rvArray, arena, NULL);
    END_TIMING(_T_GOOD);
 
    return retval;
@@ -3014,8 +3129,20 @@ static CIMCIndicationListener *newIndicationListener (CIMCEnv* ce,
                                                       void (*fp) (CIMCInstance *indInstance),
                                                       CIMCStatus *rc)
 {
-   /* socket name not required, cimxml/tcpip mode */
-   return newCIMCIndicationListener(sslMode, portNumber, fp, rc);
+   /* a socket name selects a UNIX socket instead of tcpip port */
+   return newCIMCIndicationListener(sslMode, portNumber,
+                                    socketName ? *socketName : NULL, fp, rc);
+}
+
+static CIMCUint64 hashObjectPath(CIMCEnv* ce, const CIMCObjectPath *op)
+{
+  return hashCMPIObjectPath((CMPIObjectPath*)op);
+}
+
+static int sameObjectPath(CIMCEnv* ce, const CIMCObjectPath *op1,
+                          const CIMCObjectPath *op2)
+{
+  return sameCMPIObjectPath((CMPIObjectPath*)op1, (CMPIObjectPath*)op2);
 }
 
 static CIMCEnvFT localFT = {
@@ -3032,6 +3159,8 @@ static CIMCEnvFT localFT = {
   newDateTimeFromBinary,
   newDateTimeFromChars,
   newIndicationListener,
+  hashObjectPath,
+  sameObjectPath,
 };
 
 /* Factory function for CIMXML Client */
@@ -3457,7 +3586,7 @@ static char* genEnumRequest(ClientEnc *cle, const char *op,
    CMCIClientData   *cld = &cle->data;
    UtilList 	    *nsc;
    char		    method[256]    = "CIMMethod: ";
-   char		    CimObject[512] = "CIMObject: ";
+   UtilStringBuffer *CimObject     = con->mCimObject;
    char		    *nsp;
    int        isEnumOp = 0 ;
    int        chunkedTransfer = 0 ; 
@@ -3565,20 +3694,23 @@ static char* genEnumRequest(ClientEnc *cle, const char *op,
    con->mHeaders = curl_slist_append(con->mHeaders, method);
 
    // Add CIMObject header with cop's namespace, class, keys
+   CimObject->ft->reset(CimObject);
+   CimObject->ft->appendChars(CimObject, "CIMObject: ");
    if (classWithKeys)
-       pathToChars(cop, NULL, &CimObject[11], 1);
+       CimObject->ft->appendChars(CimObject, getPathChars(cop, 1));
    else {
        nsc = getNameSpaceComponents(cop);
        nsp = nsc->ft->getFirst(nsc);
        while (nsp != NULL) {
-	   strcat(CimObject, nsp);
+	   CimObject->ft->appendChars(CimObject, nsp);
 	   free(nsp); /* VM: freeing strdup'ed memory - should be part of release */
            if ((nsp = nsc->ft->getNext(nsc)) != NULL)
-	       strcat(CimObject, "%2F");
+	       CimObject->ft->appendChars(CimObject, "%2F");
        }
        CMRelease(nsc);
    }
-   con->mHeaders = curl_slist_append(con->mHeaders, CimObject);
+   con->mHeaders = curl_slist_append(con->mHeaders,
+				     CimObject->ft->getCharPtr(CimObject));
 
    // Set all of the headers for the request
    curl_easy_setopt(con->mHandle, CURLOPT_HTTPHEADER, con->mHeaders);
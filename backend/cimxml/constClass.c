@@ -45,16 +45,52 @@ extern int addClassProperty( CMPIConstClass * ccls, char * name,
 /****************************************************************************/
 
 
+static void __release_payload ( struct native_constClass * cc )
+{
+	native_free ( cc->classname );
+	propertyFT.release ( cc->props );
+	qualifierFT.release ( cc->qualifiers );
+}
+
+
+static void __copy_payload ( struct native_constClass * to,
+			     struct native_constClass * from )
+{
+	to->classname  = native_strdup ( from->classname );
+	to->qualifiers = qualifierFT.clone ( from->qualifiers, NULL );
+	to->props      = propertyFT.clone ( from->props, NULL );
+	to->refCount   = NULL;
+}
+
+
+/**
+ * gives the class its own copy of a payload shared with clones,
+ * called before anything is modified
+ */
+static void __unshare ( struct native_constClass * cc )
+{
+	struct native_constClass old = *cc;
+
+	if ( ! native_payload_shared ( &cc->refCount ) ) return;
+
+	__copy_payload ( cc, &old );
+
+	if ( native_release_payload ( &old.refCount ) )
+		__release_payload ( &old );
+}
+
+
 static CMPIStatus __ccft_release ( CMPIConstClass * ccls )
 {
 	struct native_constClass * cc = (struct native_constClass *) ccls;
 
 	if ( cc ) {
 
-		free ( cc->classname );
-		propertyFT.release ( cc->props );
-		qualifierFT.release ( cc->qualifiers );
-		free ( cc );
+		if ( native_in_arena ( cc ) ) CMReturn ( CMPI_RC_OK );
+
+		if ( native_release_payload ( &cc->refCount ) )
+			__release_payload ( cc );
+		native_free ( cc );
 
 		CMReturn ( CMPI_RC_OK );
 	}
@@ -63,17 +99,22 @@ static CMPIStatus __ccft_release ( CMPIConstClass * ccls )
 }
 
 
+/**
+ * clones share the payload until one of them is modified, except for
+ * clones made outside of the arena of the class, which copy it
+ */
 static CMPIConstClass * __ccft_clone ( CMPIConstClass * ccls, CMPIStatus * rc )
 {
-	struct native_constClass * cc   = (struct native_constClass *) ccls;
+	struct native_constClass * cc  = (struct native_constClass *) ccls;
 	struct native_constClass * new = (struct native_constClass *) 
-		calloc ( 1, sizeof ( struct native_constClass ) );
+		native_malloc ( sizeof ( struct native_constClass ) );
 
-	new->ccls      = cc->ccls;
-	new->classname = strdup ( cc->classname );
-	new->qualifiers= qualifierFT.clone ( cc->qualifiers, rc );
-	new->props     = propertyFT.clone ( cc->props, rc );
+	*new = *cc;
+	if ( native_arena_local ( cc ) )
+		new->refCount = native_share_payload ( &cc->refCount );
+	else	__copy_payload ( new, cc );
 
+	CMSetStatus ( rc, CMPI_RC_OK );
 	return (CMPIConstClass *) new;
 }
 
@@ -211,11 +252,11 @@ CMPIConstClass * native_new_CMPIConstClass ( char  *cn, CMPIStatus * rc )
 
 	struct native_constClass * ccls =
 		(struct native_constClass *) 
-		calloc ( 1, sizeof ( struct native_constClass ) );
+		native_calloc ( 1, sizeof ( struct native_constClass ) );
 
 	ccls->ccls = cc;
 
-	ccls->classname = strdup (cn );
+	ccls->classname = native_strdup (cn );
 
 	return (CMPIConstClass *) ccls;
 }
@@ -229,7 +270,7 @@ int addClassProperty( CMPIConstClass * ccls,
 {
 	struct native_constClass * cc = (struct native_constClass *) ccls;
 
-
+	__unshare ( cc );
 	if ( propertyFT.setProperty ( cc->props,
 				      name, 
 				      type,
@@ -250,6 +291,7 @@ int addClassQualifier( CMPIConstClass* cc, char * name,
 {
    struct native_constClass * c = (struct native_constClass *) cc;
 
+   __unshare ( c );
 	if ( qualifierFT.setQualifier ( c->qualifiers,
 				      name, 
 				      type,
@@ -269,7 +311,10 @@ int addClassPropertyQualifier( CMPIConstClass* cc, char * pname, char *qname,
 				      CMPIType type)
 {
    struct native_constClass * c = (struct native_constClass *) cc;
-   struct native_property *p=propertyFT.getProperty ( c->props ,pname );
+   struct native_property *p;
+
+   __unshare ( c );
+   p=propertyFT.getProperty ( c->props ,pname );
    
    if (p) {
 	if ( qualifierFT.setQualifier ( p->qualifiers,
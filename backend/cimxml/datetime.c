@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include "cmcidt.h"
 #include "cmcift.h"
@@ -43,10 +44,12 @@
  */
 struct native_datetime {
 	CMPIDateTime dt;	/*!< the inheriting data structure  */
-   char cimDt[26];
+   char cimDt[26];		/*!< the string form  */
+   CMPIUint64 binTime;		/*!< the binary form of cimDt  */
 };
 
 static struct native_datetime * __new_datetime ( const char *cimDt,
+						 CMPIUint64 binTime,
 						 CMPIStatus * );
 
 
@@ -67,7 +70,7 @@ static CMPIStatus __dtft_release ( CMPIDateTime * dt )
 
 	if ( ndt ) {
 
-		free ( ndt );
+		native_free ( ndt );
 
 		CMReturn ( CMPI_RC_OK );
 	}
@@ -90,104 +93,174 @@ static CMPIStatus __dtft_release ( CMPIDateTime * dt )
 static CMPIDateTime * __dtft_clone ( CMPIDateTime * dt, CMPIStatus * rc )
 {
 	struct native_datetime * ndt   = (struct native_datetime *) dt;
-	struct native_datetime * new = __new_datetime ( ndt->cimDt, rc );
+	struct native_datetime * new = __new_datetime ( ndt->cimDt,
+							 ndt->binTime, rc );
 
 	return (CMPIDateTime *) new;
 }
 
-static CMPIUint64 chars2bin(const char *string, CMPIStatus * rc)
+/* Returns the value of the n decimal digits at str, up to the first
+   non-digit, like strtoul() on a copy cut after n characters would. */
+static CMPIUint64 digits(const char *str, int n)
 {
-   CMPIUint64 msecs,secs;
-   CMPIBoolean interval;
-   char *str;
+   CMPIUint64 v = 0;
 
-   str = strdup(string);
-   interval = (str[21] == ':');
+   for (; n && *str >= '0' && *str <= '9'; n--, str++)
+      v = v * 10 + (*str - '0');
+   return v;
+}
 
-// 0000000000111111111122222  
-// 0123456789012345678901234
-// yyyymmddhhmmss mmmmmmsutc 
-// 20050503104354.000000:000
+/* Writes the n low order decimal digits of v to str. */
+static void putDigits(char *str, int n, CMPIUint64 v)
+{
+   while (n--) {
+      str[n] = '0' + v % 10;
+      v /= 10;
+   }
+}
 
-   str[21] = 0;
-   msecs = strtoull(str+15,NULL,10);
+/* Divides rounding towards minus infinity, for times before 1970. */
+static long long floorDiv(long long a, long long b)
+{
+   return a / b - (a % b < 0);
+}
 
-   str[14] = 0;
-   secs = strtoull(str+12,NULL,10);
-   str[12] = 0;
-   secs += strtoull(str+10,NULL,10) * 60ULL;
-   str[10] = 0;
-   secs += strtoull(str+8,NULL,10) * 60ULL * 60ULL;
-   str[8] = 0;
+/* Days since 1970-01-01 of a proleptic Gregorian date. */
+static long long daysFromCivil(long long y, unsigned m, unsigned d)
+{
+   long long era;
+   unsigned yoe, doy;
+
+   y -= m <= 2;
+   era = (y >= 0 ? y : y - 399) / 400;
+   yoe = (unsigned) (y - era * 400);
+   doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+   return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
 
-   if (interval) {
-      secs += strtoull(str,NULL,10) * 60ULL * 60ULL * 24ULL;
-      msecs=msecs+(secs*1000000ULL);
-   }
+/* The inverse of daysFromCivil(). */
+static void civilFromDays(long long z, long long *y, unsigned *m,
+                          unsigned *d)
+{
+   long long era;
+   unsigned doe, yoe, doy, mp;
+
+   z += 719468;
+   era = (z >= 0 ? z : z - 146096) / 146097;
+   doe = (unsigned) (z - era * 146097);
+   yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+   doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+   mp = (5 * doy + 2) / 153;
+   *d = doy - (153 * mp + 2) / 5 + 1;
+   *m = mp < 10 ? mp + 3 : mp - 9;
+   *y = (long long) yoe + era * 400 + (*m <= 2);
+}
 
-   else {
-      struct tm tmp;
+/* Returns the UTC offset of local time at secs in minutes. The offset
+   is cached for the UTC day holding secs, unless the offset changes
+   within that day, and looked up again at most every TZ_REFRESH_SECS
+   to follow time zone changes. */
+#define TZ_REFRESH_SECS 60
 
-      memset(&tmp, 0, sizeof(struct tm));
+static long utcOffset(time_t secs)
+{
+   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+   static time_t day, checked;
+   static long offset;
+   static int cached;
+   time_t now = time(NULL), start = floorDiv(secs, 86400) * 86400, end;
+   struct tm tm;
+   long o;
+
+   pthread_mutex_lock(&lock);
+   if (!cached || floorDiv(secs, 86400) != day ||
+       now - checked >= TZ_REFRESH_SECS || now < checked) {
       tzset();
-
-      tmp.tm_gmtoff = timezone;
-      tmp.tm_isdst = daylight;
-      tmp.tm_mday = atoi(str + 6);
-      str[6] = 0;
-      tmp.tm_mon = atoi(str + 4) - 1;
-      str[4] = 0;
-      tmp.tm_year = atoi(str) - 1900;
-
-      msecs=msecs+(secs*1000000ULL);
-      msecs += (CMPIUint64) mktime(&tmp) * 1000000ULL;
+      if (localtime_r(&secs, &tm) == NULL) {
+         pthread_mutex_unlock(&lock);
+         return 0;
+      }
+      offset = tm.tm_gmtoff / 60;
+      cached = 0;
+      end = start + 86399;
+      if (localtime_r(&start, &tm) && tm.tm_gmtoff / 60 == offset &&
+          localtime_r(&end, &tm) && tm.tm_gmtoff / 60 == offset) {
+         day = floorDiv(secs, 86400);
+         checked = now;
+         cached = 1;
+      }
    }
-
-   free(str);
-
-   return msecs;
+   o = offset;
+   pthread_mutex_unlock(&lock);
+   return o;
 }
 
-static void bin2chars(CMPIUint64 msecs, CMPIBoolean interval, CMPIStatus * rc, char *str_time)
+// 0000000000111111111122222
+// 0123456789012345678901234
+// yyyymmddhhmmss mmmmmmsutc
+// 20050503104354.000000:000
+// ddddddddhhmmss mmmmmm:000
+
+static CMPIUint64 chars2bin(const char *str)
 {
-   time_t secs = msecs / 1000000ULL;
-   unsigned long usecs = msecs % 1000000ULL;
+   long long secs;
+   long utc;
 
-   if (interval) {
+   secs = digits(str + 8, 2) * 3600 + digits(str + 10, 2) * 60 +
+      digits(str + 12, 2);
 
-      unsigned long long useconds, seconds, mins, hrs, days;
-      seconds= msecs / 1000000ULL;
-      useconds = msecs % 1000000ULL;
-
-      mins = seconds / 60ULL;
-      seconds %= 60ULL;
-      hrs = mins / 60ULL;
-      mins %= 60ULL;
-      days = hrs / 24ULL;
-      hrs %= 24ULL;
-		
-      sprintf(str_time, "%8.8llu%2.2llu%2.2llu%2.2llu.%6.6llu:000",
-              days, hrs, mins, seconds, useconds);
+   if (str[21] == ':') {
+      secs += digits(str, 8) * 86400;
    }
 
    else {
-		struct tm tm_time;
-		char us_utc_time[11];
+      utc = digits(str + 22, 3);
+      if (str[21] == '-')
+         utc = -utc;
+      secs += daysFromCivil(digits(str, 4), digits(str + 4, 2),
+                            digits(str + 6, 2)) * 86400 - utc * 60;
+   }
 
-		if ( localtime_r ( &secs, &tm_time ) == NULL ) {
-         CMSetStatus(rc, CMPI_RC_ERR_FAILED);
-         return;
-		}
+   return (CMPIUint64) secs * 1000000ULL + digits(str + 15, 6);
+}
+
+static void bin2chars(CMPIUint64 msecs, CMPIBoolean interval, char *str)
+{
+   long long secs, days;
+   long long year;
+   unsigned month, day;
+   long utc;
 
-		tzset ();
+   str[14] = '.';
+   str[25] = 0;
 
-		snprintf ( us_utc_time, 11, "%6.6ld%+4.3ld", 
-			   usecs, ( daylight != 0 ) * 60 - timezone / 60 );
+   if (interval) {
+      putDigits(str + 15, 6, msecs % 1000000ULL);
+      secs = msecs / 1000000ULL % 86400;
+      putDigits(str, 8, msecs / 1000000ULL / 86400);
+      str[21] = ':';
+      putDigits(str + 22, 3, 0);
+   }
 
-		strftime ( str_time, 26, "%Y%m%d%H%M%S.", &tm_time );
+   else {
+      /* times before 1970 come as negative values */
+      secs = floorDiv((long long) msecs, 1000000);
+      putDigits(str + 15, 6, (long long) msecs - secs * 1000000);
+      utc = utcOffset((time_t) secs);
+      secs += utc * 60;
+      days = floorDiv(secs, 86400);
+      secs -= days * 86400;
+      civilFromDays(days, &year, &month, &day);
+      putDigits(str, 4, year);
+      putDigits(str + 4, 2, month);
+      putDigits(str + 6, 2, day);
+      str[21] = utc < 0 ? '-' : '+';
+      putDigits(str + 22, 3, utc < 0 ? -utc : utc);
+   }
 
-		strcat ( str_time, us_utc_time );
-	}
+   putDigits(str + 8, 2, secs / 3600);
+   putDigits(str + 10, 2, secs / 60 % 60);
+   putDigits(str + 12, 2, secs % 60);
 }
 
 //! Extracts the binary time from the encapsulated CMPIDateTime object.
@@ -203,7 +276,7 @@ static CMPIUint64 __dtft_getBinaryFormat ( CMPIDateTime * dt,
     struct native_datetime * ndt   = (struct native_datetime *) dt;
 
     CMSetStatus ( rc, CMPI_RC_OK );
-    return chars2bin(ndt->cimDt,rc);
+    return ndt->binTime;
 }
 
 
@@ -248,15 +321,14 @@ static CMPIBoolean __dtft_isInterval ( CMPIDateTime * dt, CMPIStatus * rc )
   The newly allocated object's function table is initialized to point
   to the native functions in this file.
 
-  \param mm_add TOOL_MM_ADD for a regular object, TOOL_MM_NO_ADD for
-  cloned ones
-  \param msecs the binary time to be stored
-  \param interval the interval flag to be stored
+  \param cimDt the string form to be stored
+  \param binTime the binary form of cimDt to be stored
   \param rc return code pointer
 
   \return a fully initialized native_datetime object pointer.
  */
 static struct native_datetime * __new_datetime ( const char *cimDt,
+						 CMPIUint64 binTime,
 						 CMPIStatus * rc )
 {
 	static const CMPIDateTimeFT dtft = {
@@ -274,10 +346,11 @@ static struct native_datetime * __new_datetime ( const char *cimDt,
 	};
 
     struct native_datetime * ndt = (struct native_datetime *) 
-		calloc ( 1, sizeof ( struct native_datetime ) );
+		native_calloc ( 1, sizeof ( struct native_datetime ) );
 
 	ndt->dt        = dt;
-    strcpy(ndt->cimDt, cimDt);
+    memcpy(ndt->cimDt, cimDt, sizeof(ndt->cimDt));
+    ndt->binTime = binTime;
 
     CMSetStatus ( rc, CMPI_RC_OK );
 	return ndt;
@@ -296,18 +369,17 @@ static struct native_datetime * __new_datetime ( const char *cimDt,
 CMPIDateTime * native_new_CMPIDateTime ( CMPIStatus * rc )
 {
 	struct timeval tv;
-	struct timezone tz;
 	CMPIUint64 msecs;
     char cimDt[26];
 
-	gettimeofday ( &tv, &tz );
+	gettimeofday ( &tv, NULL );
 
 	msecs = (CMPIUint64) 1000000 * (CMPIUint64) tv.tv_sec 
 		+ (CMPIUint64) tv.tv_usec;
 
-    bin2chars(msecs, 0, rc, cimDt);
+    bin2chars(msecs, 0, cimDt);
 
-    return (CMPIDateTime *) __new_datetime ( cimDt, rc );
+    return (CMPIDateTime *) __new_datetime ( cimDt, msecs, rc );
 }
 
 
@@ -328,8 +400,8 @@ CMPIDateTime * native_new_CMPIDateTime_fromBinary ( CMPIUint64 time,
 						    CMPIStatus * rc )
 {
    char cimDt[26];
-   bin2chars(time, interval, rc, cimDt);
-   return (CMPIDateTime *) __new_datetime(cimDt, rc);
+   bin2chars(time, interval, cimDt);
+   return (CMPIDateTime *) __new_datetime(cimDt, time, rc);
 }
 
 
@@ -356,7 +428,7 @@ CMPIDateTime * native_new_CMPIDateTime_fromChars ( const char * string,
       return NULL;
 	}
 
-   return (CMPIDateTime *) __new_datetime(string, rc);
+   return (CMPIDateTime *) __new_datetime(string, chars2bin(string), rc);
 }
 
 
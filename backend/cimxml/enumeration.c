@@ -69,6 +69,9 @@ static CMPIStatus __eft_release ( CMPIEnumeration * enumeration )
 	struct native_enum * e = (struct native_enum *) enumeration;
 	CMPIStatus st= { CMPI_RC_OK, NULL };
 	if (e) {
+		if (e->arena)
+		  native_release_arena(e->arena);
+		else
 		if (e->data)
 		  st = CMRelease(e->data);
 		free ( enumeration );
@@ -160,6 +163,21 @@ CMPIEnumeration * native_new_CMPIEnumeration ( CMPIArray * array,
 }
 
 
+/**
+ * Creates an enumeration of an array allocated from arena, together
+ * with its elements. The arena is released with the enumeration.
+ */
+CMPIEnumeration * native_new_CMPIEnumeration_fromArena ( CMPIArray * array,
+							 struct native_arena * arena,
+							 CMPIStatus * rc )
+{
+	struct native_enum * e = __new_enumeration ( array, rc );
+
+	e->arena = arena;
+	return (CMPIEnumeration *) e;
+}
+
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
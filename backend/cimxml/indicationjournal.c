@@ -0,0 +1,428 @@
+/*
+ * indicationjournal.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:   append-only journal of the indications received by the
+ *                indication listener
+ *
+ * The journal is a sequence of segment files of a fixed size, named by
+ * the journal offset of their first record in hex. Each starts with a
+ * header, followed by records of a length, a checksum and the data. The
+ * length is written last, so a record with a length and a matching
+ * checksum is complete; the first one that is not ends the journal.
+ * Segments are written through a shared mapping, which a sync thread
+ * flushes to disk for all records appended meanwhile.
+ */
+
+#include "indicationjournal.h"
+#include "native.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOURNAL_MAGIC "SFCCILJ1"
+#define JOURNAL_HDR 16          /* magic and offset of the first record */
+#define RECORD_HDR 8            /* length and checksum */
+#define JOURNAL_SUFFIX ".ilj"
+
+/* the data is followed by at least one NUL and padded to 8 bytes */
+#define RECORD_SIZE(length) (RECORD_HDR + (((length) + 8) & ~7L))
+
+struct _il_journal {
+    char *directory;
+    long segmentSize;
+    int syncInterval;           /* milliseconds */
+
+    pthread_mutex_t lock;
+    pthread_cond_t syncCond;    /* wakes the sync thread */
+    pthread_cond_t retiredCond; /* retired segment taken by the sync thread */
+    pthread_t syncThread;
+    int syncing;
+
+    /* the segment appended to */
+    int fd;
+    char *base;
+    CIMCUint64 start;           /* journal offset of its first record */
+    long pos;                   /* end of its last record */
+    long synced;                /* synced up to here */
+
+    /* a full segment, to be synced and unmapped by the sync thread */
+    int retiredFd;
+    char *retiredBase;
+    long retiredLength;
+};
+
+static uint32_t checksum(const char *data, int length)
+{
+    uint32_t h = 2166136261U;
+    int k;
+
+    for (k = 0; k < length; k++) {
+        h = (h ^ (unsigned char) data[k]) * 16777619U;
+    }
+    return h;
+}
+
+static void segmentName(char *name, size_t size, const char *directory,
+                        CIMCUint64 start)
+{
+    snprintf(name, size, "%s/%016llx" JOURNAL_SUFFIX, directory,
+             (unsigned long long) start);
+}
+
+static CIMCStatus journalError(const char *what, const char *name)
+{
+    CIMCStatus rc;
+    char msg[512];
+
+    snprintf(msg, sizeof(msg), "%s %s failed: %s", what, name,
+             strerror(errno));
+    rc.rc = CIMC_RC_ERR_FAILED;
+    rc.msg = (CIMCString *) native_new_CMPIString(msg, NULL);
+    return rc;
+}
+
+/*
+ * Finds the segment holding offset, or the last one if offset is past
+ * the end. Returns 0 if there is none.
+ */
+static int findSegment(const char *directory, CIMCUint64 offset,
+                       CIMCUint64 *start)
+{
+    DIR *dir;
+    struct dirent *de;
+    unsigned long long s;
+    char suffix[8];
+    int found = 0;
+
+    if ((dir = opendir(directory)) == NULL) {
+        return 0;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (strlen(de->d_name) == 16 + strlen(JOURNAL_SUFFIX) &&
+            sscanf(de->d_name, "%16llx%7s", &s, suffix) == 2 &&
+            strcmp(suffix, JOURNAL_SUFFIX) == 0 && s <= offset &&
+            (!found || s > *start)) {
+            *start = s;
+            found = 1;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+/* Returns the size of the record at pos, 0 if there is no complete one. */
+static long recordAt(const char *base, long size, long pos)
+{
+    uint32_t length;
+
+    if (pos + RECORD_HDR > size) {
+        return 0;
+    }
+    length = *(volatile uint32_t *) (base + pos);
+    __sync_synchronize();
+    if (length == 0 || pos + RECORD_SIZE(length) > size ||
+        checksum(base + pos + RECORD_HDR, length) !=
+        *(uint32_t *) (base + pos + 4)) {
+        return 0;
+    }
+    return RECORD_SIZE(length);
+}
+
+static int mapSegment(IndicationJournal *j, CIMCUint64 start, int create,
+                      CIMCStatus *rc)
+{
+    char name[4096];
+    struct stat st;
+
+    segmentName(name, sizeof(name), j->directory, start);
+    j->fd = open(name, O_RDWR | O_CREAT | (create ? O_TRUNC : 0), 0600);
+    if (j->fd < 0) {
+        *rc = journalError("open", name);
+        return -1;
+    }
+    fcntl(j->fd, F_SETFD, FD_CLOEXEC);
+    if (!create && fstat(j->fd, &st) == 0 && st.st_size != j->segmentSize) {
+        /* keep the segment size it was written with */
+        j->segmentSize = st.st_size;
+    }
+    if ((create && ftruncate(j->fd, j->segmentSize)) ||
+        (j->base = mmap(NULL, j->segmentSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, j->fd, 0)) == MAP_FAILED) {
+        *rc = journalError(create ? "ftruncate/mmap" : "mmap", name);
+        close(j->fd);
+        j->base = NULL;
+        return -1;
+    }
+    j->start = start;
+    j->pos = JOURNAL_HDR;
+    j->synced = 0;
+
+    if (create || memcmp(j->base, JOURNAL_MAGIC, 8) != 0) {
+        memcpy(j->base, JOURNAL_MAGIC, 8);
+        memcpy(j->base + 8, &start, 8);
+    } else {
+        /* continue after the last complete record, clearing any torn one */
+        long size;
+        while ((size = recordAt(j->base, j->segmentSize, j->pos)) > 0) {
+            j->pos += size;
+        }
+        memset(j->base + j->pos, 0, j->segmentSize - j->pos);
+        j->synced = j->pos;
+    }
+    return 0;
+}
+
+/* called with lock held */
+static int nextSegment(IndicationJournal *j)
+{
+    CIMCStatus rc;
+    CIMCUint64 start = j->start + (j->pos - JOURNAL_HDR);
+
+    while (j->retiredBase) {
+        pthread_cond_signal(&j->syncCond);
+        pthread_cond_wait(&j->retiredCond, &j->lock);
+    }
+    j->retiredFd = j->fd;
+    j->retiredBase = j->base;
+    j->retiredLength = j->pos;
+
+    if (mapSegment(j, start, 1, &rc)) {
+        fprintf(stderr, "indication journal: %s\n", (char *) rc.msg->hdl);
+        rc.msg->ft->release(rc.msg);
+        return -1;
+    }
+    pthread_cond_signal(&j->syncCond);
+    return 0;
+}
+
+CIMCUint64 appendJournal(IndicationJournal *j, const char *data, int length)
+{
+    long size = RECORD_SIZE(length);
+    char *rec;
+    CIMCUint64 next;
+    uint32_t sum;
+
+    if (length <= 0 || size > j->segmentSize - JOURNAL_HDR) {
+        return 0;
+    }
+    sum = checksum(data, length);
+
+    pthread_mutex_lock(&j->lock);
+    if ((j->base == NULL || j->pos + size > j->segmentSize) &&
+        nextSegment(j)) {
+        pthread_mutex_unlock(&j->lock);
+        return 0;
+    }
+    rec = j->base + j->pos;
+    memcpy(rec + RECORD_HDR, data, length);
+    *(uint32_t *) (rec + 4) = sum;
+    __sync_synchronize();
+    *(volatile uint32_t *) rec = length;
+    j->pos += size;
+    next = j->start + (j->pos - JOURNAL_HDR);
+    pthread_mutex_unlock(&j->lock);
+
+    return next;
+}
+
+static void syncRange(char *base, long from, long to)
+{
+    long page = sysconf(_SC_PAGESIZE);
+
+    from &= ~(page - 1);
+    if (to > from) {
+        msync(base + from, to - from, MS_SYNC);
+    }
+}
+
+/*
+ * Flushes the records appended since the last round to disk, every
+ * syncInterval milliseconds or when a segment is full. Only this thread
+ * unmaps retired segments, so it can sync outside the lock.
+ */
+static void* sync_thread(void *parms)
+{
+    IndicationJournal *j = (IndicationJournal *) parms;
+    struct timespec ts;
+    char *retiredBase, *base;
+    int retiredFd, done;
+    long retiredLength, synced, pos;
+
+    pthread_mutex_lock(&j->lock);
+    for (;;) {
+        done = !j->syncing;
+        if (!done && j->retiredBase == NULL) {
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += (long) j->syncInterval * 1000000;
+            ts.tv_sec += ts.tv_nsec / 1000000000;
+            ts.tv_nsec %= 1000000000;
+            pthread_cond_timedwait(&j->syncCond, &j->lock, &ts);
+        }
+
+        retiredBase = j->retiredBase;
+        retiredFd = j->retiredFd;
+        retiredLength = j->retiredLength;
+        j->retiredBase = NULL;
+        base = j->base;
+        synced = j->synced;
+        pos = j->pos;
+        pthread_mutex_unlock(&j->lock);
+
+        if (retiredBase) {
+            msync(retiredBase, retiredLength, MS_SYNC);
+            munmap(retiredBase, j->segmentSize);
+            close(retiredFd);
+        }
+        if (base && pos > synced) {
+            syncRange(base, synced, pos);
+        }
+
+        pthread_mutex_lock(&j->lock);
+        if (retiredBase) {
+            pthread_cond_broadcast(&j->retiredCond);
+        }
+        if (j->base == base && j->synced < pos) {
+            j->synced = pos;
+        }
+        if (done && j->retiredBase == NULL) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&j->lock);
+    return NULL;
+}
+
+IndicationJournal *openJournal(const char *directory, long segmentSize,
+                               int syncInterval, CIMCStatus *rc)
+{
+    IndicationJournal *j;
+    CIMCUint64 start = 0;
+    int found;
+
+    rc->rc = CIMC_RC_OK;
+    rc->msg = NULL;
+
+    if (mkdir(directory, 0700) && errno != EEXIST) {
+        *rc = journalError("mkdir", directory);
+        return NULL;
+    }
+
+    j = (IndicationJournal *) calloc(1, sizeof(IndicationJournal));
+    j->directory = strdup(directory);
+    j->segmentSize = segmentSize;
+    j->syncInterval = syncInterval;
+    pthread_mutex_init(&j->lock, NULL);
+    pthread_cond_init(&j->syncCond, NULL);
+    pthread_cond_init(&j->retiredCond, NULL);
+
+    found = findSegment(directory, (CIMCUint64) -1, &start);
+    if (mapSegment(j, start, !found, rc)) {
+        closeJournal(j);
+        return NULL;
+    }
+
+    j->syncing = 1;
+    pthread_create(&j->syncThread, NULL, sync_thread, j);
+    return j;
+}
+
+void closeJournal(IndicationJournal *j)
+{
+    if (j->syncing) {
+        pthread_mutex_lock(&j->lock);
+        j->syncing = 0;
+        pthread_cond_signal(&j->syncCond);
+        pthread_mutex_unlock(&j->lock);
+        pthread_join(j->syncThread, NULL);
+    }
+    if (j->base) {
+        syncRange(j->base, j->synced, j->pos);
+        munmap(j->base, j->segmentSize);
+        close(j->fd);
+    }
+    pthread_mutex_destroy(&j->lock);
+    pthread_cond_destroy(&j->syncCond);
+    pthread_cond_destroy(&j->retiredCond);
+    free(j->directory);
+    free(j);
+}
+
+CIMCStatus readJournal(const char *directory, CIMCUint64 offset,
+                       int (*fp) (void *parm, char *data, int length,
+                                  CIMCUint64 next),
+                       void *parm, CIMCUint64 *end)
+{
+    CIMCStatus rc;
+    CIMCUint64 start;
+    char name[4096], *base;
+    struct stat st;
+    long pos, size;
+    int fd, stop = 0;
+
+    rc.rc = CIMC_RC_OK;
+    rc.msg = NULL;
+    *end = offset;
+
+    if (!findSegment(directory, offset, &start)) {
+        if (offset) {
+            rc.rc = CIMC_RC_ERR_NOT_FOUND;
+        }
+        return rc;
+    }
+
+    while (!stop) {
+        segmentName(name, sizeof(name), directory, start);
+        if ((fd = open(name, O_RDONLY)) < 0) {
+            if (errno != ENOENT) {
+                rc = journalError("open", name);
+            }
+            break;
+        }
+        /* a private mapping, so that records can be parsed in place */
+        if (fstat(fd, &st) ||
+            (base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+            rc = journalError("mmap", name);
+            close(fd);
+            break;
+        }
+        close(fd);
+
+        pos = JOURNAL_HDR + (offset - start);
+        while ((size = recordAt(base, st.st_size, pos)) > 0) {
+            pos += size;
+            offset = start + (pos - JOURNAL_HDR);
+            if (fp(parm, base + pos - size + RECORD_HDR,
+                   *(uint32_t *) (base + pos - size), offset)) {
+                stop = 1;
+                break;
+            }
+        }
+        munmap(base, st.st_size);
+
+        if (stop || offset == start) {
+            break;
+        }
+        /* the next segment, if any, starts where this one ended */
+        start = offset;
+    }
+    *end = offset;
+    return rc;
+}
@@ -0,0 +1,51 @@
+/*
+ * indicationjournal.h
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:   append-only journal of the indications received by the
+ *                indication listener
+ */
+
+#ifndef _INDICATIONJOURNAL_H_
+#define _INDICATIONJOURNAL_H_
+
+#include "cimc.h"
+
+typedef struct _il_journal IndicationJournal;
+
+/*
+ * Opens the journal in directory, creating it if needed, and continues
+ * it after its last complete record. Records are synced to disk at the
+ * latest syncInterval milliseconds after they were appended.
+ */
+IndicationJournal *openJournal(const char *directory, long segmentSize,
+                               int syncInterval, CIMCStatus *rc);
+
+/*
+ * Appends a record. Returns the journal offset following it, or 0 if
+ * the record does not fit into a segment or no segment could be created.
+ */
+CIMCUint64 appendJournal(IndicationJournal *j, const char *data, int length);
+
+/* Syncs and closes the journal. */
+void closeJournal(IndicationJournal *j);
+
+/*
+ * Passes the records from offset on to fp, with the offset following
+ * each. The record data is writable and NUL terminated. Stops at the
+ * last complete record or when fp returns nonzero. Offset must be 0 or
+ * an offset passed to fp or returned by appendJournal(). Returns the
+ * offset reached in *end.
+ */
+CIMCStatus readJournal(const char *directory, CIMCUint64 offset,
+                       int (*fp) (void *parm, char *data, int length,
+                                  CIMCUint64 next),
+                       void *parm, CIMCUint64 *end);
+
+#endif
@@ -22,6 +22,7 @@
 #include "nativeCimXml.h"
 #include "utilft.h"
 #include "cimXmlParser.h"
+#include "indicationjournal.h"
 
 #include <pthread.h>
 #include <sys/socket.h>
@@ -30,13 +31,32 @@
 # define __CONST_SOCKADDR_ARG __const struct sockaddr *
 #endif
 #include <netinet/in.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
 #include <unistd.h>
 
-static int do_listen=1;
+extern char *XmlToAsciiStr(char *XmlStr);
+
+#define DEFAULT_BACKLOG 128
+#define DEFAULT_WORKERS 4
+#define DEFAULT_KEEPALIVE_TIMEOUT 15
+#define DEFAULT_KEEPALIVE_MAX 10
+#define DEFAULT_QUEUE_SIZE 1024
+#define DEFAULT_BATCH_SIZE 64
+#define DEFAULT_JOURNAL_SEGMENT_SIZE (64 * 1024 * 1024)
+#define DEFAULT_JOURNAL_SYNC 10
+#define DEFAULT_MAX_PAYLOAD (16 * 1024 * 1024)
+#define HDR_TIMEOUT 5
+#define PAYLOAD_TIMEOUT 15
+#define MAX_EVENTS 64
 
-#define SOCKBUFSZ 32768
 #define hdrBufsize 5000
 #define hdrLimmit 5000
 
@@ -46,6 +66,7 @@ typedef struct _buffer {
    char *httpHdr, *authorization, *content_type, *host, *useragent;
    char *principal;
    char *protocol;
+   char *connection;
 } Buffer;
 
 typedef struct commHndl {
@@ -54,14 +75,29 @@ typedef struct commHndl {
   void *buf;
 } CommHndl;
 
+/*
+ * A connection to a sender. Between requests it waits for data in the
+ * listener's epoll set, see serve_listener().
+ */
+typedef struct _il_connection {
+  int    socket;
+  int    requests;              /* requests served so far */
+  int    state;
+  time_t lastActive;
+  char  *pending;               /* data read beyond the last request */
+  int    pendingLength;
+  struct _il_connection *next, *prev;
+} Connection;
+
+#define CONN_IDLE   0           /* waiting for data */
+#define CONN_QUEUED 1           /* queued for or served by a worker */
+
 
 static void freeBuffer(Buffer * b)
 {
    Buffer emptyBuf = { NULL, NULL, 0, 0, 0, 0, 0 ,0};
    if (b->data)
       free(b->data);
-   if (b->content)
-      free(b->content);
    *b=emptyBuf;   
 }
 
@@ -136,16 +172,11 @@ static void genError(CommHndl conn_fd, Buffer * b, int status, char *title,
     char cclose[] = "Connection: close\r\n";
     char end[] = "\r\n";
 
-    snprintf(head, sizeof(head), "%s %d %s\r\n", b->protocol, status, title);
+    /* one write, the response is small */
+    snprintf(head, sizeof(head), "%s %d %s\r\n%s%s%s%s%s", b->protocol,
+             status, title, more ? more : "", server, clength,
+             more ? "" : cclose, end);
     commWrite(conn_fd, head, strlen(head));
-    if (more) {
-        commWrite(conn_fd, more, strlen(more));
-    }
-    commWrite(conn_fd, server, strlen(server));
-    commWrite(conn_fd, clength, strlen(clength));
-    commWrite(conn_fd, cclose, strlen(cclose));
-
-    commWrite(conn_fd, end, strlen(end));
     commFlush(conn_fd);
 }
 
@@ -169,48 +200,155 @@ static char *getNextHdr(Buffer * b)
     return NULL;
 }
 
-static int readData(CommHndl conn_fd, char *into, int length)
+/*
+ * Waits for data on the connection. Returns 0 when there is some, -1
+ * when the deadline passed or when the listener is being stopped, which
+ * leaves its wakeFd readable, and the sender has nothing more to read.
+ */
+static int waitForData(CommHndl conn_fd, time_t deadline, int wakeFd)
+{
+    struct pollfd fds[2];
+    time_t left;
+    int r;
+
+    fds[0].fd = conn_fd.socket;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeFd;
+    fds[1].events = POLLIN;
+    for (;;) {
+        left = deadline - time(NULL);
+        if (left < 0) left = 0;
+        fds[0].revents = fds[1].revents = 0;
+        r = poll(fds, 2, left * 1000);
+        if (r < 0 && errno == EINTR) continue;
+        return r > 0 && fds[0].revents ? 0 : -1;
+    }
+}
+
+/*
+ * Reads up to length bytes before the deadline. Returns the number of
+ * bytes read and sets *timedOut if the deadline passed first.
+ */
+static int readData(CommHndl conn_fd, char *into, int length,
+                    time_t deadline, int wakeFd, int *timedOut)
 {
     int c = 0, r;
 
     while (c < length) {
+        if (waitForData(conn_fd, deadline, wakeFd)) {
+            *timedOut = 1;
+            break;
+        }
         r = commRead(conn_fd, into + c, length - c);
         if (r < 0 && (errno == EINTR || errno == EAGAIN)) {
             continue;
         }
+        if (r <= 0) {
+            break;
+        }
         c += r;
     }
     return c;
 }
 
-static void getPayload(CommHndl conn_fd, Buffer * b)
+/*
+ * Enlarges the receive buffer, moving the header fields that point
+ * into it along. Returns -1, leaving the buffer as it is, if there is
+ * not enough memory.
+ */
+static int growBuffer(Buffer * b, size_t size)
+{
+    char **fields[] = { &b->httpHdr, &b->authorization, &b->content_type,
+                        &b->host, &b->useragent, &b->protocol,
+                        &b->connection };
+    long offsets[sizeof(fields) / sizeof(fields[0])];
+    int k, n = sizeof(fields) / sizeof(fields[0]);
+    char *data;
+
+    if (size > INT_MAX) {
+        return -1;
+    }
+    for (k = 0; k < n; k++) {
+        offsets[k] = *fields[k] >= b->data && *fields[k] < b->data + b->size ?
+                     *fields[k] - b->data : -1;
+    }
+    data = (char *) realloc(b->data, size);
+    if (data == NULL) {
+        return -1;
+    }
+    b->data = data;
+    b->size = size;
+    for (k = 0; k < n; k++) {
+        if (offsets[k] >= 0) {
+            *fields[k] = b->data + offsets[k];
+        }
+    }
+    return 0;
+}
+
+/*
+ * Reads the payload into the receive buffer behind the headers and
+ * points b->content at it. Anything beyond the payload is the start of
+ * the next request, so the payload is not NUL terminated. Returns -1 if
+ * the sender closed the connection within the payload, -2 if there is
+ * no memory for it, -3 if it did not arrive within PAYLOAD_TIMEOUT.
+ */
+static int getPayload(CommHndl conn_fd, Buffer * b, int wakeFd)
 {
     int c = b->length - b->ptr;
-    b->content = (char *) malloc(b->content_length + 8);
-    if (c) memcpy(b->content, (b->data) + b->ptr, c);
+    int timedOut = 0;
+    size_t size;
 
-    readData(conn_fd, (b->content) + c, b->content_length - c);
-    *((b->content) + b->content_length) = 0;
+    if (c < b->content_length) {
+        /* content_length is limited by maxPayload, but check anyway */
+        size = (size_t) b->ptr + (size_t) b->content_length + 8;
+        if (size < (size_t) b->content_length) {
+            return -2;
+        }
+        if (size > (size_t) b->size && growBuffer(b, size)) {
+            return -2;
+        }
+        c += readData(conn_fd, b->data + b->length, b->content_length - c,
+                      time(NULL) + PAYLOAD_TIMEOUT, wakeFd, &timedOut);
+        b->length = b->ptr + c;
+        b->data[b->length] = 0;
+        if (c < b->content_length) {
+            return timedOut ? -3 : -1;
+        }
+    }
+    b->content = b->data + b->ptr;
+    b->ptr += b->content_length;
+    return 0;
 }
 
-static int  getHdrs(CommHndl conn_fd, Buffer * b, char *cmd)
+static int  getHdrs(CommHndl conn_fd, Buffer * b, char *cmd, int wakeFd)
 {
-   int first=1,total=0,isReady;
-   struct timeval httpTimeout;
-   fd_set httpfds;
+   int first=1,total=0;
+   time_t deadline;
    int state=0;
    
-   FD_ZERO(&httpfds);
-   FD_SET(conn_fd.socket,&httpfds);
-   httpTimeout.tv_sec=5;
-   httpTimeout.tv_usec=0;
-   isReady = select(conn_fd.socket+1,&httpfds,NULL,NULL,&httpTimeout);
-   if (isReady == 0) return 3;
+   if (b->length) {
+      /* data left from the previous request on this connection */
+      if (strncasecmp(b->data,cmd,strlen(cmd)) != 0) state = 1;
+      first = 0;
+      total = b->length;
+      if (strstr(b->data, "\r\n\r\n") != NULL ||
+          strstr(b->data, "\n\n") != NULL) {
+         return state;
+      }
+   }
+
+   /* the headers must be complete within HDR_TIMEOUT, however slowly
+      they trickle in */
+   deadline = time(NULL) + HDR_TIMEOUT;
     
    for (;;) {
       char buf[hdrBufsize];
-      int r = commRead(conn_fd, buf, sizeof(buf));
+      int r;
       
+      if (waitForData(conn_fd, deadline, wakeFd)) return 3;
+      
+      r = commRead(conn_fd, buf, sizeof(buf));
       if (r < 0 && (errno == EINTR || errno == EAGAIN)) continue;
       if (r <= 0) break;
       
@@ -239,294 +377,1908 @@ static int  getHdrs(CommHndl conn_fd, Buffer * b, char *cmd)
    return state;
 }
 
-static void processIndication(struct native_indicationlistener *i, char *xml)
-{
-    ResponseHdr rh;
-    
+/*
+ * The indication queue is a bounded ring of slots, each with a sequence
+ * number telling whether it is free for the producer at that position or
+ * filled for the consumer at that position (D. Vyukov's bounded MPMC
+ * queue). The workers produce, the delivery thread consumes; with the
+ * drop-oldest policy a worker may consume too.
+ */
+typedef struct _il_slot {
+    volatile unsigned long seq;
     CIMCInstance *inst;
-    
-    rh = scanCimXmlResponse(xml, NULL);
-    
-    if (rh.errCode != 0) {
-        free(rh.description);
-        rh.rvArray->ft->release(rh.rvArray);
-        return;
-    }
-   
-    inst = (CIMCInstance*)rh.rvArray->ft->getElementAt(rh.rvArray, 0, NULL).value.inst;
-    
-    if(inst) {
-        i->sendIndicationInstance(inst->ft->clone(inst, NULL));
-    }
-    
-    rh.rvArray->ft->release(rh.rvArray);
+    CIMCUint64 queued;          /* microseconds, CLOCK_MONOTONIC */
+} Slot;
+
+#define COUNT(i, counter) __sync_fetch_and_add(&(i)->stats.counter, 1)
+
+static CIMCUint64 now_usecs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (CIMCUint64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-static void handleConnection(int connFd, struct native_indicationlistener *i)
+/* seconds for idle times, not affected by changes of the clock */
+static time_t now_secs()
 {
-    Buffer inBuf = { NULL, NULL, 0, 0, 0, 0, 0 ,0};
-    int badReq = 0;
-    int discardInput=0;
-    char *path, *hdr;
-    char *cp;
-    CommHndl conn_fd;
-    int rc;
-    
-    inBuf.authorization = "";
-    inBuf.protocol="HTTP/1.1";
-    inBuf.content_type = NULL;
-    inBuf.content_length = -1;
-    inBuf.host = NULL;
-    inBuf.useragent = "";
-    
-    conn_fd.socket=connFd;
-    conn_fd.file=fdopen(connFd,"a");
-    conn_fd.buf = NULL;
-    if (conn_fd.file == NULL) {
-        /* failed to create socket stream - continue with raw socket */
-    } else {
-        conn_fd.buf = malloc(SOCKBUFSZ);
-    if (conn_fd.buf) {
-        setbuffer(conn_fd.file,conn_fd.buf,SOCKBUFSZ);
-    } else {
-           /* failed to create socket buffer - continue unbuffered */
-        }
-    }
+    struct timespec ts;
 
-    rc=getHdrs(conn_fd, &inBuf,"POST ");
-    
-    if (rc==1) { 
-        genError(conn_fd, &inBuf, 501, "Not Implemented", NULL);
-        /* we continue to parse headers and empty the socket
-        to be graceful with the client */
-        discardInput=1;
-    }
-    else if (rc==2) {
-        genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
-        discardInput=2;
-        /* potential DOS attempt discovered */      
-    }
-    else if (rc==3) {
-        genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
-        /* exiting after request timeout */
-        commClose(conn_fd);
-        exit(1);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static void initQueue(struct native_indicationlistener *i)
+{
+    unsigned long size = 2, k;
+
+    while (size < i->queueSize) {
+        size <<= 1;
     }
-            
-    if (inBuf.size == 0) {
-        /* no buffer data - end of file - quit */   
-        commClose(conn_fd);
-        exit(1);
+    i->queue = (Slot *) malloc(sizeof(Slot) * size);
+    for (k = 0; k < size; k++) {
+        i->queue[k].seq = k;
     }
-    
-    inBuf.httpHdr = getNextHdr(&inBuf);
-    for (badReq = 1;;) {
-        if (inBuf.httpHdr == NULL) {
-            break;
-        }
-        path = strpbrk(inBuf.httpHdr, " \t\r\n");
-        if (path == NULL) {
-            break;
+    i->queueMask = size - 1;
+    i->queueHead = i->queueTail = 0;
+}
+
+static int tryEnqueue(struct native_indicationlistener *i, CIMCInstance *inst)
+{
+    unsigned long pos = i->queueTail;
+    Slot *slot;
+    long dif;
+
+    for (;;) {
+        slot = &i->queue[pos & i->queueMask];
+        dif = (long) (slot->seq - pos);
+        if (dif == 0) {
+            if (__sync_bool_compare_and_swap(&i->queueTail, pos, pos + 1)) {
+                break;
+            }
         }
-        *path++ = 0;
-        path += strspn(path, " \t\r\n");
-        inBuf.protocol = strpbrk(path, " \t\r\n");
-        *inBuf.protocol++ = 0;
-        if (inBuf.protocol == NULL) {
-            break;
+        else if (dif < 0) {
+            return 0;           /* full */
         }
-        badReq = 0;
+        pos = i->queueTail;
     }
-    
-    while ((hdr = getNextHdr(&inBuf)) != NULL) {
-        if (hdr[0] == 0) {
-            break;
-        }
-        else if (strncasecmp(hdr, "Authorization:", 14) == 0) {
-            cp = &hdr[14];
-            cp += strspn(cp, " \t");
-            inBuf.authorization = cp;
+    slot->inst = inst;
+    slot->queued = now_usecs();
+    __sync_synchronize();
+    slot->seq = pos + 1;
+    return 1;
+}
+
+static CIMCInstance *tryDequeue(struct native_indicationlistener *i,
+                                CIMCUint64 *queued)
+{
+    unsigned long pos = i->queueHead;
+    CIMCInstance *inst;
+    Slot *slot;
+    long dif;
+
+    for (;;) {
+        slot = &i->queue[pos & i->queueMask];
+        dif = (long) (slot->seq - (pos + 1));
+        if (dif == 0) {
+            if (__sync_bool_compare_and_swap(&i->queueHead, pos, pos + 1)) {
+                break;
+            }
         }
-        else if (strncasecmp(hdr, "Content-Length:", 15) == 0) {
-            cp = &hdr[15];
-            cp += strspn(cp, " \t");
-            inBuf.content_length = atol(cp);
+        else if (dif < 0) {
+            return NULL;        /* empty */
         }
-        else if (strncasecmp(hdr, "Content-Type:", 13) == 0) {
-            cp = &hdr[13];
-            cp += strspn(cp, " \t");
-            inBuf.content_type = cp;
+        pos = i->queueHead;
+    }
+    inst = slot->inst;
+    *queued = slot->queued;
+    __sync_synchronize();
+    slot->seq = pos + i->queueMask + 1;
+    return inst;
+}
+
+static void enqueueIndication(struct native_indicationlistener *i,
+                              CIMCInstance *inst)
+{
+    CIMCInstance *old;
+    CIMCUint64 queued;
+    struct timespec ts;
+
+    while (!tryEnqueue(i, inst)) {
+        if (i->overflow == CIMC_IL_OVERFLOW_DropNewest || !i->delivering) {
+            inst->ft->release(inst);
+            COUNT(i, dropped);
+            return;
         }
-        else if (strncasecmp(hdr, "Host:", 5) == 0) {
-            cp = &hdr[5];
-            cp += strspn(cp, " \t");
-            inBuf.host = cp;
-            if (strchr(inBuf.host, '/') != NULL || inBuf.host[0] == '.') {
-                if (!discardInput) {
-                    genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
-                    discardInput=2;
-                }
+        if (i->overflow == CIMC_IL_OVERFLOW_DropOldest) {
+            if ((old = tryDequeue(i, &queued)) != NULL) {
+                old->ft->release(old);
+                COUNT(i, dropped);
             }
+            continue;
         }
-        else if (strncasecmp(hdr, "User-Agent:", 11) == 0) {
-            cp = &hdr[11];
-            cp += strspn(cp, " \t");
-            inBuf.useragent = cp;
-        }
-        else if (strncasecmp(hdr, "TE:", 3) == 0) {
-            char *cp = &hdr[3];
-            cp += strspn(cp, " \t");
-            if (strncasecmp(cp,"trailers",8)==0)
-            inBuf.trailers=1;
-        }
-        else if (strncasecmp(hdr, "Expect:", 7) == 0) {
-            if (!discardInput) {
-                genError(conn_fd, &inBuf, 417, "Expectation Failed", NULL);
-                discardInput=2;
+        /* block until the delivery thread makes room */
+        pthread_mutex_lock(&i->queueLock);
+        i->producersWaiting++;
+        __sync_synchronize();
+        if (i->queueTail - i->queueHead > i->queueMask) {
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 100000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
             }
+            pthread_cond_timedwait(&i->spaceCond, &i->queueLock, &ts);
         }
+        i->producersWaiting--;
+        pthread_mutex_unlock(&i->queueLock);
     }
-    
-    if (inBuf.content_length < 0) {
-        if (!discardInput) {
-            genError(conn_fd, &inBuf, 411, "Length Required", NULL);
-        }      
-        commClose(conn_fd);
-        exit(1);
-    }
+    COUNT(i, enqueued);
 
-    getPayload(conn_fd, &inBuf);
-    if (discardInput) {
-        freeBuffer(&inBuf);
-        return;
+    __sync_synchronize();
+    if (i->deliveryWaiting) {
+        pthread_mutex_lock(&i->queueLock);
+        pthread_cond_signal(&i->queueCond);
+        pthread_mutex_unlock(&i->queueLock);
     }
-    
-    /* well, not really an error ... op successful */
-    genError(conn_fd, &inBuf, 200, "OK", NULL);
-    
-    processIndication(i, inBuf.content);
-    
-    freeBuffer(&inBuf);
-    free(conn_fd.buf);
 }
 
-static void* establish_listener(int sslMode, int port, struct native_indicationlistener *i)
+/*
+ * Passes queued indications to the callback, one by one or in batches.
+ * Runs until stop() has joined the workers and the queue is empty.
+ */
+static void* delivery_thread(void *parms)
 {
-    struct sockaddr_in sin;
-    socklen_t sz,sin_len;
-    int listenFd, connFd;
-    int ru;
-    struct timeval timeout;
-    fd_set socksset;
-    int dataRead;
-    char *xml;
+    struct native_indicationlistener *i =
+        (struct native_indicationlistener *) parms;
+    CIMCInstance **batch;
+    CIMCUint64 queued, now, latency;
+    struct timespec ts;
+    int n, k;
 
-    listenFd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-    sin_len = sizeof(sin);
+    batch = (CIMCInstance **) malloc(sizeof(CIMCInstance *) * i->batchSize);
 
-    memset(&sin, 0, sin_len);
-    sin.sin_family = AF_INET;
-    sin.sin_addr.s_addr = INADDR_ANY;
-    sin.sin_port = htons(port);
-    
-    ru = 1;
-    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (char *) &ru, sizeof(ru));
-    
-    if (bind(listenFd, (struct sockaddr *) &sin, sin_len) ||
-        listen(listenFd, 0)) {
-      exit(0);
-    }
-    
-    sz = sizeof(sin);
-    listen(listenFd, 1);
-    
-    while(do_listen) {
-    
-        timeout.tv_sec = 3;
-        timeout.tv_usec = 0;
-        FD_ZERO(&socksset);
-        FD_SET(listenFd,&socksset);
-        
-        dataRead = select(listenFd+1, &socksset, NULL, NULL, &timeout);
-        
-        if(dataRead < 0) {
-            fprintf(stderr, "Error during select(), return value was: %d\n", dataRead);
+    for (;;) {
+        for (n = 0; n < i->batchSize; n++) {
+            if ((batch[n] = tryDequeue(i, &queued)) == NULL) {
+                break;
+            }
+            now = now_usecs();
+            latency = now > queued ? now - queued : 0;
+            i->stats.latencyTotal += latency;
+            if (latency > i->stats.latencyMax) {
+                i->stats.latencyMax = latency;
+            }
         }
-        else if(dataRead == 0) {
-            /* timed out, trying again */
-        } else {
-            if ((connFd = accept(listenFd, (__SOCKADDR_ARG) & sin, &sz))<0) {
-                fprintf(stderr, "Error during accept(), return value was: %d\n", connFd);
-                exit(0);
+
+        if (n) {
+            __sync_synchronize();
+            if (i->producersWaiting) {
+                pthread_mutex_lock(&i->queueLock);
+                pthread_cond_broadcast(&i->spaceCond);
+                pthread_mutex_unlock(&i->queueLock);
             }
-            handleConnection(connFd, i);
-            close(connFd);
+            if (i->sendIndicationBatch) {
+                i->sendIndicationBatch(batch, n);
+            } else {
+                for (k = 0; k < n; k++) {
+                    i->sendIndicationInstance(batch[k]);
+                }
+            }
+            __sync_fetch_and_add(&i->stats.delivered, n);
+            continue;
         }
+
+        if (!i->delivering && i->queueTail == i->queueHead) {
+            break;
+        }
+
+        pthread_mutex_lock(&i->queueLock);
+        i->deliveryWaiting = 1;
+        __sync_synchronize();
+        if (i->queueTail == i->queueHead && i->delivering) {
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 100000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&i->queueCond, &i->queueLock, &ts);
+        }
+        i->deliveryWaiting = 0;
+        pthread_mutex_unlock(&i->queueLock);
     }
 
+    free(batch);
     return NULL;
 }
 
-static void* start_listen_thread(void *parms)
+/*
+ * A test from addFilter(), with its values converted once to the form
+ * they are compared in.
+ */
+typedef union _il_filter_value {
+    char       *chars;
+    CIMCSint64  sint64;
+    CIMCUint64  uint64;
+    CIMCReal64  real64;
+} FilterValue;
+
+#define FILTER_CHARS    1
+#define FILTER_SINT     2
+#define FILTER_UINT     3       /* also booleans */
+#define FILTER_REAL     4
+
+typedef struct _il_filter {
+    char *name;
+    int test;                   /* CIMC_IL_FILTER_ */
+    int kind;                   /* FILTER_ */
+    int count;
+    FilterValue *values;        /* sorted for CIMC_IL_FILTER_In */
+    struct _il_filter *next;
+} Filter;
+
+/*
+ * An indication held for the coalescing window, counting the duplicates
+ * received meanwhile. Found by its key in the hash table and flushed in
+ * the order of the deadlines.
+ */
+typedef struct _il_coalesced {
+    char *key;
+    int keyLength;
+    CIMCUint64 hash;
+    CIMCInstance *inst;
+    CIMCUint32 count;
+    CIMCUint64 deadline;        /* now_usecs() */
+    struct _il_coalesced *chain;        /* next in the same bucket */
+    struct _il_coalesced *next;         /* next to flush */
+} Coalesced;
+
+#define COALESCE_BUCKETS 256
+
+typedef struct _il_select {
+    ParserSelect select;
+    struct native_indicationlistener *i;
+    int coalesce;               /* not when replaying the journal */
+    char *key;                  /* coalescing key of the indication */
+    int keyLength;
+    CIMCUint64 hash;
+} ListenerSelect;
+
+static int filterKind(CIMCType type)
 {
-    struct native_indicationlistener* i;
-    i = (struct native_indicationlistener*) parms;
-    establish_listener(i->sslMode, i->port, i);   
-    return NULL;
+    switch (type) {
+    case CIMC_chars:
+    case CIMC_string:
+        return FILTER_CHARS;
+    case CIMC_sint8:
+    case CIMC_sint16:
+    case CIMC_sint32:
+    case CIMC_sint64:
+        return FILTER_SINT;
+    case CIMC_boolean:
+    case CIMC_uint8:
+    case CIMC_uint16:
+    case CIMC_uint32:
+    case CIMC_uint64:
+        return FILTER_UINT;
+    case CIMC_real32:
+    case CIMC_real64:
+        return FILTER_REAL;
+    }
+    return 0;
 }
 
-static CIMCStatus _ilft_release(CIMCIndicationListener* il)
+static FilterValue filterValue(const CIMCValue *value, CIMCType type)
 {
-    struct native_indicationlistener* i = (struct native_indicationlistener*)
-                                          il;
-                                          
-    if(i) {
-        free(i);
+    FilterValue v;
+
+    switch (type) {
+    case CIMC_chars:   v.chars = strdup(value->chars); break;
+    case CIMC_string:  v.chars = strdup((char *) value->string->hdl); break;
+    case CIMC_sint8:   v.sint64 = value->sint8; break;
+    case CIMC_sint16:  v.sint64 = value->sint16; break;
+    case CIMC_sint32:  v.sint64 = value->sint32; break;
+    case CIMC_sint64:  v.sint64 = value->sint64; break;
+    case CIMC_boolean: v.uint64 = value->boolean != 0; break;
+    case CIMC_uint8:   v.uint64 = value->uint8; break;
+    case CIMC_uint16:  v.uint64 = value->uint16; break;
+    case CIMC_uint32:  v.uint64 = value->uint32; break;
+    case CIMC_uint64:  v.uint64 = value->uint64; break;
+    case CIMC_real32:  v.real64 = value->real32; break;
+    default:           v.real64 = value->real64; break;
     }
-    CIMCStatus ret;
-    ret.rc = CIMC_RC_OK;
-    ret.msg = NULL;
-    return ret;
+    return v;
 }
 
-static CIMCIndicationListener* _ilft_clone(CIMCIndicationListener* il,
-                                           CIMCStatus* rc)
+/* qsort() and bsearch() take no context, the kind to compare is set here */
+static __thread int compareKind;
+
+static int compareFilterValues(const void *a, const void *b)
 {
-    /* not yet implemented. function is just here to comply with the default
-     * function tables. it is questionable if a clone is needed for an
-     * indication listener */
-    return NULL;
+    const FilterValue *x = (const FilterValue *) a;
+    const FilterValue *y = (const FilterValue *) b;
+
+    switch (compareKind) {
+    case FILTER_CHARS:
+        return strcmp(x->chars, y->chars);
+    case FILTER_SINT:
+        return (x->sint64 > y->sint64) - (x->sint64 < y->sint64);
+    case FILTER_UINT:
+        return (x->uint64 > y->uint64) - (x->uint64 < y->uint64);
+    default:
+        return (x->real64 > y->real64) - (x->real64 < y->real64);
+    }
 }
 
-static CIMCStatus _ilft_start(CIMCIndicationListener* il)
+static void releaseFilters(Filter *f)
 {
-    pthread_t id;
-    struct native_indicationlistener* i;
-    
-    i = (struct native_indicationlistener*) il;
-    
-    do_listen = 1;
-    
-    pthread_create(&id, NULL, &start_listen_thread, i);
+    Filter *next;
+    int k;
 
+    for (; f; f = next) {
+        next = f->next;
+        if (f->kind == FILTER_CHARS) {
+            for (k = 0; k < f->count; k++) {
+                free(f->values[k].chars);
+            }
+        }
+        free(f->values);
+        free(f->name);
+        free(f);
+    }
+}
+
+/*
+ * Converts the text of a received property for comparison with f.
+ * Returns 0 if it cannot be compared. A string is unescaped into
+ * *unescaped only if it contains an entity.
+ */
+static int receivedValue(Filter *f, char *text, FilterValue *v,
+                         char **unescaped)
+{
+    char *end;
+
+    *unescaped = NULL;
+    errno = 0;
+    switch (f->kind) {
+    case FILTER_CHARS:
+        if (strchr(text, '&')) {
+            text = *unescaped = XmlToAsciiStr(text);
+        }
+        v->chars = text;
+        return 1;
+    case FILTER_SINT:
+        v->sint64 = strtoll(text, &end, 10);
+        break;
+    case FILTER_UINT:
+        text += strspn(text, " \t\r\n");
+        if (strcasecmp(text, "true") == 0) {
+            v->uint64 = 1;
+            return 1;
+        }
+        if (strcasecmp(text, "false") == 0) {
+            v->uint64 = 0;
+            return 1;
+        }
+        if (*text == '-') {
+            return 0;
+        }
+        v->uint64 = strtoull(text, &end, 10);
+        break;
+    default:
+        v->real64 = strtod(text, &end);
+        break;
+    }
+    return end != text && errno == 0;
+}
+
+static int matchFilter(Filter *f, XtokProperties *ps)
+{
+    XtokProperty *p;
+    FilterValue v;
+    char *unescaped;
+    int match = 0;
+
+    for (p = ps->first; p; p = p->next) {
+        if (strcasecmp(p->name, f->name) == 0) {
+            break;
+        }
+    }
+    if (p == NULL || p->propType != typeProperty_Value ||
+        p->val.null || p->val.value.data.value == NULL ||
+        !receivedValue(f, p->val.value.data.value, &v, &unescaped)) {
+        return 0;
+    }
+
+    compareKind = f->kind;
+    switch (f->test) {
+    case CIMC_IL_FILTER_Equal:
+        match = compareFilterValues(&v, &f->values[0]) == 0;
+        break;
+    case CIMC_IL_FILTER_NotEqual:
+        match = compareFilterValues(&v, &f->values[0]) != 0;
+        break;
+    case CIMC_IL_FILTER_Range:
+        match = compareFilterValues(&v, &f->values[0]) >= 0 &&
+                compareFilterValues(&v, &f->values[1]) <= 0;
+        break;
+    case CIMC_IL_FILTER_In:
+        match = bsearch(&v, f->values, f->count, sizeof(FilterValue),
+                        compareFilterValues) != NULL;
+        break;
+    }
+    free(unescaped);
+    return match;
+}
+
+static int matchFilters(struct native_indicationlistener *i,
+                        XtokProperties *ps)
+{
+    Filter *f;
+
+    for (f = i->filters; f; f = f->next) {
+        if (!matchFilter(f, ps)) {
+            COUNT(i, filtered);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* tags of the fields of a coalescing key */
+#define KEY_CLASS 'c'
+#define KEY_VALUE 'v'
+#define KEY_NULL  'n'
+
+/* key properties used unless setCoalesceKeys() chose others */
+static const char *defaultCoalesceKeys[] = {
+    "SourceInstanceModelPath", "SourceInstanceHost",
+    "AlertingManagedElement", "AlertType", NULL
+};
+
+/*
+ * Appends a field to the coalescing key: its tag, the chars, which hold
+ * no NUL, and a NUL. So no two different sequences of fields give the
+ * same key.
+ */
+static void addKeyField(ListenerSelect *ls, int *size, char tag,
+                        const char *chars, int length)
+{
+    if (ls->keyLength + length + 2 > *size) {
+        *size = (ls->keyLength + length + 2) * 2;
+        ls->key = (char *) realloc(ls->key, *size);
+    }
+    ls->key[ls->keyLength++] = tag;
+    memcpy(ls->key + ls->keyLength, chars, length);
+    ls->keyLength += length;
+    ls->key[ls->keyLength++] = 0;
+}
+
+static void addKeyValue(ListenerSelect *ls, int *size, XtokProperty *p)
+{
+    char *unescaped;
+
+    if (p == NULL || p->propType != typeProperty_Value || p->val.null ||
+        p->val.value.data.value == NULL) {
+        /* absent and null properties are keyed alike */
+        addKeyField(ls, size, KEY_NULL, "", 0);
+    } else if (strchr(p->val.value.data.value, '&')) {
+        unescaped = XmlToAsciiStr(p->val.value.data.value);
+        addKeyField(ls, size, KEY_VALUE, unescaped, strlen(unescaped));
+        free(unescaped);
+    } else {
+        addKeyField(ls, size, KEY_VALUE, p->val.value.data.value,
+                    strlen(p->val.value.data.value));
+    }
+}
+
+/*
+ * Builds the coalescing key from the class name and the values of the
+ * key properties, by default those naming the source of the
+ * indication, and hashes it (FNV-1a).
+ */
+static void coalesceKey(struct native_indicationlistener *i,
+                        const char *className, XtokProperties *ps,
+                        ListenerSelect *ls)
+{
+    XtokProperty *p;
+    const char **name;
+    int k, size = 0;
+
+    ls->keyLength = 0;
+    addKeyField(ls, &size, KEY_CLASS, className ? className : "",
+                className ? strlen(className) : 0);
+    name = i->coalesceKeys ? (const char **) i->coalesceKeys
+                           : defaultCoalesceKeys;
+    for (; *name; name++) {
+        for (p = ps->first; p; p = p->next) {
+            if (strcasecmp(p->name, *name) == 0) {
+                break;
+            }
+        }
+        addKeyValue(ls, &size, p);
+    }
+
+    ls->hash = 14695981039346656037ULL;
+    for (k = 0; k < ls->keyLength; k++) {
+        ls->hash = (ls->hash ^ (unsigned char) ls->key[k]) * 1099511628211ULL;
+    }
+}
+
+/* called with coalesceLock held */
+static Coalesced **findCoalesced(struct native_indicationlistener *i,
+                                 ListenerSelect *ls)
+{
+    Coalesced **c;
+
+    for (c = &i->coalesceTable[ls->hash & i->coalesceMask]; *c;
+         c = &(*c)->chain) {
+        if ((*c)->hash == ls->hash && (*c)->keyLength == ls->keyLength &&
+            memcmp((*c)->key, ls->key, ls->keyLength) == 0) {
+            break;
+        }
+    }
+    return c;
+}
+
+/*
+ * Counts the indication if one with the same key is being held, in which
+ * case no instance needs to be built for it.
+ */
+static int absorbDuplicate(struct native_indicationlistener *i,
+                           ListenerSelect *ls)
+{
+    Coalesced *c;
+
+    pthread_mutex_lock(&i->coalesceLock);
+    c = *findCoalesced(i, ls);
+    if (c) {
+        c->count++;
+        COUNT(i, coalesced);
+    }
+    pthread_mutex_unlock(&i->coalesceLock);
+    return c != NULL;
+}
+
+static void growCoalesceTable(struct native_indicationlistener *i)
+{
+    unsigned long size = (i->coalesceMask + 1) * 2, k;
+    Coalesced **table, *c, *next;
+
+    table = (Coalesced **) calloc(size, sizeof(Coalesced *));
+    for (k = 0; k <= i->coalesceMask; k++) {
+        for (c = i->coalesceTable[k]; c; c = next) {
+            next = c->chain;
+            c->chain = table[c->hash & (size - 1)];
+            table[c->hash & (size - 1)] = c;
+        }
+    }
+    free(i->coalesceTable);
+    i->coalesceTable = table;
+    i->coalesceMask = size - 1;
+}
+
+/*
+ * Holds a new indication for the coalescing window. The key of ls is
+ * taken over.
+ */
+static void addCoalesced(struct native_indicationlistener *i,
+                         ListenerSelect *ls, CIMCInstance *inst)
+{
+    Coalesced **link, *c;
+
+    pthread_mutex_lock(&i->coalesceLock);
+    link = findCoalesced(i, ls);
+    if (*link) {
+        /* another worker held one first */
+        (*link)->count++;
+        COUNT(i, coalesced);
+        pthread_mutex_unlock(&i->coalesceLock);
+        inst->ft->release(inst);
+        return;
+    }
+
+    c = (Coalesced *) malloc(sizeof(Coalesced));
+    c->key = ls->key;
+    c->keyLength = ls->keyLength;
+    c->hash = ls->hash;
+    c->inst = inst;
+    c->count = 1;
+    c->deadline = now_usecs() + (CIMCUint64) i->coalesceWindow * 1000;
+    c->chain = NULL;
+    c->next = NULL;
+    ls->key = NULL;
+
+    *link = c;
+    if (i->coalesceTail) {
+        i->coalesceTail->next = c;
+    } else {
+        i->coalesceHead = c;
+        pthread_cond_signal(&i->coalesceCond);
+    }
+    i->coalesceTail = c;
+    if (++i->coalesceCount > 2 * (i->coalesceMask + 1)) {
+        growCoalesceTable(i);
+    }
+    pthread_mutex_unlock(&i->coalesceLock);
+}
+
+/*
+ * Queues the held indications whose window has passed, all of them once
+ * stop() has joined the workers.
+ */
+static void* coalesce_thread(void *parms)
+{
+    struct native_indicationlistener *i =
+        (struct native_indicationlistener *) parms;
+    Coalesced *c, **link;
+    CIMCUint64 now, wait;
+    CIMCUint32 count;
+    struct timespec ts;
+
+    pthread_mutex_lock(&i->coalesceLock);
+    for (;;) {
+        now = now_usecs();
+        c = i->coalesceHead;
+        if (c && (c->deadline <= now || !i->coalescing)) {
+            i->coalesceHead = c->next;
+            if (i->coalesceHead == NULL) {
+                i->coalesceTail = NULL;
+            }
+            for (link = &i->coalesceTable[c->hash & i->coalesceMask];
+                 *link != c; link = &(*link)->chain);
+            *link = c->chain;
+            i->coalesceCount--;
+            pthread_mutex_unlock(&i->coalesceLock);
+
+            count = c->count;
+            c->inst->ft->setProperty(c->inst, CIMC_IL_RepeatCount,
+                                     (CIMCValue *) &count, CIMC_uint32);
+            enqueueIndication(i, c->inst);
+            free(c->key);
+            free(c);
+
+            pthread_mutex_lock(&i->coalesceLock);
+            continue;
+        }
+        if (!i->coalescing) {
+            break;
+        }
+
+        wait = c ? c->deadline - now : 100000;
+        if (wait > 100000) {
+            wait = 100000;
+        }
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += wait * 1000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&i->coalesceCond, &i->coalesceLock, &ts);
+    }
+    pthread_mutex_unlock(&i->coalesceLock);
+    return NULL;
+}
+
+/*
+ * Called by the parser with the received properties of an indication,
+ * before an instance is built from them.
+ */
+static int selectIndication(ParserSelect *sel, const char *className,
+                            XtokProperties *ps)
+{
+    ListenerSelect *ls = (ListenerSelect *) sel;
+    struct native_indicationlistener *i = ls->i;
+
+    if (i->filters && !matchFilters(i, ps)) {
+        return 0;
+    }
+    if (ls->coalesce) {
+        coalesceKey(i, className, ps, ls);
+        if (absorbDuplicate(i, ls)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void processIndication(struct native_indicationlistener *i, char *xml,
+                              int length)
+{
+    ResponseHdr rh;
+    ListenerSelect sel;
+    
+    CIMCInstance *inst;
+    
+    /* journaled as received, before the parser modifies it */
+    if (i->journal && appendJournal(i->journal, xml, length)) {
+        COUNT(i, journaled);
+    }
+
+    sel.select.match = i->filters || i->coalesceWindow ? selectIndication
+                                                        : NULL;
+    sel.select.propertyList = i->projection;
+    sel.i = i;
+    sel.coalesce = i->coalesceWindow != 0;
+    sel.key = NULL;
+    rh = scanCimXmlResponseInPlace(xml, NULL,
+                                   sel.select.match || i->projection ?
+                                   &sel.select : NULL);
+    
+    if (rh.errCode != 0 || !rh.methodCall) {
+        /* a well-formed response is no export request either */
+        if (rh.rc || !rh.methodCall) {
+            COUNT(i, parseErrors);
+        }
+        free(sel.key);
+        free(rh.description);
+        if (rh.outArgs) {
+            rh.outArgs->ft->release(rh.outArgs);
+        }
+        rh.rvArray->ft->release(rh.rvArray);
+        return;
+    }
+   
+    /* the instance does not depend on the request, so it is handed on
+       as it is */
+    inst = (CIMCInstance*)simpleArrayTake(rh.rvArray, 0).value.inst;
+    
+    if (inst && i->coalesceWindow) {
+        addCoalesced(i, &sel, inst);
+    } else if (inst) {
+        enqueueIndication(i, inst);
+    }
+    
+    free(sel.key);
+    rh.rvArray->ft->release(rh.rvArray);
+}
+
+/*
+ * Serves one request. Returns 1 if the connection stays open for the
+ * next request, 0 if it has been closed.
+ */
+static int handleConnection(Connection *conn, struct native_indicationlistener *i)
+{
+    Buffer inBuf = { NULL, NULL, 0, 0, 0, 0, 0 ,0};
+    int badReq = 0;
+    int discardInput=0;
+    int keepAlive;
+    char *path, *hdr;
+    char *cp, *end;
+    char more[100];
+    CommHndl conn_fd;
+    long length;
+    int rc;
+    
+    inBuf.authorization = "";
+    inBuf.protocol="HTTP/1.1";
+    inBuf.content_type = NULL;
+    inBuf.content_length = -1;
+    inBuf.host = NULL;
+    inBuf.useragent = "";
+    inBuf.connection = NULL;
+    
+    conn_fd.socket=conn->socket;
+    conn_fd.file=NULL;
+    conn_fd.buf = NULL;
+
+    if (conn->pending) {
+        add2buffer(&inBuf, conn->pending, conn->pendingLength);
+        free(conn->pending);
+        conn->pending = NULL;
+        conn->pendingLength = 0;
+    }
+
+    rc=getHdrs(conn_fd, &inBuf,"POST ", i->wakeFd);
+    
+    if (inBuf.length == 0) {
+        /* the sender closed or did not reuse a persistent connection */
+        if (rc==3) {
+            COUNT(i, timeouts);
+        } else if (conn->requests == 0) {
+            COUNT(i, disconnects);
+        }
+        freeBuffer(&inBuf);
+        commClose(conn_fd);
+        return 0;
+    }
+    COUNT(i, requests);
+    
+    if (rc==1) { 
+        genError(conn_fd, &inBuf, 501, "Not Implemented", NULL);
+        /* we continue to parse headers and empty the socket
+        to be graceful with the client */
+        discardInput=1;
+    }
+    else if (rc==2) {
+        genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
+        discardInput=2;
+        /* potential DOS attempt discovered */      
+    }
+    else if (rc==3) {
+        /* incomplete headers, the request timed out */
+        genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
+        COUNT(i, timeouts);
+        freeBuffer(&inBuf);
+        commClose(conn_fd);
+        return 0;
+    }
+    
+    inBuf.httpHdr = getNextHdr(&inBuf);
+    for (badReq = 1;;) {
+        if (inBuf.httpHdr == NULL) {
+            break;
+        }
+        path = strpbrk(inBuf.httpHdr, " \t\r\n");
+        if (path == NULL) {
+            break;
+        }
+        *path++ = 0;
+        path += strspn(path, " \t\r\n");
+        cp = strpbrk(path, " \t\r\n");
+        if (cp == NULL) {
+            break;
+        }
+        *cp++ = 0;
+        inBuf.protocol = cp;
+        badReq = 0;
+        break;
+    }
+    if (badReq && !discardInput) {
+        genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
+        discardInput=2;
+    }
+    
+    while ((hdr = getNextHdr(&inBuf)) != NULL) {
+        if (hdr[0] == 0) {
+            break;
+        }
+        else if (strncasecmp(hdr, "Authorization:", 14) == 0) {
+            cp = &hdr[14];
+            cp += strspn(cp, " \t");
+            inBuf.authorization = cp;
+        }
+        else if (strncasecmp(hdr, "Content-Length:", 15) == 0) {
+            cp = &hdr[15];
+            cp += strspn(cp, " \t");
+            errno = 0;
+            length = strtol(cp, &end, 10);
+            if (end == cp || end[strspn(end, " \t")] != 0 || errno ||
+                length < 0) {
+                if (!discardInput) {
+                    genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
+                    discardInput=2;
+                }
+            }
+            else if (length > i->maxPayload) {
+                if (!discardInput) {
+                    genError(conn_fd, &inBuf, 413,
+                             "Request Entity Too Large", NULL);
+                    discardInput=2;
+                }
+            }
+            else {
+                inBuf.content_length = length;
+            }
+        }
+        else if (strncasecmp(hdr, "Content-Type:", 13) == 0) {
+            cp = &hdr[13];
+            cp += strspn(cp, " \t");
+            inBuf.content_type = cp;
+        }
+        else if (strncasecmp(hdr, "Host:", 5) == 0) {
+            cp = &hdr[5];
+            cp += strspn(cp, " \t");
+            inBuf.host = cp;
+            if (strchr(inBuf.host, '/') != NULL || inBuf.host[0] == '.') {
+                if (!discardInput) {
+                    genError(conn_fd, &inBuf, 400, "Bad Request", NULL);
+                    discardInput=2;
+                }
+            }
+        }
+        else if (strncasecmp(hdr, "Connection:", 11) == 0) {
+            cp = &hdr[11];
+            cp += strspn(cp, " \t");
+            inBuf.connection = cp;
+        }
+        else if (strncasecmp(hdr, "User-Agent:", 11) == 0) {
+            cp = &hdr[11];
+            cp += strspn(cp, " \t");
+            inBuf.useragent = cp;
+        }
+        else if (strncasecmp(hdr, "TE:", 3) == 0) {
+            char *cp = &hdr[3];
+            cp += strspn(cp, " \t");
+            if (strncasecmp(cp,"trailers",8)==0)
+            inBuf.trailers=1;
+        }
+        else if (strncasecmp(hdr, "Expect:", 7) == 0) {
+            if (!discardInput) {
+                genError(conn_fd, &inBuf, 417, "Expectation Failed", NULL);
+                discardInput=2;
+            }
+        }
+    }
+    
+    if (inBuf.content_length < 0) {
+        if (!discardInput) {
+            genError(conn_fd, &inBuf, 411, "Length Required", NULL);
+        }      
+        COUNT(i, badRequests);
+        freeBuffer(&inBuf);
+        commClose(conn_fd);
+        return 0;
+    }
+
+    rc = getPayload(conn_fd, &inBuf, i->wakeFd);
+    if (rc) {
+        if (rc == -2) {
+            if (!discardInput) {
+                genError(conn_fd, &inBuf, 500, "Internal Server Error", NULL);
+            }
+            COUNT(i, badRequests);
+        } else if (rc == -3) {
+            /* the payload stalled, or the listener stops */
+            if (!discardInput) {
+                genError(conn_fd, &inBuf, 408, "Request Timeout", NULL);
+            }
+            COUNT(i, timeouts);
+        } else {
+            /* the sender closed the connection within the payload */
+            COUNT(i, disconnects);
+        }
+        freeBuffer(&inBuf);
+        commClose(conn_fd);
+        return 0;
+    }
+    if (discardInput) {
+        COUNT(i, badRequests);
+        freeBuffer(&inBuf);
+        commClose(conn_fd);
+        return 0;
+    }
+
+    /* HTTP/1.1 connections persist unless closed, HTTP/1.0 ones on request */
+    conn->requests++;
+    if (strcasecmp(inBuf.protocol, "HTTP/1.1") == 0) {
+        keepAlive = inBuf.connection == NULL ||
+                    strncasecmp(inBuf.connection, "close", 5) != 0;
+    } else {
+        keepAlive = inBuf.connection != NULL &&
+                    strncasecmp(inBuf.connection, "keep-alive", 10) == 0;
+    }
+    keepAlive = keepAlive && i->keepAliveTimeout > 0 &&
+                conn->requests < i->keepAliveMax;
+
+    /* well, not really an error ... op successful */
+    if (keepAlive) {
+        snprintf(more, sizeof(more),
+                 "Connection: Keep-Alive\r\nKeep-Alive: timeout=%d, max=%d\r\n",
+                 i->keepAliveTimeout, i->keepAliveMax - conn->requests);
+        genError(conn_fd, &inBuf, 200, "OK", more);
+        if (inBuf.ptr < inBuf.length) {
+            conn->pendingLength = inBuf.length - inBuf.ptr;
+            conn->pending = (char *) malloc(conn->pendingLength);
+            memcpy(conn->pending, inBuf.data + inBuf.ptr, conn->pendingLength);
+        }
+    } else {
+        genError(conn_fd, &inBuf, 200, "OK", NULL);
+        commClose(conn_fd);
+    }
+    
+    /* any following request is saved, the payload can be parsed in place */
+    inBuf.content[inBuf.content_length] = 0;
+    processIndication(i, inBuf.content, inBuf.content_length);
+    
+    freeBuffer(&inBuf);
+    return keepAlive;
+}
+
+/*
+ * Hands a connection with data to read to the workers.
+ */
+static void queueConnection(struct native_indicationlistener *i,
+                            Connection *conn)
+{
+    Connection **conns;
+
+    pthread_mutex_lock(&i->connLock);
+    if (i->connCount == i->connSize) {
+        conns = (Connection **) malloc(sizeof(Connection *) *
+                                       (i->connSize ? i->connSize * 2 : 64));
+        if (i->connSize) {
+            /* unwrap the ring into the new array */
+            memcpy(conns, i->conns + i->connHead,
+                   sizeof(Connection *) * (i->connSize - i->connHead));
+            memcpy(conns + i->connSize - i->connHead, i->conns,
+                   sizeof(Connection *) * i->connHead);
+            free(i->conns);
+        }
+        i->connSize = i->connSize ? i->connSize * 2 : 64;
+        i->conns = conns;
+        i->connHead = 0;
+    }
+    conn->state = CONN_QUEUED;
+    i->conns[(i->connHead + i->connCount++) % i->connSize] = conn;
+    pthread_cond_signal(&i->connCond);
+    pthread_mutex_unlock(&i->connLock);
+}
+
+/*
+ * Returns the next connection to read from, NULL when the listener stops.
+ */
+static Connection *nextConnection(struct native_indicationlistener *i)
+{
+    Connection *conn = NULL;
+
+    pthread_mutex_lock(&i->connLock);
+    while (i->connCount == 0 && i->listening) {
+        pthread_cond_wait(&i->connCond, &i->connLock);
+    }
+    if (i->connCount) {
+        conn = i->conns[i->connHead];
+        i->connHead = (i->connHead + 1) % i->connSize;
+        i->connCount--;
+    }
+    pthread_mutex_unlock(&i->connLock);
+    return conn;
+}
+
+static void releaseConnection(struct native_indicationlistener *i,
+                              Connection *conn)
+{
+    pthread_mutex_lock(&i->connLock);
+    if (conn->prev) conn->prev->next = conn->next;
+    else i->connList = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    pthread_mutex_unlock(&i->connLock);
+    free(conn->pending);
+    free(conn);
+}
+
+/*
+ * Waits for the next request on a persistent connection.
+ */
+static void rearmConnection(struct native_indicationlistener *i,
+                            Connection *conn)
+{
+    struct epoll_event ev;
+
+    if (conn->pending) {
+        /* the sender did not wait for the response */
+        queueConnection(i, conn);
+        return;
+    }
+    /* idle only once armed, so closeIdleConnections() cannot free it
+       before, and under the lock, so not before the event is queued */
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = conn;
+    pthread_mutex_lock(&i->connLock);
+    if (epoll_ctl(i->epollFd, EPOLL_CTL_MOD, conn->socket, &ev) == 0) {
+        conn->state = CONN_IDLE;
+        conn->lastActive = now_secs();
+        pthread_mutex_unlock(&i->connLock);
+        return;
+    }
+    pthread_mutex_unlock(&i->connLock);
+    close(conn->socket);
+    releaseConnection(i, conn);
+}
+
+static void* worker_thread(void *parms)
+{
+    struct native_indicationlistener *i =
+        (struct native_indicationlistener *) parms;
+    Connection *conn;
+
+    while ((conn = nextConnection(i)) != NULL) {
+        if (handleConnection(conn, i)) {
+            rearmConnection(i, conn);
+        } else {
+            releaseConnection(i, conn);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Accepts all pending connections. They are handed to the workers once
+ * the client has sent data. A worker gives up on a request whose
+ * headers are not complete within HDR_TIMEOUT or whose payload is not
+ * within PAYLOAD_TIMEOUT, or when the listener stops, so a slow client
+ * holds a worker for a bounded time only.
+ */
+static void acceptConnections(struct native_indicationlistener *i)
+{
+    struct epoll_event ev;
+    Connection *conn;
+    int connFd;
+
+    for (;;) {
+        connFd = accept(i->listenFd, NULL, NULL);
+        if (connFd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                COUNT(i, acceptErrors);
+                /* out of descriptors or memory, give it a second */
+                ev.events = 0;
+                ev.data.ptr = &i->listenFd;
+                epoll_ctl(i->epollFd, EPOLL_CTL_MOD, i->listenFd, &ev);
+                i->acceptPaused = time(NULL);
+            }
+            return;
+        }
+        COUNT(i, connections);
+        fcntl(connFd, F_SETFD, FD_CLOEXEC);
+
+        conn = (Connection *) calloc(1, sizeof(Connection));
+        conn->socket = connFd;
+        conn->lastActive = now_secs();
+        pthread_mutex_lock(&i->connLock);
+        conn->next = i->connList;
+        if (conn->next) conn->next->prev = conn;
+        i->connList = conn;
+        pthread_mutex_unlock(&i->connLock);
+
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = conn;
+        if (epoll_ctl(i->epollFd, EPOLL_CTL_ADD, connFd, &ev)) {
+            close(connFd);
+            releaseConnection(i, conn);
+        }
+    }
+}
+
+/*
+ * Closes connections that have been waiting for a request for longer
+ * than the keep-alive timeout.
+ */
+static void closeIdleConnections(struct native_indicationlistener *i)
+{
+    Connection *conn, *next;
+    time_t now = now_secs();
+
+    pthread_mutex_lock(&i->connLock);
+    for (conn = i->connList; conn; conn = next) {
+        next = conn->next;
+        /* a new connection gets as long as getHdrs() waits for data */
+        if (conn->state == CONN_IDLE &&
+            now - conn->lastActive >= (conn->requests ? i->keepAliveTimeout
+                                                      : HDR_TIMEOUT)) {
+            epoll_ctl(i->epollFd, EPOLL_CTL_DEL, conn->socket, NULL);
+            close(conn->socket);
+            if (conn->prev) conn->prev->next = conn->next;
+            else i->connList = conn->next;
+            if (conn->next) conn->next->prev = conn->prev;
+            free(conn->pending);
+            free(conn);
+        }
+    }
+    pthread_mutex_unlock(&i->connLock);
+}
+
+/*
+ * Removes a socket file left behind by a listener that did not stop.
+ * Fails if the file is not a socket or a listener still accepts on it.
+ */
+static int removeStaleSocket(struct sockaddr_un *sunaddr)
+{
+    struct stat st;
+    int fd, live;
+
+    if (lstat(sunaddr->sun_path, &st)) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    fd = socket(PF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    live = connect(fd, (struct sockaddr *) sunaddr, sizeof(*sunaddr)) == 0;
+    close(fd);
+    if (live) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return unlink(sunaddr->sun_path);
+}
+
+/*
+ * Opens the listening socket, reporting failures in the returned status.
+ * With a socket path the listener accepts on a UNIX socket, which only
+ * local processes allowed to open the path can reach, else on the port
+ * on all interfaces.
+ */
+static CIMCStatus establish_listener(int sslMode, int port, struct native_indicationlistener *i)
+{
+    struct sockaddr_in sin;
+    struct sockaddr_un sunaddr;
+    struct sockaddr *sa;
+    struct stat st;
+    socklen_t sa_len;
+    int listenFd;
+    int ru;
+    char msg[256 + sizeof(sunaddr.sun_path)];
+    const char *call = "socket";
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->socketPath) {
+        memset(&sunaddr, 0, sizeof(sunaddr));
+        sunaddr.sun_family = AF_UNIX;
+        if (strlen(i->socketPath) >= sizeof(sunaddr.sun_path)) {
+            listenFd = -1;
+            errno = ENAMETOOLONG;
+        }
+        else {
+            strcpy(sunaddr.sun_path, i->socketPath);
+            listenFd = socket(PF_UNIX, SOCK_STREAM, 0);
+        }
+        sa = (struct sockaddr *) &sunaddr;
+        sa_len = sizeof(sunaddr);
+    }
+    else {
+        listenFd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = INADDR_ANY;
+        sin.sin_port = htons(port);
+        sa = (struct sockaddr *) &sin;
+        sa_len = sizeof(sin);
+
+        ru = 1;
+        if (listenFd >= 0) {
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (char *) &ru, sizeof(ru));
+        }
+    }
+
+    if (listenFd < 0 ||
+        (call = "bind", (i->socketPath && removeStaleSocket(&sunaddr)) ||
+                        bind(listenFd, sa, sa_len)) ||
+        (call = "listen", listen(listenFd, i->backlog))) {
+        if (i->socketPath) {
+            snprintf(msg, sizeof(msg), "%s() for socket %s failed: %s", call,
+                     i->socketPath, strerror(errno));
+        }
+        else {
+            snprintf(msg, sizeof(msg), "%s() for port %d failed: %s", call,
+                     port, strerror(errno));
+        }
+        if (listenFd >= 0) {
+            if (i->socketPath && strcmp(call, "listen") == 0) {
+                unlink(i->socketPath);
+            }
+            close(listenFd);
+        }
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *) native_new_CMPIString(msg, NULL);
+        return ret;
+    }
+    /* stop() removes the socket file unless another listener replaced it */
+    if (i->socketPath) {
+        i->socketInode = stat(i->socketPath, &st) ? 0 : st.st_ino;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    fcntl(listenFd, F_SETFD, FD_CLOEXEC);
+    i->listenFd = listenFd;
+    return ret;
+}
+
+static void* serve_listener(struct native_indicationlistener *i)
+{
+    struct epoll_event ev, events[MAX_EVENTS];
+    time_t lastSweep = time(NULL);
+    int n, k;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &i->listenFd;
+    epoll_ctl(i->epollFd, EPOLL_CTL_ADD, i->listenFd, &ev);
+    
+    while(i->listening) {
+    
+        n = epoll_wait(i->epollFd, events, MAX_EVENTS, 1000);
+        
+        if (n < 0) {
+            if (errno != EINTR) {
+                /* reported by getStatistics(), do not spin on it */
+                COUNT(i, pollErrors);
+                usleep(100000);
+            }
+            continue;
+        }
+        for (k = 0; k < n; k++) {
+            if (events[k].data.ptr == &i->wakeFd) {
+                /* stop requested */
+            }
+            else if (events[k].data.ptr == &i->listenFd) {
+                acceptConnections(i);
+            }
+            else {
+                queueConnection(i, (Connection *) events[k].data.ptr);
+            }
+        }
+        if (time(NULL) != lastSweep) {
+            lastSweep = time(NULL);
+            closeIdleConnections(i);
+            if (i->acceptPaused && lastSweep - i->acceptPaused >= 1) {
+                ev.events = EPOLLIN;
+                ev.data.ptr = &i->listenFd;
+                epoll_ctl(i->epollFd, EPOLL_CTL_MOD, i->listenFd, &ev);
+                i->acceptPaused = 0;
+            }
+        }
+    }
+
+    /* let the workers drain the queue and exit */
+    pthread_mutex_lock(&i->connLock);
+    pthread_cond_broadcast(&i->connCond);
+    pthread_mutex_unlock(&i->connLock);
+
+    return NULL;
+}
+
+static void* start_listen_thread(void *parms)
+{
+    struct native_indicationlistener* i;
+    i = (struct native_indicationlistener*) parms;
+    serve_listener(i);
+    return NULL;
+}
+
+static char **copyNameList(const char **names)
+{
+    char **copy;
+    int k, n;
+
+    if (names == NULL) {
+        return NULL;
+    }
+    for (n = 0; names[n]; n++);
+    copy = (char **) malloc((n + 1) * sizeof(char *));
+    for (k = 0; k < n; k++) {
+        copy[k] = strdup(names[k]);
+    }
+    copy[n] = NULL;
+    return copy;
+}
+
+static void freeNameList(char **names)
+{
+    int k;
+
+    if (names) {
+        for (k = 0; names[k]; k++) {
+            free(names[k]);
+        }
+        free(names);
+    }
+}
+
+static CIMCStatus _ilft_release(CIMCIndicationListener* il)
+{
+    struct native_indicationlistener* i = (struct native_indicationlistener*)
+                                          il;
+                                          
+    if(i) {
+        if (i->running) {
+            il->ft->stop(il);
+        }
+        pthread_mutex_destroy(&i->connLock);
+        pthread_cond_destroy(&i->connCond);
+        pthread_mutex_destroy(&i->queueLock);
+        pthread_cond_destroy(&i->queueCond);
+        pthread_cond_destroy(&i->spaceCond);
+        free(i->conns);
+        releaseFilters(i->filters);
+        freeNameList(i->projection);
+        freeNameList(i->coalesceKeys);
+        free(i->journalDirectory);
+        free(i->socketPath);
+        pthread_mutex_destroy(&i->coalesceLock);
+        pthread_cond_destroy(&i->coalesceCond);
+        free(i);
+    }
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+    return ret;
+}
+
+static CIMCIndicationListener* _ilft_clone(CIMCIndicationListener* il,
+                                           CIMCStatus* rc)
+{
+    /* not yet implemented. function is just here to comply with the default
+     * function tables. it is questionable if a clone is needed for an
+     * indication listener */
+    return NULL;
+}
+
+static CIMCStatus _ilft_start(CIMCIndicationListener* il)
+{
+    struct native_indicationlistener* i;
+    struct epoll_event ev;
+    int k;
+    
+    i = (struct native_indicationlistener*) il;
+    
     CIMCStatus ret;
     ret.rc = CIMC_RC_OK;
     ret.msg = NULL;
+
+    if (i->running) {
+        return ret;
+    }
+
+    if (i->journalDirectory) {
+        i->journal = openJournal(i->journalDirectory, i->journalSegmentSize,
+                                 i->journalSync, &ret);
+        if (i->journal == NULL) {
+            return ret;
+        }
+    }
+
+    i->listenFd = -1;
+    ret = establish_listener(i->sslMode, i->port, i);
+    if (ret.rc) {
+        if (i->journal) {
+            closeJournal(i->journal);
+            i->journal = NULL;
+        }
+        return ret;
+    }
+
+    i->epollFd = epoll_create(MAX_EVENTS);
+    i->wakeFd = eventfd(0, 0);
+    if (i->epollFd < 0 || i->wakeFd < 0) {
+        if (i->epollFd >= 0) close(i->epollFd);
+        if (i->wakeFd >= 0) close(i->wakeFd);
+        close(i->listenFd);
+        if (i->journal) {
+            closeJournal(i->journal);
+            i->journal = NULL;
+        }
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *) native_new_CMPIString(strerror(errno), NULL);
+        return ret;
+    }
+    i->listening = 1;
+    i->acceptPaused = 0;
+    fcntl(i->epollFd, F_SETFD, FD_CLOEXEC);
+    fcntl(i->wakeFd, F_SETFD, FD_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &i->wakeFd;
+    epoll_ctl(i->epollFd, EPOLL_CTL_ADD, i->wakeFd, &ev);
+
+    initQueue(i);
+    i->delivering = 1;
+    pthread_create(&i->deliveryThread, NULL, &delivery_thread, i);
+
+    if (i->coalesceWindow) {
+        i->coalesceTable = (Coalesced **) calloc(COALESCE_BUCKETS,
+                                                 sizeof(Coalesced *));
+        i->coalesceMask = COALESCE_BUCKETS - 1;
+        i->coalescing = 1;
+        pthread_create(&i->coalesceThread, NULL, &coalesce_thread, i);
+    }
+
+    i->workers = (pthread_t *) calloc(i->numWorkers, sizeof(pthread_t));
+    for (k = 0; k < i->numWorkers; k++) {
+        pthread_create(&i->workers[k], NULL, &worker_thread, i);
+    }
+    pthread_create(&i->listenThread, NULL, &start_listen_thread, i);
+    i->running = 1;
+
     return ret;
 }
 
 static CIMCStatus _ilft_stop(CIMCIndicationListener* il)
 {
-    do_listen = 0;
+    struct native_indicationlistener* i;
+    struct stat st;
+    uint64_t one = 1;
+    int k;
+
+    i = (struct native_indicationlistener*) il;
+
+    i->listening = 0;
+
+    if (i->running) {
+        write(i->wakeFd, &one, sizeof(one));
+        pthread_join(i->listenThread, NULL);
+        for (k = 0; k < i->numWorkers; k++) {
+            pthread_join(i->workers[k], NULL);
+        }
+        free(i->workers);
+        i->workers = NULL;
+        if (i->journal) {
+            closeJournal(i->journal);
+            i->journal = NULL;
+        }
+
+        /* queue what is still held, then deliver what is queued */
+        if (i->coalesceTable) {
+            pthread_mutex_lock(&i->coalesceLock);
+            i->coalescing = 0;
+            pthread_cond_signal(&i->coalesceCond);
+            pthread_mutex_unlock(&i->coalesceLock);
+            pthread_join(i->coalesceThread, NULL);
+            free(i->coalesceTable);
+            i->coalesceTable = NULL;
+        }
+
+        i->delivering = 0;
+        pthread_mutex_lock(&i->queueLock);
+        pthread_cond_broadcast(&i->queueCond);
+        pthread_mutex_unlock(&i->queueLock);
+        pthread_join(i->deliveryThread, NULL);
+        free(i->queue);
+        i->queue = NULL;
+
+        /* connections waiting for a request are dropped */
+        while (i->connList) {
+            close(i->connList->socket);
+            releaseConnection(i, i->connList);
+        }
+        close(i->epollFd);
+        close(i->wakeFd);
+        if (i->listenFd >= 0) close(i->listenFd);
+        if (i->socketPath && i->socketInode &&
+            stat(i->socketPath, &st) == 0 && st.st_ino == i->socketInode) {
+            unlink(i->socketPath);
+        }
+        i->running = 0;
+    }
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+    return ret;
+}
+
+static CIMCStatus _ilft_setOption(CIMCIndicationListener* il, int option,
+                                  long value)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    switch (option) {
+    case CIMC_IL_OPT_Backlog:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->backlog = value;
+        }
+        break;
+    case CIMC_IL_OPT_Workers:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->numWorkers = value;
+        }
+        break;
+    case CIMC_IL_OPT_KeepAliveTimeout:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->keepAliveTimeout = value;
+        }
+        break;
+    case CIMC_IL_OPT_KeepAliveMax:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->keepAliveMax = value;
+        }
+        break;
+    case CIMC_IL_OPT_QueueSize:
+        if (value < 1 || value > 1L << 24) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->queueSize = value;
+        }
+        break;
+    case CIMC_IL_OPT_Overflow:
+        if (value != CIMC_IL_OVERFLOW_Block &&
+            value != CIMC_IL_OVERFLOW_DropOldest &&
+            value != CIMC_IL_OVERFLOW_DropNewest) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->overflow = value;
+        }
+        break;
+    case CIMC_IL_OPT_BatchSize:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->batchSize = value;
+        }
+        break;
+    case CIMC_IL_OPT_CoalesceWindow:
+        if (value < 0) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->coalesceWindow = value;
+        }
+        break;
+    case CIMC_IL_OPT_JournalSegmentSize:
+        if (value < 64 * 1024) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->journalSegmentSize = value;
+        }
+        break;
+    case CIMC_IL_OPT_JournalSync:
+        if (value < 1) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->journalSync = value;
+        }
+        break;
+    case CIMC_IL_OPT_MaxPayload:
+        if (value < 1 || value > 1L << 30) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        } else {
+            i->maxPayload = value;
+        }
+        break;
+    default:
+        ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+    }
+    return ret;
+}
+
+static CIMCStatus _ilft_setBatchCallback(CIMCIndicationListener* il,
+                                         void (*fp) (CIMCInstance **indInstances,
+                                                     int count))
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+    i->sendIndicationBatch = fp;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+    return ret;
+}
+
+static CIMCStatus _ilft_getStatistics(CIMCIndicationListener* il,
+                                      CIMCIndicationListenerStats* stats)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+    *stats = i->stats;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+    return ret;
+}
+
+static CIMCStatus _ilft_addFilter(CIMCIndicationListener* il,
+                                  const char *name, int test,
+                                  const CIMCValue *values, int count,
+                                  CIMCType type)
+{
+    struct native_indicationlistener* i;
+    Filter *f, **last;
+    int k;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->running) {
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *)
+            native_new_CMPIString_borrowed("listener is running", NULL);
+        return ret;
+    }
+    if (name == NULL || values == NULL || filterKind(type) == 0 ||
+        (test == CIMC_IL_FILTER_Range && count != 2) ||
+        (test == CIMC_IL_FILTER_In && count < 1) ||
+        ((test == CIMC_IL_FILTER_Equal || test == CIMC_IL_FILTER_NotEqual) &&
+         count != 1) ||
+        test < CIMC_IL_FILTER_Equal || test > CIMC_IL_FILTER_In) {
+        ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        return ret;
+    }
+    for (k = 0; k < count; k++) {
+        if ((type == CIMC_chars && values[k].chars == NULL) ||
+            (type == CIMC_string && values[k].string == NULL)) {
+            ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+            return ret;
+        }
+    }
+
+    f = (Filter *) calloc(1, sizeof(Filter));
+    f->name = strdup(name);
+    f->test = test;
+    f->kind = filterKind(type);
+    f->count = count;
+    f->values = (FilterValue *) malloc(count * sizeof(FilterValue));
+    for (k = 0; k < count; k++) {
+        f->values[k] = filterValue(&values[k], type);
+    }
+    if (test == CIMC_IL_FILTER_In) {
+        compareKind = f->kind;
+        qsort(f->values, count, sizeof(FilterValue), compareFilterValues);
+    }
+
+    /* tests run in the order they were added */
+    for (last = &i->filters; *last; last = &(*last)->next);
+    *last = f;
+    return ret;
+}
+
+static CIMCStatus _ilft_clearFilters(CIMCIndicationListener* il)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->running) {
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *)
+            native_new_CMPIString_borrowed("listener is running", NULL);
+        return ret;
+    }
+    releaseFilters(i->filters);
+    i->filters = NULL;
+    return ret;
+}
+
+static CIMCStatus _ilft_setProjection(CIMCIndicationListener* il,
+                                      const char **propertyList)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->running) {
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *)
+            native_new_CMPIString_borrowed("listener is running", NULL);
+        return ret;
+    }
+    freeNameList(i->projection);
+    i->projection = copyNameList(propertyList);
+    return ret;
+}
+
+static CIMCStatus _ilft_setCoalesceKeys(CIMCIndicationListener* il,
+                                        const char **propertyList)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->running) {
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *)
+            native_new_CMPIString_borrowed("listener is running", NULL);
+        return ret;
+    }
+    freeNameList(i->coalesceKeys);
+    i->coalesceKeys = copyNameList(propertyList);
+    return ret;
+}
+
+static CIMCStatus _ilft_setJournal(CIMCIndicationListener* il,
+                                   const char *directory)
+{
+    struct native_indicationlistener* i;
+    
+    i = (struct native_indicationlistener*) il;
+
+    CIMCStatus ret;
+    ret.rc = CIMC_RC_OK;
+    ret.msg = NULL;
+
+    if (i->running) {
+        ret.rc = CIMC_RC_ERR_FAILED;
+        ret.msg = (CIMCString *)
+            native_new_CMPIString_borrowed("listener is running", NULL);
+        return ret;
+    }
+    free(i->journalDirectory);
+    i->journalDirectory = directory ? strdup(directory) : NULL;
+    return ret;
+}
+
+typedef struct _il_replay {
+    struct native_indicationlistener *i;
+    void (*fp) (CIMCInstance *indInstance, CIMCUint64 next);
+} Replay;
+
+static int replayRecord(void *parm, char *xml, int length, CIMCUint64 next)
+{
+    Replay *r = (Replay *) parm;
+    ResponseHdr rh;
+    ListenerSelect sel;
+    CIMCInstance *inst;
+
+    sel.select.match = r->i->filters ? selectIndication : NULL;
+    sel.select.propertyList = r->i->projection;
+    sel.i = r->i;
+    sel.coalesce = 0;
+    sel.key = NULL;
+    rh = scanCimXmlResponseInPlace(xml, NULL,
+                                   sel.select.match || r->i->projection ?
+                                   &sel.select : NULL);
+    if (rh.errCode != 0) {
+        free(rh.description);
+    } else if ((inst = (CIMCInstance *)
+                simpleArrayTake(rh.rvArray, 0).value.inst) != NULL) {
+        r->fp(inst, next);
+    }
+    rh.rvArray->ft->release(rh.rvArray);
+    return 0;
+}
+
+static CIMCStatus _ilft_replayJournal(CIMCIndicationListener* il,
+                                      CIMCUint64 offset,
+                                      void (*fp) (CIMCInstance *indInstance,
+                                                  CIMCUint64 next),
+                                      CIMCUint64 *end)
+{
+    struct native_indicationlistener* i;
+    Replay r;
+    CIMCUint64 reached;
+    
+    i = (struct native_indicationlistener*) il;
 
     CIMCStatus ret;
     ret.rc = CIMC_RC_OK;
     ret.msg = NULL;
+
+    if (i->journalDirectory == NULL || fp == NULL) {
+        ret.rc = CIMC_RC_ERR_INVALID_PARAMETER;
+        return ret;
+    }
+    r.i = i;
+    r.fp = fp;
+    ret = readJournal(i->journalDirectory, offset, replayRecord, &r, &reached);
+    if (end) {
+        *end = reached;
+    }
     return ret;
 }
 
 CIMCIndicationListener *newCIMCIndicationListener(int sslMode,
                                                   int *portNumber,
+                                                  const char *socketPath,
                                                   void (*fp) (CIMCInstance *indInstance),
                                                   CIMCStatus *rc)
 {
@@ -535,7 +2287,16 @@ CIMCIndicationListener *newCIMCIndicationListener(int sslMode,
         _ilft_release,
         _ilft_clone,
         _ilft_start,
-        _ilft_stop
+        _ilft_stop,
+        _ilft_setOption,
+        _ilft_setBatchCallback,
+        _ilft_getStatistics,
+        _ilft_addFilter,
+        _ilft_clearFilters,
+        _ilft_setProjection,
+        _ilft_setCoalesceKeys,
+        _ilft_setJournal,
+        _ilft_replayJournal
     };
     
     static CIMCIndicationListener il = {
@@ -548,9 +2309,29 @@ CIMCIndicationListener *newCIMCIndicationListener(int sslMode,
                    sizeof(struct native_indicationlistener));
                            
     indicationlistener->il = il;
-    indicationlistener->port = *portNumber;
+    indicationlistener->port = portNumber ? *portNumber : 0;
+    if (socketPath && *socketPath) {
+        indicationlistener->socketPath = strdup(socketPath);
+    }
     indicationlistener->sslMode = sslMode;
     indicationlistener->sendIndicationInstance = fp;
+    indicationlistener->backlog = DEFAULT_BACKLOG;
+    indicationlistener->numWorkers = DEFAULT_WORKERS;
+    indicationlistener->keepAliveTimeout = DEFAULT_KEEPALIVE_TIMEOUT;
+    indicationlistener->keepAliveMax = DEFAULT_KEEPALIVE_MAX;
+    indicationlistener->maxPayload = DEFAULT_MAX_PAYLOAD;
+    indicationlistener->queueSize = DEFAULT_QUEUE_SIZE;
+    indicationlistener->overflow = CIMC_IL_OVERFLOW_Block;
+    indicationlistener->batchSize = DEFAULT_BATCH_SIZE;
+    indicationlistener->journalSegmentSize = DEFAULT_JOURNAL_SEGMENT_SIZE;
+    indicationlistener->journalSync = DEFAULT_JOURNAL_SYNC;
+    pthread_mutex_init(&indicationlistener->connLock, NULL);
+    pthread_cond_init(&indicationlistener->connCond, NULL);
+    pthread_mutex_init(&indicationlistener->queueLock, NULL);
+    pthread_cond_init(&indicationlistener->queueCond, NULL);
+    pthread_cond_init(&indicationlistener->spaceCond, NULL);
+    pthread_mutex_init(&indicationlistener->coalesceLock, NULL);
+    pthread_cond_init(&indicationlistener->coalesceCond, NULL);
     
     return (CIMCIndicationListener*) indicationlistener;
 }
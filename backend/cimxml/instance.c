@@ -43,8 +43,8 @@ static void __release_list ( char ** list )
 
 		char ** tmp = list;
 
-		while ( *tmp ) free ( *tmp++ );
-		free ( list );
+		while ( *tmp ) native_free ( *tmp++ );
+		native_free ( list );
 	}
 }
 
@@ -59,10 +59,11 @@ static char ** __duplicate_list ( char ** list )
 
 		while ( *tmp++ ) ++size;
 
-		result = malloc ( size * sizeof ( char * ) );
+		result = native_malloc ( size * sizeof ( char * ) );
 
 		for ( tmp = result; *list; tmp++ )
-			*tmp = strdup ( *list++ );
+			*tmp = native_strdup ( *list++ );
+		*tmp = NULL;
 	}
 
 	return result;
@@ -80,6 +81,309 @@ static int __contained_list ( char ** list, const char * name )
 }
 
 
+/****************************************************************************/
+
+#define SLOT_PRESENT   1
+#define SLOT_NULL      2
+#define SLOT_QUALIFIED 4	/* the layout's qualifiers apply */
+
+#define SLOT_BYTES(count) ( ( (count) + 1 ) / 2 )
+
+static int __slot_bits ( struct native_instance * i, unsigned int n )
+{
+	return ( i->bits[n >> 1] >> ( ( n & 1 ) << 2 ) ) & 15;
+}
+
+
+static void __set_slot_bits ( struct native_instance * i,
+			      unsigned int n,
+			      int bits )
+{
+	int shift = ( n & 1 ) << 2;
+
+	i->bits[n >> 1] = ( i->bits[n >> 1] & ~( 15 << shift ) ) |
+			  ( bits << shift );
+}
+
+
+static void __alloc_slots ( struct native_instance * i )
+{
+	unsigned int count = i->layout->count;
+
+	i->values = native_calloc ( 1, count * sizeof ( CMPIValue ) +
+				    SLOT_BYTES ( count ) );
+	i->bits   = (unsigned char *) ( i->values + count );
+}
+
+
+/**
+ * returns the slot index of a property, starting the search at hint,
+ * or -1 if the layout has no such property
+ */
+static int __find_slot ( struct native_layout * l,
+			 const char * name,
+			 unsigned int hint )
+{
+	unsigned int n, j;
+
+	if ( l == NULL || name == NULL ) return -1;
+
+	for ( n = 0, j = hint; n < l->count; n++, j++ ) {
+		if ( j >= l->count ) j = 0;
+		if ( strcasecmp ( l->slots[j].name, name ) == 0 ) return j;
+	}
+	return -1;
+}
+
+
+static int __present_slot ( struct native_instance * i, const char * name )
+{
+	int n = __find_slot ( i->layout, name, 0 );
+
+	return ( n >= 0 && ( __slot_bits ( i, n ) & SLOT_PRESENT ) ) ? n : -1;
+}
+
+
+static CMPIData __slot_data ( struct native_instance * i, unsigned int n )
+{
+	CMPIData result = { 0, CMPI_nullValue, {0} };
+
+	result.type = i->layout->slots[n].type;
+	if ( ! ( __slot_bits ( i, n ) & SLOT_NULL ) ) {
+		result.state = i->layout->slots[n].state;
+		result.value = i->values[n];
+	}
+	return result;
+}
+
+
+static void __release_slot ( struct native_instance * i, unsigned int n )
+{
+	if ( ( __slot_bits ( i, n ) & ( SLOT_PRESENT | SLOT_NULL ) ) ==
+	     SLOT_PRESENT )
+		native_release_CMPIValue ( i->layout->slots[n].type,
+					   &i->values[n] );
+	__set_slot_bits ( i, n, 0 );
+}
+
+
+/**
+ * returns non-zero if the value does not match the slot type, a
+ * property that is already present keeps its qualifiers
+ */
+static int __set_slot ( struct native_instance * i,
+			unsigned int n,
+			CMPIType type,
+			CMPIValue * value )
+{
+	CMPIStatus rc;
+	int q = __slot_bits ( i, n ) & SLOT_QUALIFIED;
+
+	if ( ( type == CMPI_chars ? CMPI_string : type ) !=
+	     i->layout->slots[n].type ) return -1;
+
+	__release_slot ( i, n );
+
+	if ( value == NULL || type == CMPI_null ) {
+		__set_slot_bits ( i, n, SLOT_PRESENT | SLOT_NULL | q );
+		return 0;
+	}
+
+	if ( type == CMPI_chars )
+		i->values[n].string = native_new_CMPIString ( (char *) value,
+							      &rc );
+	else i->values[n] = native_clone_CMPIValue ( type, value, &rc );
+
+	__set_slot_bits ( i, n, SLOT_PRESENT | q );
+	return 0;
+}
+
+
+/**
+ * moves the values of slot n and all later slots in front of the
+ * instance's own property list, used when the instance no longer matches
+ * its layout for property n. The present slots always precede props in
+ * insertion order, so getPropertyAt() keeps that order.
+ */
+static void __detach_slots ( struct native_instance * i, unsigned int n )
+{
+	struct native_property * head = NULL, * p;
+
+	for ( ; n < i->layout->count; n++ ) {
+		struct native_slot * s = i->layout->slots + n;
+		int bits = __slot_bits ( i, n );
+
+		if ( ! ( bits & SLOT_PRESENT ) ) continue;
+
+		propertyFT.addProperty ( &head,
+					 s->name,
+					 s->type,
+					 ( bits & SLOT_NULL ) ?
+					    CMPI_nullValue : s->state,
+					 ( bits & SLOT_NULL ) ?
+					    NULL : &i->values[n] );
+
+		if ( bits & SLOT_QUALIFIED ) {
+			p = propertyFT.getProperty ( head, s->name );
+			p->qualifiers = qualifierFT.clone ( s->qualifiers,
+							    NULL );
+		}
+		__release_slot ( i, n );
+	}
+
+	if ( head ) {
+		for ( p = head; p->next; p = p->next );
+		p->next  = i->props;
+		i->props = head;
+	}
+}
+
+
+/**
+ * returns non-zero if a property that is not yet present may be kept in
+ * slot n, which is the case while the slots are filled in layout order
+ * and nothing has been added to props yet
+ */
+static int __claim_slot ( struct native_instance * i, unsigned int n )
+{
+	unsigned int m;
+
+	if ( i->props ) return 0;
+
+	for ( m = n + 1; m < i->layout->count; m++ ) {
+		if ( __slot_bits ( i, m ) & SLOT_PRESENT ) {
+			__detach_slots ( i, m );
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+static int __lookup_qualifiers ( struct native_instance * i,
+				 const char * pname,
+				 struct native_qualifier ** q )
+{
+	int n = __present_slot ( i, pname );
+	struct native_property * p;
+
+	if ( n >= 0 ) {
+		*q = ( __slot_bits ( i, n ) & SLOT_QUALIFIED ) ?
+			i->layout->slots[n].qualifiers : NULL;
+		return 1;
+	}
+
+	p = propertyFT.getProperty ( i->props, pname );
+	if ( p ) {
+		*q = p->qualifiers;
+		return 1;
+	}
+	return 0;
+}
+
+
+/****************************************************************************/
+
+
+/**
+ * copies a layout for instances made outside of the arena it is from
+ */
+static struct native_layout * __copy_layout ( struct native_layout * from )
+{
+	struct native_layout * l = (struct native_layout *)
+		native_malloc ( sizeof ( struct native_layout ) );
+	unsigned int n;
+
+	l->refCount = 1;
+	l->count    = from->count;
+	l->slots    = (struct native_slot *)
+		native_calloc ( l->count, sizeof ( struct native_slot ) );
+
+	for ( n = 0; n < l->count; n++ ) {
+		struct native_slot * s = l->slots + n;
+
+		*s = from->slots[n];
+		s->nameString = CMClone ( from->slots[n].nameString, NULL );
+		s->name       = CMGetCharPtr ( s->nameString );
+		s->qualifiers = qualifierFT.clone ( s->qualifiers, NULL );
+	}
+	return l;
+}
+
+
+static void __release_payload ( struct native_instance * i )
+{
+	if (i->layout) {
+		unsigned int n;
+
+		for ( n = 0; n < i->layout->count; n++ )
+			__release_slot ( i, n );
+		native_free ( i->values );
+		native_release_layout ( i->layout );
+	}
+	if (i->classname) native_free(i->classname);
+	if (i->nameSpace) native_free(i->nameSpace);
+	__release_list ( i->property_list );
+	__release_list ( i->key_list );
+	propertyFT.release(i->props);
+	qualifierFT.release(i->qualifiers);
+}
+
+
+static void __copy_payload ( struct native_instance * to,
+			     struct native_instance * from,
+			     CMPIStatus * rc )
+{
+	to->classname     = from->classname ? native_strdup ( from->classname ) : NULL;
+	to->nameSpace     = from->nameSpace ? native_strdup ( from->nameSpace ) : NULL;
+	to->property_list = __duplicate_list ( from->property_list );
+	to->key_list      = __duplicate_list ( from->key_list );
+	to->qualifiers    = qualifierFT.clone ( from->qualifiers, rc );
+	to->props         = propertyFT.clone ( from->props, rc );
+	to->layout        = NULL;
+	to->values        = NULL;
+	to->bits          = NULL;
+
+	if ( from->layout ) {
+		unsigned int n;
+
+		if ( native_arena_local ( from->layout ) ) {
+			to->layout = from->layout;
+			__sync_add_and_fetch ( &from->layout->refCount, 1 );
+		}
+		else	to->layout = __copy_layout ( from->layout );
+		__alloc_slots ( to );
+		memcpy ( to->bits, from->bits,
+			 SLOT_BYTES ( from->layout->count ) );
+
+		for ( n = 0; n < from->layout->count; n++ )
+			if ( ( __slot_bits ( from, n ) &
+			       ( SLOT_PRESENT | SLOT_NULL ) ) == SLOT_PRESENT )
+				to->values[n] = native_clone_CMPIValue (
+					from->layout->slots[n].type,
+					&from->values[n], NULL );
+	}
+}
+
+
+/**
+ * gives the instance its own copy of a payload shared with clones,
+ * called before anything is modified
+ */
+static void __unshare ( struct native_instance * i )
+{
+	struct native_instance old = *i;
+
+	if ( ! native_payload_shared ( &i->refCount ) ) return;
+
+	__copy_payload ( i, &old, NULL );
+	i->refCount = NULL;
+
+	if ( native_release_payload ( &old.refCount ) )
+		__release_payload ( &old );
+}
+
+
 /****************************************************************************/
 
 
@@ -88,13 +392,10 @@ static CMPIStatus __ift_release ( CMPIInstance * instance )
 	struct native_instance * i = (struct native_instance *) instance;
 
 	if (i) {
-	    if (i->classname) free(i->classname);
-	    if (i->nameSpace) free(i->nameSpace);
-	    __release_list ( i->property_list );
-	    __release_list ( i->key_list );
-            propertyFT.release(i->props);
-            qualifierFT.release(i->qualifiers);
-            free(i);
+	    if ( native_in_arena ( i ) ) CMReturn ( CMPI_RC_OK );
+	    if ( native_release_payload ( &i->refCount ) )
+		__release_payload ( i );
+            native_release_node ( i, sizeof ( struct native_instance ) );
             CMReturn ( CMPI_RC_OK );
 	}   
  
@@ -102,19 +403,25 @@ static CMPIStatus __ift_release ( CMPIInstance * instance )
 }
 
 
+/**
+ * clones share the payload until one of them is modified, except for
+ * clones made outside of the arena of the instance, which copy it
+ */
 static CMPIInstance * __ift_clone ( CMPIInstance * instance, CMPIStatus * rc )
 {
 	struct native_instance * i   = (struct native_instance *) instance;
 	struct native_instance * new = (struct native_instance *) 
-			       calloc ( 1, sizeof ( struct native_instance ) );
+			       native_new_node ( sizeof ( struct native_instance ) );
+
+	*new = *i;
+	CMSetStatus ( rc, CMPI_RC_OK );
 
-	new->instance.ft=i->instance.ft;
-        if (i->classname) new->classname     = strdup ( i->classname );
-	if (i->nameSpace) new->nameSpace     = strdup ( i->nameSpace );
-	new->property_list = __duplicate_list ( i->property_list );
-	new->key_list      = __duplicate_list ( i->key_list );
-	new->qualifiers    = qualifierFT.clone ( i->qualifiers, rc );
-	new->props         = propertyFT.clone ( i->props, rc );
+	if ( native_arena_local ( i ) )
+		new->refCount = native_share_payload ( &i->refCount );
+	else {
+		new->refCount = NULL;
+		__copy_payload ( new, i, rc );
+	}
 
 	return (CMPIInstance *) new;
 }
@@ -125,7 +432,12 @@ static CMPIData __ift_getProperty ( CMPIInstance * instance,
 				    CMPIStatus * rc )
 {
 	struct native_instance * i = (struct native_instance *) instance;
+	int n = __present_slot ( i, name );
 
+	if ( n >= 0 ) {
+		CMSetStatus ( rc, CMPI_RC_OK );
+		return __slot_data ( i, n );
+	}
 	return propertyFT.getDataProperty ( i->props, name, rc );
 }
 
@@ -137,6 +449,23 @@ static CMPIData __ift_getPropertyAt ( CMPIInstance * instance,
 {
 	struct native_instance * i = (struct native_instance *) instance;
 
+	if ( i->layout ) {
+		unsigned int n;
+
+		for ( n = 0; n < i->layout->count; n++ ) {
+			if ( ! ( __slot_bits ( i, n ) & SLOT_PRESENT ) )
+				continue;
+			if ( index-- == 0 ) {
+				if ( name ) {
+					*name = CMClone (
+						i->layout->slots[n].nameString,
+						NULL );
+				}
+				CMSetStatus ( rc, CMPI_RC_OK );
+				return __slot_data ( i, n );
+			}
+		}
+	}
 	return propertyFT.getDataPropertyAt ( i->props, index, name, rc );
 }
 
@@ -145,9 +474,15 @@ static unsigned int __ift_getPropertyCount ( CMPIInstance * instance,
 					     CMPIStatus * rc )
 {
 	struct native_instance * i = (struct native_instance *) instance;
-  
-	return propertyFT.getPropertyCount ( i->props, rc );
+	unsigned int c = 0;
+
+	if ( i->layout ) {
+		unsigned int n;
 
+		for ( n = 0; n < i->layout->count; n++ )
+			if ( __slot_bits ( i, n ) & SLOT_PRESENT ) c++;
+	}
+	return c + propertyFT.getPropertyCount ( i->props, rc );
 }
 
 static CMPIData __ift_getQualifier ( CMPIInstance * instance, 
@@ -182,9 +517,10 @@ static CMPIData __ift_getPropertyQualifier ( CMPIInstance * instance,
 				      CMPIStatus * rc )
 {
 	struct native_instance * i = (struct native_instance *) instance;
-	struct native_property *p=propertyFT.getProperty ( i->props, pname );
+	struct native_qualifier *q;
 
-	if (p) return qualifierFT.getDataQualifier ( p->qualifiers, qname, rc );        
+	if ( __lookup_qualifiers ( i, pname, &q ) )
+		return qualifierFT.getDataQualifier ( q, qname, rc );
 	CMSetStatus ( rc, CMPI_RC_ERR_NO_SUCH_PROPERTY );
 	CMPIData ret = { 0, CMPI_nullValue, {0} };
 	return ret;
@@ -197,9 +533,10 @@ static CMPIData __ift_getPropertyQualifierAt ( CMPIInstance * instance,
 				      CMPIStatus * rc )
 {
 	struct native_instance * i = (struct native_instance *) instance;
-	struct native_property *p=propertyFT.getProperty ( i->props, pname );
+	struct native_qualifier *q;
 
-	if (p) return qualifierFT.getDataQualifierAt ( p->qualifiers, index, name, rc );
+	if ( __lookup_qualifiers ( i, pname, &q ) )
+		return qualifierFT.getDataQualifierAt ( q, index, name, rc );
 	CMSetStatus ( rc, CMPI_RC_ERR_NO_SUCH_PROPERTY );
 	CMPIData ret = { 0, CMPI_nullValue, {0} };
 	return ret;
@@ -210,26 +547,41 @@ static unsigned int __ift_getPropertyQualifierCount ( CMPIInstance * instance,
 					     CMPIStatus * rc )
 {
 	struct native_instance * i = (struct native_instance *) instance;
-	struct native_property *p=propertyFT.getProperty ( i->props, pname );
-  
-	if (p) return qualifierFT.getQualifierCount ( p->qualifiers, rc );
+	struct native_qualifier *q;
+
+	if ( __lookup_qualifiers ( i, pname, &q ) )
+		return qualifierFT.getQualifierCount ( q, rc );
 	CMSetStatus ( rc, CMPI_RC_ERR_NO_SUCH_PROPERTY );
 	return 0;
 }
 
 
-static CMPIStatus __ift_setProperty ( CMPIInstance * instance,
-				      const char * name,
-				      CMPIValue * value,
-				      CMPIType type )
+static void __set_property ( struct native_instance * i,
+			     const char * name,
+			     CMPIValue * value,
+			     CMPIType type )
 {
-	struct native_instance * i = (struct native_instance *) instance;
-
 	if ( i->filtered == 0 ||
 	     i->property_list == NULL ||
 	     __contained_list ( i->property_list, name ) ||
 	     __contained_list ( i->key_list, name ) ) {
 
+		int n;
+
+		__unshare ( i );
+		n = __find_slot ( i->layout, name, i->hint );
+
+		if ( n >= 0 &&
+		     ( ( __slot_bits ( i, n ) & SLOT_PRESENT ) ||
+		       __claim_slot ( i, n ) ) ) {
+
+			if ( __set_slot ( i, n, type, value ) == 0 ) {
+				i->hint = n + 1;
+				return;
+			}
+			__detach_slots ( i, n );
+		}
+
 		if ( propertyFT.setProperty ( i->props,
 					      name, 
 					      type,
@@ -243,6 +595,19 @@ static CMPIStatus __ift_setProperty ( CMPIInstance * instance,
                }
 
 	}
+}
+
+
+static CMPIStatus __ift_setProperty ( CMPIInstance * instance,
+				      const char * name,
+				      CMPIValue * value,
+				      CMPIType type )
+{
+	struct native_arena * prev = native_enter_arena ( instance );
+
+	__set_property ( (struct native_instance *) instance,
+			 name, value, type );
+	native_leave_arena ( prev );
 	CMReturn ( CMPI_RC_OK );
 }
 
@@ -260,15 +625,15 @@ static CMPIObjectPath * __ift_getObjectPath ( CMPIInstance * instance,
 	if ( rc && rc->rc != CMPI_RC_OK )
 		return NULL;
 
-	j = propertyFT.getPropertyCount ( i->props, NULL );
+	j = __ift_getPropertyCount ( instance, NULL );
 
 	while ( j-- ) {
 		CMPIStatus tmp;
 		CMPIString * keyName;
-		CMPIData d = propertyFT.getDataPropertyAt ( i->props,
-							    j,   
-							    &keyName,
-							    &tmp );
+		CMPIData d = __ift_getPropertyAt ( instance,
+						   j,
+						   &keyName,
+						   &tmp );
 		if ( d.state & CMPI_keyValue ) {
 			CMAddKey ( cop,
 				   CMGetCharPtr ( keyName ),
@@ -287,6 +652,9 @@ static CMPIStatus __ift_setPropertyFilter ( CMPIInstance * instance,
 {  
 
 	struct native_instance * i = (struct native_instance *) instance;
+	struct native_arena * prev = native_enter_arena ( i );
+
+	__unshare ( i );
 
 	if ( i->filtered ) {
 
@@ -297,14 +665,16 @@ static CMPIStatus __ift_setPropertyFilter ( CMPIInstance * instance,
 	i->filtered = 1;
 	i->property_list = __duplicate_list ( propertyList );
 	i->key_list      = __duplicate_list ( keys );
+	native_leave_arena ( prev );
 
 	CMReturn ( CMPI_RC_OK );
 }   
 
 
 
-CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath * cop,
-					 CMPIStatus * rc )
+static CMPIInstance * __new_instance ( CMPIObjectPath * cop,
+				      struct native_layout * layout,
+				      CMPIStatus * rc )
 {
 	static CMPIInstanceFT ift = {
 		NATIVE_FT_VERSION,
@@ -330,22 +700,28 @@ CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath * cop,
 
 	struct native_instance * instance =
 		(struct native_instance *) 
-		calloc ( 1, sizeof ( struct native_instance ) );
+		native_new_node ( sizeof ( struct native_instance ) );
 
 	CMPIStatus tmp1, tmp2, tmp3;
 	CMPIString * str;
 
 	instance->instance     = i;
 
+	if (layout) {
+		instance->layout = layout;
+		__sync_add_and_fetch ( &layout->refCount, 1 );
+		__alloc_slots ( instance );
+	}
+
 	if (cop) {
 	   int j = CMGetKeyCount ( cop, &tmp1 );
     
       str = CMGetClassName ( cop, &tmp2 );
-	  instance->classname = strdup(CMGetCharPtr ( str ));
+	  instance->classname = native_strdup(CMGetCharPtr ( str ));
       CMRelease(str);
       
       str = CMGetNameSpace ( cop, &tmp3 );
-      instance->nameSpace = (str && str->hdl) ? strdup(CMGetCharPtr ( str )) : NULL;
+      instance->nameSpace = (str && str->hdl) ? native_strdup(CMGetCharPtr ( str )) : NULL;
       if (str) CMRelease(str);
 
 	   if ( tmp1.rc != CMPI_RC_OK ||
@@ -357,11 +733,21 @@ CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath * cop,
 	     while ( j-- && ( tmp1.rc == CMPI_RC_OK ) ) {
 			CMPIString * keyName;
 			CMPIData tmp = CMGetKeyAt ( cop, j, &keyName, &tmp1 );
-			propertyFT.addProperty ( &instance->props,
-						 CMGetCharPtr ( keyName ),
-						 tmp.type,
-						 tmp.state,
-						 &tmp.value );
+			int n = __find_slot ( layout,
+					      CMGetCharPtr ( keyName ),
+					      instance->hint );
+
+			if ( n < 0 ||
+			     ! ( layout->slots[n].state & CMPI_keyValue ) ||
+			     ! __claim_slot ( instance, n ) ||
+			     __set_slot ( instance, n, tmp.type, &tmp.value ) ) {
+				propertyFT.addProperty ( &instance->props,
+							 CMGetCharPtr ( keyName ),
+							 tmp.type,
+							 tmp.state,
+							 &tmp.value );
+			}
+			else instance->hint = n + 1;
 			if (keyName) CMRelease(keyName);
 		}
 
@@ -373,12 +759,85 @@ CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath * cop,
 	return (CMPIInstance *) instance;
 }
 
+
+CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath * cop,
+					 CMPIStatus * rc )
+{
+	return __new_instance ( cop, NULL, rc );
+}
+
+
+/**
+ * Creates an instance that keeps the properties described by layout in
+ * a flat value array, the layout is shared and not copied.
+ */
+CMPIInstance * native_new_CMPIInstance_fromLayout ( CMPIObjectPath * cop,
+						    struct native_layout * layout,
+						    CMPIStatus * rc )
+{
+	return __new_instance ( cop, layout, rc );
+}
+
+
+/**
+ * Derives a layout from the properties and property qualifiers of an
+ * existing instance.
+ */
+struct native_layout * native_new_layout ( CMPIInstance * ci,
+					   CMPIStatus * rc )
+{
+	struct native_instance * i = (struct native_instance *) ci;
+	struct native_layout * l = (struct native_layout *)
+		native_calloc ( 1, sizeof ( struct native_layout ) );
+	unsigned int n;
+
+	l->refCount = 1;
+	l->count    = __ift_getPropertyCount ( ci, NULL );
+	l->slots    = (struct native_slot *)
+		native_calloc ( l->count, sizeof ( struct native_slot ) );
+
+	for ( n = 0; n < l->count; n++ ) {
+		struct native_slot * s = l->slots + n;
+		struct native_qualifier * q = NULL;
+		CMPIString * name = NULL;
+		CMPIData d = __ift_getPropertyAt ( ci, n, &name, NULL );
+
+		s->nameString = name;
+		s->name  = CMGetCharPtr ( name );
+		s->type  = d.type;
+		s->state = d.state & CMPI_keyValue;
+		__lookup_qualifiers ( i, s->name, &q );
+		s->qualifiers = qualifierFT.clone ( q, NULL );
+	}
+
+	CMSetStatus ( rc, CMPI_RC_OK );
+	return l;
+}
+
+
+void native_release_layout ( struct native_layout * l )
+{
+	unsigned int n;
+
+	if ( l == NULL || native_in_arena ( l ) ||
+	     __sync_sub_and_fetch ( &l->refCount, 1 ) > 0 )
+		return;
+
+	for ( n = 0; n < l->count; n++ ) {
+		CMRelease ( l->slots[n].nameString );
+		qualifierFT.release ( l->slots[n].qualifiers );
+	}
+	native_free ( l->slots );
+	native_free ( l );
+}
+
 void setInstNsAndCn(CMPIInstance *ci, const char *ns, char *cn)
 {
    struct native_instance * i = (struct native_instance *) ci;
-   
-   if (cn) i->classname=strdup(cn);
-   if (ns) i->nameSpace=strdup(ns);
+
+   __unshare ( i );
+   if (cn) i->classname=native_strdup(cn);
+   if (ns) i->nameSpace=native_strdup(ns);
 }
 
 int addInstQualifier( CMPIInstance* ci, char * name,
@@ -387,6 +846,7 @@ int addInstQualifier( CMPIInstance* ci, char * name,
 {
    struct native_instance * i = (struct native_instance *) ci;
 
+   __unshare ( i );
 	if ( qualifierFT.setQualifier ( i->qualifiers,
 				      name, 
 				      type,
@@ -401,12 +861,48 @@ int addInstQualifier( CMPIInstance* ci, char * name,
 	return ( CMPI_RC_OK );
 }
 
+/**
+ * returns non-zero if q holds qualifier qname with the given type and value
+ */
+static int __has_qualifier ( struct native_qualifier * q,
+			     const char * qname,
+			     CMPIValue * value,
+			     CMPIType type )
+{
+	CMPIStatus st;
+	CMPIData d = qualifierFT.getDataQualifier ( q, qname, &st );
+
+	if ( st.rc != CMPI_RC_OK ) return 0;
+	if ( d.state & CMPI_nullValue ) return type == CMPI_null;
+	if ( type == CMPI_chars )
+		return d.type == CMPI_string &&
+		       strcmp ( CMGetCharPtr ( d.value.string ),
+				(char *) value ) == 0;
+	return d.type == type &&
+	       native_same_CMPIValue ( type, &d.value, value );
+}
+
 int addInstPropertyQualifier( CMPIInstance* ci, char * pname, char *qname,
 				      CMPIValue * value,
 				      CMPIType type)
 {
    struct native_instance * i = (struct native_instance *) ci;
-   struct native_property *p=propertyFT.getProperty ( i->props ,pname );
+   struct native_property *p;
+   int n;
+
+   __unshare ( i );
+   n = __present_slot ( i, pname );
+
+   if (n >= 0) {
+	/* the layout's qualifiers are used while the instance has them too */
+	if ( ( __slot_bits ( i, n ) & SLOT_QUALIFIED ) &&
+	     __has_qualifier ( i->layout->slots[n].qualifiers,
+			       qname, value, type ) )
+		return ( CMPI_RC_OK );
+	__detach_slots ( i, n );
+   }
+
+   p=propertyFT.getProperty ( i->props ,pname );
    
    if (p) {
 	if ( qualifierFT.setQualifier ( p->qualifiers,
@@ -424,6 +920,42 @@ int addInstPropertyQualifier( CMPIInstance* ci, char * pname, char *qname,
    }
    return CMPI_RC_ERR_NO_SUCH_PROPERTY;
 }                                      
+
+/**
+ * Replaces the qualifiers of a property by the list q, which is taken
+ * over. A property kept in a layout slot stays there if q equals the
+ * qualifiers of the layout, and is moved to the instance's props otherwise.
+ */
+int setInstPropertyQualifiers( CMPIInstance* ci, char * pname,
+				       struct native_qualifier * q )
+{
+   struct native_instance * i = (struct native_instance *) ci;
+   struct native_property *p;
+   int n;
+
+   __unshare ( i );
+   n = __present_slot ( i, pname );
+
+   if (n >= 0) {
+	if ( qualifierFT.sameQualifiers ( q,
+					  i->layout->slots[n].qualifiers ) ) {
+		__set_slot_bits ( i, n, __slot_bits ( i, n ) | SLOT_QUALIFIED );
+		qualifierFT.release ( q );
+		return ( CMPI_RC_OK );
+	}
+	__detach_slots ( i, n );
+   }
+
+   p=propertyFT.getProperty ( i->props ,pname );
+
+   if (p) {
+	qualifierFT.release ( p->qualifiers );
+	p->qualifiers = q;
+	return ( CMPI_RC_OK );
+   }
+   qualifierFT.release ( q );
+   return CMPI_RC_ERR_NO_SUCH_PROPERTY;
+}
                                       
                                       
 /****************************************************************************/
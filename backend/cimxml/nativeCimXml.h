@@ -25,9 +25,18 @@
 #define NATIVECIMXML_FT_VERSION 1
 
 #include "cimc.h"
+#include <pthread.h>
+#include <sys/types.h>
+
+struct _il_coalesced;
+struct _il_connection;
+struct _il_filter;
+struct _il_journal;
+struct _il_slot;
 
 CIMCIndicationListener *newCIMCIndicationListener (int sslMode,
                                                    int *portNumber,
+                                                   const char *socketPath,
                                                    void (*fp) (CIMCInstance *indInstance),
                                                    CIMCStatus *rc);
 
@@ -37,8 +46,70 @@ struct native_indicationlistener {
 
 	int sslMode;
 	int port;
+	char *socketPath;	/* UNIX socket listened on instead of port */
+	ino_t socketInode;	/* of the socket file created by start() */
     
     void (*sendIndicationInstance) (CIMCInstance *indInstance);
+	void (*sendIndicationBatch) (CIMCInstance **indInstances, int count);
+
+	int backlog;		/* listen() backlog */
+	int numWorkers;		/* threads reading and dispatching requests */
+	int keepAliveTimeout;	/* seconds a persistent connection may idle */
+	int keepAliveMax;	/* requests served per connection */
+	int maxPayload;		/* bytes of the largest request body accepted */
+	int queueSize;		/* indications waiting for delivery */
+	int overflow;		/* CIMC_IL_OVERFLOW_ policy of a full queue */
+	int batchSize;		/* indications per batch callback */
+
+	int running;
+	volatile int listening;	/* cleared by stop() */
+	int listenFd;
+	int epollFd;
+	int wakeFd;		/* interrupts epoll_wait() on stop */
+	time_t acceptPaused;	/* accept() ran out of resources at */
+	pthread_t listenThread;
+	pthread_t *workers;
+
+	/* connections with data to read, from the listen thread to the workers */
+	pthread_mutex_t connLock;
+	pthread_cond_t connCond;
+	struct _il_connection **conns;
+	int connHead, connCount, connSize;
+	struct _il_connection *connList;	/* all open connections */
+
+	/* bounded queue from the workers to the delivery thread */
+	struct _il_slot *queue;
+	unsigned long queueMask;
+	volatile unsigned long queueHead, queueTail;
+	pthread_t deliveryThread;
+	int delivering;
+	int deliveryWaiting, producersWaiting;
+	pthread_mutex_t queueLock;
+	pthread_cond_t queueCond;	/* queue not empty */
+	pthread_cond_t spaceCond;	/* queue not full */
+
+	/* indications delivered and their properties, see addFilter() */
+	struct _il_filter *filters;
+	char **projection;
+
+	/* indications held to collapse duplicates, see coalesce_thread() */
+	int coalesceWindow;	/* milliseconds, 0 for none */
+	char **coalesceKeys;	/* NULL for the default source properties */
+	pthread_t coalesceThread;
+	int coalescing;
+	pthread_mutex_t coalesceLock;
+	pthread_cond_t coalesceCond;
+	struct _il_coalesced **coalesceTable;
+	unsigned long coalesceMask, coalesceCount;
+	struct _il_coalesced *coalesceHead, *coalesceTail;	/* by deadline */
+
+	/* indications received, kept for replay, see indicationjournal.c */
+	char *journalDirectory;	/* NULL for no journal */
+	long journalSegmentSize;	/* bytes per segment file */
+	int journalSync;	/* milliseconds between syncs to disk */
+	struct _il_journal *journal;
+
+	CIMCIndicationListenerStats stats;
 };
 
 
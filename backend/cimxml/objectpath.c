@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "cmcidt.h"
 #include "cmcift.h"
 #include "cmcimacs.h"
@@ -37,13 +38,16 @@
 #endif
 
 extern void *newList();
-extern char *pathToChars(CMPIObjectPath * cop, CMPIStatus * rc, char *str,
-								 int uri);
+const char *getPathChars(CMPIObjectPath * cop, int uri);
+void pathToStringBuffer(UtilStringBuffer *sb, CMPIObjectPath * cop, int uri);
 void pathToXml(UtilStringBuffer *sb, CMPIObjectPath *cop);
 UtilList *getNameSpaceComponents(CMPIObjectPath * cop);
 
 extern char *keytype2Chars(CMPIType type);
 extern char *value2Chars(CMPIType type, CMPIValue * value);
+extern void AsciiToXmlStringBuffer(UtilStringBuffer *sb, const char *AsciiStr);
+extern void value2StringBuffer(UtilStringBuffer *sb, CMPIType type,
+							CMPIValue * value);
 
 
 struct native_cop {
@@ -51,6 +55,9 @@ struct native_cop {
 	char * nameSpace;
 	char * classname;
 	struct native_property * keys;
+	int * refCount;		/* clones sharing this payload, or NULL */
+	char * chars[2];	/* cached plain and uri encoded path string */
+	CMPIUint64 hash;	/* cached hashCMPIObjectPath(), or 0 */
 };
 
 
@@ -61,17 +68,66 @@ static struct native_cop * __new_empty_cop ( const char *,
 /****************************************************************************/
 
 
+static void __invalidate ( struct native_cop * o )
+{
+	/* the strings of an arena path are adopted and freed by the arena */
+	if ( ! native_in_arena ( o ) ) {
+		native_free ( o->chars[0] );
+		native_free ( o->chars[1] );
+	}
+	o->chars[0] = o->chars[1] = NULL;
+	o->hash = 0;
+}
+
+
+static void __release_payload ( struct native_cop * o )
+{
+	if (o->classname) native_free ( o->classname );
+	if (o->nameSpace) native_free ( o->nameSpace );
+	propertyFT.release ( o->keys );
+}
+
+
+static void __copy_payload ( struct native_cop * to,
+			     struct native_cop * from )
+{
+	to->classname = ( from->classname )? native_strdup ( from->classname ): NULL;
+	to->nameSpace = ( from->nameSpace )? native_strdup ( from->nameSpace ): NULL;
+	to->keys      = propertyFT.clone ( from->keys, NULL );
+	to->refCount  = NULL;
+}
+
+
+/**
+ * gives the object path its own copy of a payload shared with clones,
+ * called before anything is modified
+ */
+static void __unshare ( struct native_cop * o )
+{
+	struct native_cop old = *o;
+
+	if ( ! native_payload_shared ( &o->refCount ) ) return;
+
+	__copy_payload ( o, &old );
+
+	if ( native_release_payload ( &old.refCount ) )
+		__release_payload ( &old );
+}
+
+
 static CMPIStatus __oft_release ( CMPIObjectPath * cop )
 {
 	struct native_cop * o = (struct native_cop *) cop;
 
 	if ( o ) {
- 
-		if (o->classname) free ( o->classname );
-		if (o->nameSpace) free ( o->nameSpace );
- 		propertyFT.release ( o->keys );
 
-		free ( o );
+		if ( native_in_arena ( o ) ) CMReturn ( CMPI_RC_OK );
+
+		if ( native_release_payload ( &o->refCount ) )
+			__release_payload ( o );
+		__invalidate ( o );
+
+		native_release_node ( o, sizeof ( struct native_cop ) );
  
  		CMReturn ( CMPI_RC_OK );
 	}
@@ -80,20 +136,23 @@ static CMPIStatus __oft_release ( CMPIObjectPath * cop )
 }
 
 
+/**
+ * clones share the payload until one of them is modified, except for
+ * clones made outside of the arena of the object path, which copy it
+ */
 static CMPIObjectPath * __oft_clone ( CMPIObjectPath * cop, CMPIStatus * rc )
 {
-	CMPIStatus tmp;
 	struct native_cop * o   = (struct native_cop *) cop;
-	struct native_cop * new = __new_empty_cop ( o->nameSpace,
-						    o->classname,
-						    &tmp );
-
-	if ( tmp.rc == CMPI_RC_OK ) {
-		new->keys = propertyFT.clone ( o->keys, rc );
+	struct native_cop * new = (struct native_cop *)
+		native_new_node ( sizeof ( struct native_cop ) );
 
-	} else
-                CMSetStatus ( rc, tmp.rc );
+	*new = *o;
+	if ( native_arena_local ( o ) )
+		new->refCount = native_share_payload ( &o->refCount );
+	else	__copy_payload ( new, o );
+	new->chars[0] = new->chars[1] = NULL;
 
+	CMSetStatus ( rc, CMPI_RC_OK );
 	return (CMPIObjectPath *) new;
 }
 
@@ -104,12 +163,15 @@ static CMPIStatus __oft_setNameSpace ( CMPIObjectPath * cop,
 {
 	struct native_cop * o = (struct native_cop *) cop;
 
-	char * ns = ( nameSpace )? strdup ( nameSpace ): NULL;
-  
 	if ( o ) {
+		struct native_arena * prev = native_enter_arena ( o );
+
+		__unshare ( o );
+		__invalidate ( o );
 		if ( o->nameSpace )
-		     free ( o->nameSpace );
-	    o->nameSpace = ns;
+		     native_free ( o->nameSpace );
+		o->nameSpace = ( nameSpace )? native_strdup ( nameSpace ): NULL;
+		native_leave_arena ( prev );
 	}
 	CMReturn ( CMPI_RC_OK );
 }
@@ -143,12 +205,15 @@ static CMPIStatus __oft_setClassName ( CMPIObjectPath * cop,
 {
 	struct native_cop * o = (struct native_cop *) cop;
 
-	char * cn = ( classname )? strdup ( classname ): NULL;
-  
 	if ( o ) {
+		struct native_arena * prev = native_enter_arena ( o );
+
+		__unshare ( o );
+		__invalidate ( o );
 		if ( o->classname )
-		    free ( o->classname );
-	    o->classname = cn;
+		    native_free ( o->classname );
+		o->classname = ( classname )? native_strdup ( classname ): NULL;
+		native_leave_arena ( prev );
 	}
 
 	CMReturn ( CMPI_RC_OK );
@@ -170,12 +235,18 @@ static CMPIStatus __oft_addKey ( CMPIObjectPath * cop,
 				 CMPIType type )
 {
 	struct native_cop * o = (struct native_cop *) cop;
-
-	CMReturn ( ( propertyFT.addProperty ( &o->keys,
-					      name,
-					      type,
-					      CMPI_keyValue,
-					      value ) )?
+	struct native_arena * prev = native_enter_arena ( o );
+	int exists;
+
+	__unshare ( o );
+	__invalidate ( o );
+	exists = propertyFT.addProperty ( &o->keys,
+					  name,
+					  type,
+					  CMPI_keyValue,
+					  value );
+	native_leave_arena ( prev );
+	CMReturn ( ( exists )?
 		   CMPI_RC_ERR_ALREADY_EXISTS: 
 		   CMPI_RC_OK );
 }
@@ -252,11 +323,11 @@ static struct native_cop * __new_empty_cop ( const char * nameSpace,
 	};
 
 	struct native_cop * cop =
-	      (struct native_cop *) calloc ( 1, sizeof ( struct native_cop ) );
+	      (struct native_cop *) native_new_node ( sizeof ( struct native_cop ) );
 
 	cop->cop       = o;
-	cop->classname = ( classname )? strdup ( classname ): NULL;
-	cop->nameSpace = ( nameSpace )? strdup ( nameSpace ): NULL;
+	cop->classname = ( classname )? native_strdup ( classname ): NULL;
+	cop->nameSpace = ( nameSpace )? native_strdup ( nameSpace ): NULL;
 
 	CMSetStatus ( rc, CMPI_RC_OK );
 	return cop;
@@ -300,140 +371,260 @@ int sameCompareCMPIString( CMPIString *str1, CMPIString *str2 )
     return result;
 }
 
+/* FNV-1a, see http://www.isthe.com/chongo/tech/comp/fnv/ */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+static CMPIUint64 hashBytes(CMPIUint64 h, const void *p, size_t n)
+{
+   const unsigned char *c = (const unsigned char *) p;
+
+   while (n--)
+      h = (h ^ *c++) * FNV_PRIME;
+   return h;
+}
+
+/* hashes the string and its terminating 0, a NULL string as "" */
+static CMPIUint64 hashChars(CMPIUint64 h, const char *str, int ignoreCase)
+{
+   const unsigned char *c = (const unsigned char *) str;
+
+   if (c)
+      for (; *c; c++)
+         h = (h ^ (ignoreCase ? tolower(*c) : *c)) * FNV_PRIME;
+   return h * FNV_PRIME;
+}
+
+static CMPIUint64 hashValue(CMPIUint64 h, CMPIType type, CMPIValue * value)
+{
+   CMPIUint64 u;
+   CMPIData d;
+   double r;
+   unsigned int i, m;
+
+   h = hashBytes(h, &type, sizeof(type));
+
+   if (type & CMPI_ARRAY) {
+      m = value->array ? CMGetArrayCount(value->array, NULL) : 0;
+      for (i = 0; i < m; i++) {
+         d = CMGetArrayElementAt(value->array, i, NULL);
+         h = hashBytes(h, &d.state, sizeof(d.state));
+         if (!(d.state & CMPI_nullValue))
+            h = hashValue(h, d.type, &d.value);
+      }
+      return hashBytes(h, &m, sizeof(m));
+   }
+
+   switch (type) {
+   case CMPI_ref:
+      u = value->ref ? hashCMPIObjectPath(value->ref) : 0;
+      return hashBytes(h, &u, sizeof(u));
+   case CMPI_chars:
+      return hashChars(h, value->chars, 0);
+   case CMPI_string:
+   case CMPI_numericString:
+   case CMPI_booleanString:
+   case CMPI_dateTimeString:
+      return hashChars(h, value->string ? (char *) value->string->hdl : NULL, 0);
+   case CMPI_dateTime:
+      if (value->dateTime == NULL)
+         return h;
+      u = CMGetBinaryFormat(value->dateTime, NULL);
+      h = hashBytes(h, &u, sizeof(u));
+      u = CMIsInterval(value->dateTime, NULL);
+      return hashBytes(h, &u, sizeof(u));
+   case CMPI_boolean:
+      u = value->boolean != 0;
+      break;
+   case CMPI_char16:
+   case CMPI_uint16:
+      u = value->uint16;
+      break;
+   case CMPI_uint8:
+      u = value->uint8;
+      break;
+   case CMPI_sint8:
+      u = (CMPIUint64) (CMPISint64) value->sint8;
+      break;
+   case CMPI_sint16:
+      u = (CMPIUint64) (CMPISint64) value->sint16;
+      break;
+   case CMPI_uint32:
+      u = value->uint32;
+      break;
+   case CMPI_sint32:
+      u = (CMPIUint64) (CMPISint64) value->sint32;
+      break;
+   case CMPI_uint64:
+   case CMPI_sint64:
+      u = value->uint64;
+      break;
+   case CMPI_real32:
+   case CMPI_real64:
+      r = (type == CMPI_real32) ? value->real32 : value->real64;
+      if (r == 0)
+         r = 0;                 /* -0 == 0 */
+      return hashBytes(h, &r, sizeof(r));
+   default:
+      return hashBytes(h, &value, sizeof(value));
+   }
+   return hashBytes(h, &u, sizeof(u));
+}
+
+/*
+ * Returns a hash consistent with sameCMPIObjectPath(): namespace, class
+ * and key names are hashed ignoring case, key order does not matter.
+ * The hash is kept in the object path until it is modified.
+ */
+CMPIUint64 hashCMPIObjectPath(const CMPIObjectPath * cop)
+{
+   struct native_cop *o = (struct native_cop *) cop;
+   struct native_property *k;
+   CMPIUint64 h, keys = 0, kh;
+
+   if (o->hash)
+      return o->hash;
+
+   h = hashChars(FNV_OFFSET, o->nameSpace, 1);
+   h = hashChars(h, o->classname, 1);
+
+   for (k = o->keys; k; k = k->next) {
+      kh = hashChars(FNV_OFFSET, k->name, 1);
+      kh = hashBytes(kh, &k->state, sizeof(k->state));
+      if (!(k->state & CMPI_nullValue))
+         kh = hashValue(kh, k->type, &k->value);
+      keys += kh;
+   }
+
+   h = (h ^ keys) * FNV_PRIME;
+   h ^= h >> 29;
+   if (h == 0)
+      h = 1;                    /* 0 means not yet computed */
+   o->hash = h;
+   return h;
+}
+
+static int sameCharsIc(const char *c1, const char *c2)
+{
+   return strcasecmp(c1 ? c1 : "", c2 ? c2 : "") == 0;
+}
+
+/*
+ * Compares namespace, class and key names ignoring case, and the key
+ * values by type. The order of the keys does not matter.
+ */
 int sameCMPIObjectPath (const CMPIObjectPath *cop1, const CMPIObjectPath *cop2)
 {
-   CMPIString *keyname;
-   CMPIData   data1, data2;
-   CMPIStatus status;
    struct native_cop *ncop1 = (struct native_cop *)cop1;
    struct native_cop *ncop2 = (struct native_cop *)cop2;
-   unsigned int i, m;
-   char *cv1, *cv2;
+   struct native_property *k1, *k2;
+   unsigned int m1 = 0, m2 = 0;
 
-   /* Check if name spaces are the same */
-   if (strcasecmp(ncop1->nameSpace, ncop2->nameSpace) != 0)
+   if (ncop1 == ncop2)
+      return 1;
+
+   /* Different hashes, if already computed, mean different paths */
+   if (ncop1->hash && ncop2->hash && ncop1->hash != ncop2->hash)
       return 0;
 
-   /* Check if classnames are the same */
-   if (strcasecmp(ncop1->classname, ncop2->classname) != 0)
+   /* Clones sharing the same payload */
+   if (ncop1->keys == ncop2->keys && ncop1->nameSpace == ncop2->nameSpace &&
+       ncop1->classname == ncop2->classname)
+      return 1;
+
+   /* Check if name spaces and classnames are the same */
+   if (!sameCharsIc(ncop1->nameSpace, ncop2->nameSpace) ||
+       !sameCharsIc(ncop1->classname, ncop2->classname))
       return 0;
 
    /* Check if the key count is the same */
-   m = propertyFT.getPropertyCount(ncop1->keys, NULL);
-   if (m != propertyFT.getPropertyCount(ncop2->keys, NULL)) 
+   for (k1 = ncop1->keys; k1; k1 = k1->next) m1++;
+   for (k2 = ncop2->keys; k2; k2 = k2->next) m2++;
+   if (m1 != m2)
       return 0;
 
    /* Check on each key */
-   for (i = 0; i < m; i++) {
-      data1 = propertyFT.getDataPropertyAt(ncop1->keys, i, &keyname, &status );
+   for (k1 = ncop1->keys; k1; k1 = k1->next) {
+      for (k2 = ncop2->keys; k2; k2 = k2->next)
+         if (strcasecmp(k1->name, k2->name) == 0)
+            break;
 
       /* check if key exists in both */
-      if (status.rc != CMPI_RC_OK)
-      {
-        // Free up dynamically allocated memory
-        sameReleaseCMPIString( keyname );
-        return 0;
-      }
-
-      // This in effect verifies the keynames are the same. We are searching
-      // for the keyname of cop1 in cop2.  
-      data2 = propertyFT.getDataProperty(ncop2->keys,
-					 CMGetCharsPtr( keyname, NULL ),
-					 &status );
-
-      // Free up dynamically allocated memory
-      sameReleaseCMPIString( keyname );
-
-      /* check if key exists in both */
-      if (status.rc != CMPI_RC_OK)
-	  return 0;
+      if (k2 == NULL)
+         return 0;
 
       /* Check if the values are the same */
-      if( data1.type  != data2.type       ||
-          data1.state != data2.state  ){
-	      return 0;
-      } else {
-	      cv1 = value2Chars(data1.type, &data1.value);
-	      cv2 = value2Chars(data2.type, &data2.value);
-	      if (strcmp(cv1,cv2) == 0) {
-		      if (cv1) free(cv1);
-		      if (cv2) free(cv2);
-	      } else {
-		      if (cv1) free(cv1);
-		      if (cv2) free(cv2);
-		      return 0;
-	      }
-      }
+      if (k1->type != k2->type || k1->state != k2->state)
+         return 0;
+      if (!(k1->state & CMPI_nullValue) &&
+          !native_same_CMPIValue(k1->type, &k1->value, &k2->value))
+         return 0;
    }
 
    return 1;
 }
 
-char *pathToChars(CMPIObjectPath * cop, CMPIStatus * rc, char *str, int uri)
+void pathToStringBuffer(UtilStringBuffer *sb, CMPIObjectPath * cop, int uri)
 {
 //            "//atp:9999/root/cimv25:TennisPlayer.first="Patrick",last="Rafter";
 
-   CMPIString *ns;
-   CMPIString *cn;
-   CMPIString *name;
-   CMPIData data;
-   unsigned int i, m, s;
-   char *v;
-   char *colon = (uri) ? "%3A" : ":";
-   
-   *str = 0;
+   struct native_cop *o = (struct native_cop *) cop;
+   struct native_property *k;
+   char *p, *q;
 
-   ns = cop->ft->getNameSpace(cop, rc);
-   cn = cop->ft->getClassName(cop, rc);
-   
-   if (ns && ns->hdl && *(char*)ns->hdl) {
+   if (o->nameSpace && *o->nameSpace) {
       if (!uri)
-	  strcpy(str,(char*)ns->hdl);
+         sb->ft->appendChars(sb, o->nameSpace);
       else {
-         char *cns=(char*)ns->hdl;
-         for (s=i=0, m=strlen(cns); i<m; i++,s++) {
-            if (cns[i]=='/') {
-               str[s++]='%';
-               str[s++]='2';
-               str[s]='F';
-            }
-            else
-	       str[s]=cns[i];    
-         } 
-         str[s]=0;   
+         for (p = o->nameSpace; (q = strchr(p, '/')) != NULL; p = q + 1) {
+            sb->ft->appendBlock(sb, p, q - p);
+            sb->ft->appendChars(sb, "%2F");
+         }
+         sb->ft->appendChars(sb, p);
       }
-      strcat(str,colon);
-   }   
-   
-   if (ns) CMRelease(ns);
-   strcat(str, (char *) cn->hdl);
-   CMRelease(cn);
-   
-   for (i = 0, m = cop->ft->getKeyCount(cop, rc); i < m; i++) {
-      data = cop->ft->getKeyAt(cop, i, &name, rc);
-      strcat(str, i ? "," : ".");
-      strcat(str, (char *) name->hdl);
-      strcat(str, (uri) ? "%3D" : "=");
-      v = value2Chars(data.type, &data.value);
-      if (data.type & (CMPI_INTEGER | CMPI_REAL))
-         strcat(str, v);
+      sb->ft->appendChars(sb, (uri) ? "%3A" : ":");
+   }
+
+   sb->ft->appendChars(sb, o->classname);
+
+   for (k = o->keys; k; k = k->next) {
+      sb->ft->append3Chars(sb, k == o->keys ? "." : ",", k->name,
+                           (uri) ? "%3D" : "=");
+      if (k->type & (CMPI_INTEGER | CMPI_REAL))
+         value2StringBuffer(sb, k->type, &k->value);
       else {
-	 strcat(str, "\"");
-         strcat(str, v);
-	 strcat(str, "\"");
+         sb->ft->appendChars(sb, "\"");
+         value2StringBuffer(sb, k->type, &k->value);
+         sb->ft->appendChars(sb, "\"");
       }
-      free(v);
-      CMRelease(name);
-   };
- 
-   return str;
+   }
+}
+
+/*
+ * Returns the path string, plain or uri encoded. The string is built
+ * once and kept in the object path until the path is modified.
+ */
+const char *getPathChars(CMPIObjectPath * cop, int uri)
+{
+   struct native_cop *o = (struct native_cop *) cop;
+   UtilStringBuffer *sb;
+   char *str;
+
+   if (o->chars[uri] == NULL) {
+      sb = UtilFactory->newStringBuffer(256);
+      pathToStringBuffer(sb, cop, uri);
+      str = strdup(sb->ft->getCharPtr(sb));
+      sb->ft->release(sb);
+      if (!__sync_bool_compare_and_swap(&o->chars[uri], NULL, str))
+         free(str);
+      else native_arena_adopt(o, str);
+   }
+   return o->chars[uri];
 }
 
 static CMPIString *__oft_toString(CMPIObjectPath * cop, CMPIStatus * rc)
 {
-   char str[4096] = { 0 };
-   pathToChars(cop, rc, str,0);
-   return native_new_CMPIString(str, rc);
+   return native_new_CMPIString(getPathChars(cop, 0), rc);
 }
 
 const char *getNameSpaceChars(CMPIObjectPath * cop)
@@ -474,7 +665,6 @@ void pathToXml(UtilStringBuffer *sb, CMPIObjectPath *cop)
    int i,s,m;
    CMPIData data;
    CMPIString *name;
-   char *cv;
 
    for (i=0,s=__oft_getKeyCount(cop,NULL); i<s; i++) {
       data=__oft_getKeyAt(cop,i,&name,NULL);
@@ -514,11 +704,15 @@ void pathToXml(UtilStringBuffer *sb, CMPIObjectPath *cop)
          CMRelease(cn);
       }
       else {
-         cv = value2Chars(data.type,&data.value);
-         sb->ft->append5Chars(sb,"<KEYVALUE VALUETYPE=\"",
-                                 keytype2Chars(data.type),"\">",cv,
-                                 "</KEYVALUE>");
-        if (cv) free (cv);
+         sb->ft->append3Chars(sb,"<KEYVALUE VALUETYPE=\"",
+                                 keytype2Chars(data.type),"\">");
+         if (data.type==CMPI_string && data.value.string)
+            AsciiToXmlStringBuffer(sb,(char*)data.value.string->hdl);
+         else if (data.type==CMPI_chars && data.value.chars)
+            AsciiToXmlStringBuffer(sb,data.value.chars);
+         else
+            value2StringBuffer(sb,data.type,&data.value);
+         sb->ft->appendChars(sb,"</KEYVALUE>");
       }
 
       sb->ft->appendChars(sb,"</KEYBINDING>\n");
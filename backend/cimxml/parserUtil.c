@@ -27,17 +27,11 @@
 #include "cimXmlParser.h"
 #include "sfcUtil/utilft.h"
 
-static int ct = 0;
-static int dontLex = 0;
-
 extern CMPIConstClass * native_new_CMPIConstClass ( char  *cn, CMPIStatus * rc );
 extern int addClassProperty( CMPIConstClass * ccls, char * name,
                  CMPIValue * value, CMPIType type,
                  CMPIValueState state);
 extern CMPIType guessType(char *val);
-extern int addInstPropertyQualifier( CMPIInstance* ci, char * pname,
-                     char *qname, CMPIValue * value,
-                     CMPIType type);
 extern int addClassPropertyQualifier( CMPIConstClass* cc, char * pname,
                       char *qname, CMPIValue * value,
                       CMPIType type);
@@ -45,6 +39,7 @@ extern int addClassQualifier( CMPIConstClass* cc, char * name,
                       CMPIValue * value,
                       CMPIType type);
 extern char *XmlToAsciiStr(char *XmlStr);
+extern char *XmlToAsciiStrInPlace(char *XmlStr);
 
 #if DEBUG
 extern int do_debug;
@@ -59,6 +54,36 @@ static inline int isBoolean(CMPIData data)
    return -1;
 }
 
+/*
+ * str2CMPIValue() of the text of a VALUE. The entities of a string are
+ * decoded in the parsed response, the text is not used again.
+ */
+static CMPIValue xmlStr2CMPIValue(CMPIType type, char *text)
+{
+   if (type == CMPI_string || type == CMPI_chars)
+      XmlToAsciiStrInPlace(text);
+   return str2CMPIValue(type, text, NULL);
+}
+
+/*
+ * An array of type holding the texts of n VALUEs. The array is sized
+ * once; elements of a fixed width type are stored packed.
+ */
+static CMPIArray *xmlStrs2CMPIArray(CMPIType type, char **values, int n)
+{
+   CMPIArray *arr = newCMPIArray(0, type, NULL);
+   CMPIValue val;
+   int i;
+
+   native_array_increase_size(arr, n);
+   for (i = 0; i < n; i++) {
+      val = xmlStr2CMPIValue(type, values[i]);
+      CMSetArrayElementAt(arr, i, &val, type);
+      native_release_CMPIValue(type, &val);
+   }
+   return arr;
+}
+
 void createPath(CMPIObjectPath **op, XtokInstanceName *p)
 {
    int i;
@@ -84,7 +109,6 @@ void setInstProperties(CMPIInstance *ci, XtokProperties *ps)
    XtokProperty *np = NULL,*p = ps ? ps->first : NULL;
    CMPIValue val;
    CMPIObjectPath *op;
-   CMPIStatus status;
    CMPIType   type = NULL;
    XtokQualifier *nq = NULL,*q;
    XtokQualifiers *qs;
@@ -96,13 +120,7 @@ void setInstProperties(CMPIInstance *ci, XtokProperties *ps)
       case typeProperty_Value:
          type = p->valueType;
          if (p->val.value.data.value != NULL && p->val.null==0) {
-            if (type == CMPI_string || type == CMPI_chars) {
-                char *charsStr = XmlToAsciiStr(p->val.value.data.value);
-                val = str2CMPIValue(type, charsStr, NULL);
-                free (charsStr);
-            }
-            else
-                val = str2CMPIValue(type, p->val.value.data.value, NULL);
+            val = xmlStr2CMPIValue(type, p->val.value.data.value);
             CMSetProperty(ci, p->name, &val, type);
         native_release_CMPIValue(type, &val);
          }
@@ -119,23 +137,8 @@ void setInstProperties(CMPIInstance *ci, XtokProperties *ps)
       case typeProperty_Array:
          type = p->valueType;
          if (p->val.array.next > 0) {
-            CMPIArray *arr = newCMPIArray(0, type, &status);
-            if (p->val.array.max > 0) {
-            int i;
-               for (i = 0; i < p->val.array.next; ++i)
-               {
-                   char *valStr = p->val.array.values[i];
-                   if (type == CMPI_string || type == CMPI_chars) {
-                       char *charsStr = XmlToAsciiStr(valStr);
-                       val = str2CMPIValue(type, charsStr, NULL);
-                       free (charsStr);
-                   }
-                   else
-                       val = str2CMPIValue(type, valStr, NULL);
-                   CMSetArrayElementAt(arr, i, &val, type);
-               native_release_CMPIValue(type, &val);
-               }
-            }
+            CMPIArray *arr = xmlStrs2CMPIArray(type, p->val.array.values,
+                     p->val.array.max > 0 ? p->val.array.next : 0);
             val.array = arr;
             CMSetProperty(ci, p->name, &val, type | CMPI_ARRAY);
             CMRelease(arr);         /* cloned in property */
@@ -148,34 +151,27 @@ void setInstProperties(CMPIInstance *ci, XtokProperties *ps)
       }
 
       if (setq) {
+         /* collected first, so a layout instance can compare the set */
+         struct native_qualifier *ql = NULL;
+
          qs=&p->val.qualifiers;
          q=qs ? qs->first : NULL;  
          n=0;   
          while (q) {
             if (q->type & CMPI_ARRAY) {
-               CMPIArray *arr = NULL;
-               arr = newCMPIArray(0, type, NULL);
                type  = q->type & ~CMPI_ARRAY;
-               int i;
-               if (q->data.array.max) {
-                   for (i = 0; i < q->data.array.next; ++i) {
-                  val = str2CMPIValue(type, q->data.array.values[i], NULL);
-                  CMSetArrayElementAt(arr, i, &val, type);
-                  native_release_CMPIValue(type,&val);
-               }
-               }
-               rc = addInstPropertyQualifier(ci, p->name, q->name,
-                         (CMPIValue *)&arr, q->type); 
-               native_release_CMPIValue(q->type,(CMPIValue*)&arr);
+               val.array = xmlStrs2CMPIArray(type, q->data.array.values,
+                        q->data.array.max ? q->data.array.next : 0);
             }
-            else {
-               val = str2CMPIValue(q->type, q->data.value.data.value, NULL);
-               rc= addInstPropertyQualifier(ci, p->name, q->name, &val, q->type);
-               native_release_CMPIValue(q->type,&val);
-            }   
+            else val = xmlStr2CMPIValue(q->type, q->data.value.data.value);
+            if (qualifierFT.setQualifier(ql, q->name, q->type, &val))
+               qualifierFT.addQualifier(&ql, q->name, q->type, 0, &val);
+            native_release_CMPIValue(q->type,&val);
             nq = q->next; 
             q = nq;
          }
+         if (ql)
+            rc = setInstPropertyQualifiers(ci, p->name, ql);
       }
 
       np = p->next;
@@ -187,6 +183,87 @@ void setInstProperties(CMPIInstance *ci, XtokProperties *ps)
       ps->first = ps->last =  NULL;
 }
 
+static struct native_layout *findLayout(ParserControl *parm, char *cn)
+{
+   int i;
+
+   for (i = 0; cn && i < parm->numLayouts; i++) {
+      if (strcasecmp(parm->layouts[i].className, cn) == 0)
+         return parm->layouts[i].layout;
+   }
+   return NULL;
+}
+
+/*
+ * Instances of a class seen before in this response share the layout
+ * learned from the first one, see addInstanceLayout()
+ */
+CMPIInstance *newLayoutInstance(ParserControl *parm, CMPIObjectPath *op, char *cn)
+{
+   struct native_layout *l = findLayout(parm, cn);
+
+   if (l)
+      return native_new_CMPIInstance_fromLayout(op, l, NULL);
+   return native_new_CMPIInstance(op, NULL);
+}
+
+void addInstanceLayout(ParserControl *parm, CMPIInstance *ci, char *cn)
+{
+   if (cn == NULL || findLayout(parm, cn))
+      return;
+
+   parm->layouts = realloc(parm->layouts,
+                           (parm->numLayouts + 1) * sizeof(ParserLayout));
+   parm->layouts[parm->numLayouts].className = strdup(cn);
+   parm->layouts[parm->numLayouts].layout = native_new_layout(ci, NULL);
+   parm->numLayouts++;
+}
+
+void releaseLayouts(ParserControl *parm)
+{
+   int i;
+
+   for (i = 0; i < parm->numLayouts; i++) {
+      free(parm->layouts[i].className);
+      native_release_layout(parm->layouts[i].layout);
+   }
+   free(parm->layouts);
+   parm->layouts = NULL;
+   parm->numLayouts = 0;
+}
+
+/*
+ * Returns 0 if sel does not want the instance of className with the
+ * properties ps, otherwise removes the properties not in its projection
+ * from ps
+ */
+int selectProperties(ParserSelect *sel, const char *className,
+                     XtokProperties *ps)
+{
+   XtokProperty *p, **pp;
+   char **name;
+
+   if (sel->match && sel->match(sel, className, ps) == 0)
+      return 0;
+
+   if (sel->propertyList) {
+      ps->last = NULL;
+      for (pp = &ps->first; (p = *pp) != NULL; ) {
+         for (name = sel->propertyList; *name; name++) {
+            if (strcasecmp(*name, p->name) == 0)
+               break;
+         }
+         if (*name) {
+            ps->last = p;
+            pp = &p->next;
+         }
+         else
+            *pp = p->next;
+      }
+   }
+   return 1;
+}
+
 void setInstQualifiers(CMPIInstance *ci, XtokQualifiers *qs)
 {
    XtokQualifier *nq = NULL,*q = qs ? qs->first : NULL;
@@ -196,20 +273,16 @@ void setInstQualifiers(CMPIInstance *ci, XtokQualifiers *qs)
    while (q) {
       if (q->type & CMPI_ARRAY) {
                CMPIType type=q->type&~CMPI_ARRAY;
-               CMPIArray *arr = newCMPIArray(0, type, NULL);
-               int i;
+               CMPIArray *arr;
           if (q->data.array.max) {
-              for (i = 0; i < q->data.array.next; ++i) {
-                  val = str2CMPIValue(type, q->data.array.values[i], NULL);
-                  CMSetArrayElementAt(arr, i, &val, type);
-                  native_release_CMPIValue(type,&val);
-               }
+               arr = xmlStrs2CMPIArray(type, q->data.array.values,
+                                       q->data.array.next);
                rc = addInstQualifier(ci, q->name, (CMPIValue*)&arr, q->type);
                native_release_CMPIValue(q->type,(CMPIValue*)&arr);
       }
       }
       else {
-         val = str2CMPIValue(q->type, q->data.value.data.value, NULL);
+         val = xmlStr2CMPIValue(q->type, q->data.value.data.value);
          rc = addInstQualifier(ci, q->name, &val, q->type);
          native_release_CMPIValue( q->type,&val);
       }
@@ -252,21 +325,14 @@ void setClassProperties(CMPIConstClass *cls, XtokProperties *ps)
       while (q) {
          if (q->type & CMPI_ARRAY) {
             CMPIType type=q->type&~CMPI_ARRAY;
-            arr = newCMPIArray(0, type, NULL);
-            int i;
-            if (q->data.array.max) {
-                for (i = 0; i < q->data.array.next; ++i) {
-               val = str2CMPIValue(type, q->data.array.values[i], NULL);
-               CMSetArrayElementAt(arr, i, &val, type);
-               native_release_CMPIValue(type,&val);
-            }
-            }
+            arr = xmlStrs2CMPIArray(type, q->data.array.values,
+                     q->data.array.max ? q->data.array.next : 0);
             val.array = arr;
             rc = addClassPropertyQualifier(cls, p->name, q->name, &val, q->type); 
             native_release_CMPIValue(q->type,(CMPIValue*)&arr);
          }
          else {
-            val = str2CMPIValue(q->type, q->data.value.data.value, NULL);
+            val = xmlStr2CMPIValue(q->type, q->data.value.data.value);
             rc= addClassPropertyQualifier(cls, p->name, q->name, &val, q->type);
             native_release_CMPIValue(q->type,&val);
          }   
@@ -289,36 +355,16 @@ void setClassQualifiers(CMPIConstClass *cls, XtokQualifiers *qs)
    while (q) {
       if (q->type & CMPI_ARRAY) {
                CMPIType type=q->type&~CMPI_ARRAY;
-               CMPIArray *arr = newCMPIArray(0, type, NULL);
-               int i;
+               CMPIArray *arr;
           if (q->data.array.max > 0) {
-              for (i = 0; i < q->data.array.next; ++i) {
-                   char *valStr = q->data.array.values[i];
-                   if (type == CMPI_string || type == CMPI_chars)
-                   {
-                       char *charsStr = XmlToAsciiStr(valStr);
-                       val = str2CMPIValue(type, charsStr, NULL);
-                       free (charsStr);
-                   }
-                   else
-                       val = str2CMPIValue(type, valStr, NULL);
-                  CMSetArrayElementAt(arr, i, &val, type);
-                  native_release_CMPIValue(type,&val);
-               }
+               arr = xmlStrs2CMPIArray(type, q->data.array.values,
+                                       q->data.array.next);
                rc = addClassQualifier(cls, q->name, (CMPIValue*)&arr, q->type);
                native_release_CMPIValue(q->type,(CMPIValue*)&arr);
       }
       }
       else {
-          char *valStr = q->data.value.data.value;
-          if (q->type == CMPI_string || q->type == CMPI_chars)
-          {
-              char *charsStr = XmlToAsciiStr(valStr);
-              val = str2CMPIValue(q->type, charsStr, NULL);
-              free (charsStr);
-          }
-          else
-              val = str2CMPIValue(q->type, valStr, NULL);
+          val = xmlStr2CMPIValue(q->type, q->data.value.data.value);
          rc = addClassQualifier(cls, q->name, &val, q->type);
          native_release_CMPIValue( q->type,&val);
       }
@@ -410,8 +456,10 @@ void setError(ParserControl *parm, XtokErrorResp *e)
        fprintf(stderr, "error:: code:%s description:%s\n", 
                                  e->code, e->description);
 #endif
-   parm->respHdr.errCode = atoi(e->code);
-   parm->respHdr.description = XmlToAsciiStr(e->description);
+   /* DESCRIPTION is optional, CODE is not but may be missing anyway */
+   parm->respHdr.errCode = e->code ? atoi(e->code) : CMPI_RC_ERR_FAILED;
+   parm->respHdr.description = e->description ?
+                               XmlToAsciiStr(e->description) : NULL;
 }
 
 void setReturnArgs(ParserControl *parm, XtokParamValues *ps)
@@ -427,6 +475,14 @@ void setReturnArgs(ParserControl *parm, XtokParamValues *ps)
         args = newCMPIArgs(NULL);
 
         while (outParam) {
+            /* PARAMVALUE without a value element */
+            if (outParam->data.type == CMPI_null &&
+                outParam->data.value.data.value == NULL &&
+                outParam->type != CMPI_instance) {
+                args->ft->addArg ( args, outParam->name, NULL, outParam->type);
+                outParam = outParam->next;
+                continue;
+            }
             value = str2CMPIValue(outParam->type, outParam->data.value.data.value, &outParam->data.valueRef);
 
             /* Add it to the args list */
@@ -30,6 +30,11 @@ static inline int isBoolean(CMPIData data);
 void createPath(CMPIObjectPath **op, XtokInstanceName *p);
 void setInstProperties(CMPIInstance *ci, XtokProperties *ps);
 void setInstQualifiers(CMPIInstance *ci, XtokQualifiers *qs);
+CMPIInstance *newLayoutInstance(ParserControl *parm, CMPIObjectPath *op, char *cn);
+void addInstanceLayout(ParserControl *parm, CMPIInstance *ci, char *cn);
+void releaseLayouts(ParserControl *parm);
+int selectProperties(ParserSelect *sel, const char *className,
+                     XtokProperties *ps);
 void setClassProperties(CMPIConstClass *cls, XtokProperties *ps);
 void setClassQualifiers(CMPIConstClass *cls, XtokQualifiers *qs);
 void addProperty(ParserControl *parm, XtokProperties *ps, XtokProperty *p);
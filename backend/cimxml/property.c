@@ -75,10 +75,10 @@ static int __addProperty ( struct native_property ** prop,
 
    if ( *prop == NULL ) {
       struct native_property * tmp = *prop =
-         (struct native_property *) calloc ( 1, sizeof ( struct native_property ) );
+         (struct native_property *) native_new_node ( sizeof ( struct native_property ) );
 
       tmp->qualifiers = NULL;
-      tmp->name = strdup ( name );
+      tmp->name = native_strdup ( name );
       tmp->type  = type;
       tmp->state = state;
       
@@ -215,12 +215,12 @@ static void __release ( struct native_property * prop )
 {
 	struct native_property * next;
 	for ( ; prop; prop = next ) {
-		free ( prop->name );
+		native_free ( prop->name );
                 if(prop->state != CMPI_nullValue)
                         native_release_CMPIValue ( prop->type, &prop->value );
                 qualifierFT.release(prop->qualifiers);
                 next=prop->next;
-		free ( prop );
+		native_release_node ( prop, sizeof ( struct native_property ) );
  	}
 }
 
@@ -238,9 +238,9 @@ static struct native_property * __clone ( struct native_property * prop,
 	}
 
 	result = (struct native_property * )
-		 calloc ( 1, sizeof ( struct native_property ) );
+		 native_new_node ( sizeof ( struct native_property ) );
 
-	result->name  = strdup ( prop->name );
+	result->name  = native_strdup ( prop->name );
 	result->type  = prop->type;
 	result->state = prop->state;
 	result->value = native_clone_CMPIValue ( prop->type,
@@ -83,9 +83,9 @@ static int __addQualifier ( struct native_qualifier ** qual,
    
    if ( *qual == NULL ) {
       struct native_qualifier * tmp = *qual =
-         (struct native_qualifier *) calloc ( 1, sizeof ( struct native_qualifier ) );
+         (struct native_qualifier *) native_new_node ( sizeof ( struct native_qualifier ) );
 
-      tmp->name = strdup ( name );
+      tmp->name = native_strdup ( name );
       tmp->type  = type;
       tmp->state = state;
       
@@ -211,10 +211,10 @@ static void __release ( struct native_qualifier * qual )
 {
         struct native_qualifier *next; 
         for ( ; qual; qual = next ) {
-		free ( qual->name );
+		native_free ( qual->name );
 		native_release_CMPIValue ( qual->type, &qual->value );
                 next = qual->next;
-		free ( qual );
+		native_release_node ( qual, sizeof ( struct native_qualifier ) );
 	}
 }
 
@@ -231,9 +231,9 @@ static struct native_qualifier * __clone ( struct native_qualifier * qual,
 	}
 
 	result = (struct native_qualifier * ) 
-		 calloc ( 1, sizeof ( struct native_qualifier ) );
+		 native_new_node ( sizeof ( struct native_qualifier ) );
 
-	result->name  = strdup ( qual->name );
+	result->name  = native_strdup ( qual->name );
 	result->type  = qual->type;
 	result->state = qual->state;
 	result->value = native_clone_CMPIValue ( qual->type,
@@ -250,6 +250,22 @@ static struct native_qualifier * __clone ( struct native_qualifier * qual,
 }
 
 
+static int __sameQualifiers ( struct native_qualifier * q1,
+			      struct native_qualifier * q2 )
+{
+	for ( ; q1 && q2; q1 = q1->next, q2 = q2->next ) {
+		if ( strcasecmp ( q1->name, q2->name ) ||
+		     q1->type != q2->type || q1->state != q2->state )
+			return 0;
+		if ( ! ( q1->state & CMPI_nullValue ) &&
+		     ! native_same_CMPIValue ( q1->type, &q1->value,
+					       &q2->value ) )
+			return 0;
+	}
+	return q1 == q2;
+}
+
+
 /**
  * Global function table to access native_qualifier helper functions.
  */
@@ -261,7 +277,8 @@ struct native_qualifierFT const qualifierFT = {
 	__setQualifier,
 	__getDataQualifier,
 	__getDataQualifierAt,
-	__getQualifierCount
+	__getQualifierCount,
+	__sameQualifiers
 };
 
 
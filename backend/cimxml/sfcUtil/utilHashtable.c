@@ -106,6 +106,21 @@ static int cmpiStringCmpFunction(const void *p1, const void *p2)
 
 
 
+extern unsigned long long hashCMPIObjectPath(const void *cop);
+extern int sameCMPIObjectPath(const void *cop1, const void *cop2);
+
+static unsigned long cmpiObjectPathHashFunction(const void *key)
+{
+   return (unsigned long) hashCMPIObjectPath(key);
+}
+
+static int cmpiObjectPathCmpFunction(const void *p1, const void *p2)
+{
+   return !sameCMPIObjectPath(p1, p2);
+}
+
+
+
 UtilHashTable *newHashTableDefault(long buckets)
 {
    UtilHashTable *ht = (UtilHashTable *) malloc(sizeof(UtilHashTable));
@@ -156,6 +171,11 @@ UtilHashTable *newHashTable(long buckets, long opt)
       }
    }
 
+   else if (opt & UtilHashTable_CMPIObjectPathKey) {
+      UtilHashTableFT->setHashFunction(ht, cmpiObjectPathHashFunction);
+      UtilHashTableFT->setKeyCmpFunction(ht, cmpiObjectPathCmpFunction);
+   }
+
    if (opt & UtilHashTable_charValue) {
       if (opt & UtilHashTable_ignoreValueCase)
          UtilHashTableFT->setValueCmpFunction(ht, charIcCmpFunction);
@@ -166,7 +186,7 @@ UtilHashTable *newHashTable(long buckets, long opt)
       UtilHashTableFT->setValueCmpFunction(ht, ptrCmpFunction);
 
    if (opt & UtilHashTable_managedKey) {
-      if (opt & UtilHashTable_CMPIStringKey)
+      if (opt & (UtilHashTable_CMPIStringKey | UtilHashTable_CMPIObjectPathKey))
          keyRelease = NULL;
       else
          keyRelease = free;
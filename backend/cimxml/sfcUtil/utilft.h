@@ -94,6 +94,7 @@ extern "C" {
 #define UtilHashTable_CMPIStyleValue 32
 #define UtilHashTable_ignoreValueCase 64
 #define UtilHashTable_managedValue 128
+#define UtilHashTable_CMPIObjectPathKey 256
 
 
    struct _Util_List_FT;
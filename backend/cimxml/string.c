@@ -39,11 +39,21 @@
 //CMPIString *strTab[5000];
 //int strTabNext=0;
 
+//! Native extension of the CMPIString data type.
+/*!
+  The characters are kept in the same allocation as the string object,
+  unless they are borrowed from a buffer that outlives the string. Clones
+  share the string object; it is freed when the last reference to it is
+  released. Clones made outside of the arena of a string are copies.
+ */
 struct native_string {
 	CMPIString string;
+	int refCount;		//!< References held on this string.
+	char chars[1];		//!< Own copy of the characters, if any.
 };
 
-static struct native_string * __new_string ( const char *, CMPIStatus * );
+static struct native_string * __new_string ( const char *, int,
+					     CMPIStatus * );
 
 
 /*****************************************************************************/
@@ -51,13 +61,13 @@ static struct native_string * __new_string ( const char *, CMPIStatus * );
 static CMPIStatus __sft_release ( CMPIString * string )
 {
 	struct native_string * s = (struct native_string *) string;
-int i;
-//	for (i=0; i<strTabNext; i++) if (strTab[i]==string) { strTab[i]=NULL; break; }
+
         if ( s ) {
 
-		if (s->string.hdl != NULL)
-		    free ( s->string.hdl );
-		free ( s );
+		if ( __sync_sub_and_fetch ( &s->refCount, 1 ) == 0 )
+			native_release_node ( s, sizeof ( struct native_string ) +
+					      ( ( string->hdl == s->chars )?
+						strlen ( s->chars ): 0 ) );
 
 		CMReturn ( CMPI_RC_OK );
 	}
@@ -68,8 +78,15 @@ int i;
 
 static CMPIString * __sft_clone ( CMPIString * string, CMPIStatus * rc )
 {
-	return (CMPIString * )
-		__new_string ( string->ft->getCharPtr ( string, rc ), rc );
+	struct native_string * s = (struct native_string *) string;
+
+	if ( ! native_arena_local ( s ) )
+		return native_new_CMPIString ( string->hdl, rc );
+
+	__sync_fetch_and_add ( &s->refCount, 1 );
+
+	CMSetStatus ( rc, CMPI_RC_OK );
+	return string;
 }
 
 
@@ -80,6 +97,7 @@ static char * __sft_getCharPtr ( CMPIString * string, CMPIStatus * rc )
 
 
 static struct native_string * __new_string ( const char * ptr, 
+					     int borrow,
 					     CMPIStatus * rc )
 {
 	static CMPIStringFT const sft = {
@@ -89,12 +107,19 @@ static struct native_string * __new_string ( const char * ptr,
 		__sft_getCharPtr
 	};
 
+	size_t len = ( ptr && ! borrow )? strlen ( ptr ): 0;
 	struct native_string * string =
 		(struct native_string *)
-		calloc ( 1, sizeof ( struct native_string ) );
+		native_new_node ( sizeof ( struct native_string ) + len );
 
-        string->string.hdl = ( ptr )? strdup ( ptr ): NULL;
+	if ( ptr == NULL || borrow ) {
+		string->string.hdl = (char *) ptr;
+	} else {
+		memcpy ( string->chars, ptr, len + 1 );
+		string->string.hdl = string->chars;
+	}
 	string->string.ft  = (CMPIStringFT*) &sft;
+	string->refCount   = 1;
 
 	CMSetStatus ( rc, CMPI_RC_OK );
 	return string;
@@ -103,7 +128,19 @@ static struct native_string * __new_string ( const char * ptr,
 
 CMPIString * native_new_CMPIString ( const char * ptr, CMPIStatus * rc )
 {
-	return (CMPIString *) __new_string ( ptr, rc );
+	return (CMPIString *) __new_string ( ptr, 0, rc );
+}
+
+
+//! Creates a CMPIString that refers to ptr instead of copying it.
+/*!
+  The characters must remain valid and unchanged until the string and
+  all of its clones are released, as with string constants.
+ */
+CMPIString * native_new_CMPIString_borrowed ( const char * ptr,
+					      CMPIStatus * rc )
+{
+	return (CMPIString *) __new_string ( ptr, 1, rc );
 }
 
 
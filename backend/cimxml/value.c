@@ -35,8 +35,10 @@
 char *keytype2Chars(CMPIType type);
 CMPIType guessType(char *val);
 char *value2Chars(CMPIType type, CMPIValue * value);
-extern char *pathToChars(CMPIObjectPath * cop, CMPIStatus * rc, char *str,
-								 int uri);
+extern const char *getPathChars(CMPIObjectPath * cop, int uri);
+extern char *XmlToAsciiStrInPlace(char *XmlStr);
+extern void pathToStringBuffer(UtilStringBuffer *sb, CMPIObjectPath * cop,
+                               int uri);
 
 
 void native_release_CMPIValue ( CMPIType type, CMPIValue * val )
@@ -76,7 +78,7 @@ void native_release_CMPIValue ( CMPIType type, CMPIValue * val )
 	
 		case CMPI_chars:
 			if (val->chars)
-			    free ( val->chars );
+			    native_free ( val->chars );
 			break;
 	
 		case CMPI_dateTime:
@@ -136,7 +138,7 @@ CMPIValue native_clone_CMPIValue ( CMPIType type,
 
 		case CMPI_chars:
                         if (val->chars)
-			v.chars = strdup ( val->chars );
+			v.chars = native_strdup ( val->chars );
 			break;
 
 		case CMPI_dateTime:
@@ -154,9 +156,143 @@ CMPIValue native_clone_CMPIValue ( CMPIType type,
 	return v;
 }
 
+
+static int __same_chars ( const char * c1, const char * c2 )
+{
+	return c1 == c2 || ( c1 && c2 && strcmp ( c1, c2 ) == 0 );
+}
+
+
+/**
+ * returns non-zero if both values of the given type are equal, arrays
+ * are compared element by element
+ */
+int native_same_CMPIValue ( CMPIType type, CMPIValue * v1, CMPIValue * v2 )
+{
+	CMPIData d1, d2;
+	unsigned int i, m;
+
+	if ( type & CMPI_ARRAY ) {
+		if ( v1->array == NULL || v2->array == NULL )
+			return v1->array == v2->array;
+		m = CMGetArrayCount ( v1->array, NULL );
+		if ( m != CMGetArrayCount ( v2->array, NULL ) )
+			return 0;
+		for ( i = 0; i < m; i++ ) {
+			d1 = CMGetArrayElementAt ( v1->array, i, NULL );
+			d2 = CMGetArrayElementAt ( v2->array, i, NULL );
+			if ( d1.type != d2.type || d1.state != d2.state )
+				return 0;
+			if ( ! ( d1.state & CMPI_nullValue ) &&
+			     ! native_same_CMPIValue ( d1.type, &d1.value,
+						       &d2.value ) )
+				return 0;
+		}
+		return 1;
+	}
+
+	switch ( type ) {
+	case CMPI_ref:
+		if ( v1->ref == NULL || v2->ref == NULL )
+			return v1->ref == v2->ref;
+		return sameCMPIObjectPath ( v1->ref, v2->ref );
+	case CMPI_chars:
+		return __same_chars ( v1->chars, v2->chars );
+	case CMPI_string:
+	case CMPI_numericString:
+	case CMPI_booleanString:
+	case CMPI_dateTimeString:
+		if ( v1->string == NULL || v2->string == NULL )
+			return v1->string == v2->string;
+		return __same_chars ( v1->string->hdl, v2->string->hdl );
+	case CMPI_dateTime:
+		if ( v1->dateTime == NULL || v2->dateTime == NULL )
+			return v1->dateTime == v2->dateTime;
+		return CMGetBinaryFormat ( v1->dateTime, NULL ) ==
+		       CMGetBinaryFormat ( v2->dateTime, NULL ) &&
+		       CMIsInterval ( v1->dateTime, NULL ) ==
+		       CMIsInterval ( v2->dateTime, NULL );
+	case CMPI_boolean:
+		return ( v1->boolean != 0 ) == ( v2->boolean != 0 );
+	case CMPI_uint8:
+	case CMPI_sint8:
+		return v1->uint8 == v2->uint8;
+	case CMPI_char16:
+	case CMPI_uint16:
+	case CMPI_sint16:
+		return v1->uint16 == v2->uint16;
+	case CMPI_uint32:
+	case CMPI_sint32:
+		return v1->uint32 == v2->uint32;
+	case CMPI_uint64:
+	case CMPI_sint64:
+		return v1->uint64 == v2->uint64;
+	case CMPI_real32:
+		return v1->real32 == v2->real32;
+	case CMPI_real64:
+		return v1->real64 == v2->real64;
+	default:
+		return v1->inst == v2->inst;
+	}
+}
+
+
+/**
+ * Adds a reference to a payload shared by copy-on-write clones. The
+ * counter is created on the first clone and accounts for the original.
+ */
+int * native_share_payload ( int ** refCount )
+{
+	int * c = *refCount;
+
+	if ( c == NULL ) {
+		c  = (int *) native_malloc ( sizeof ( int ) );
+		*c = 1;
+		if ( ! __sync_bool_compare_and_swap ( refCount, NULL, c ) ) {
+			native_free ( c );
+			c = *refCount;
+		}
+	}
+	__sync_add_and_fetch ( c, 1 );
+	return c;
+}
+
+
+/**
+ * Drops a reference to a shared payload, returns non-zero if the caller
+ * held the last one and has to free the payload.
+ */
+int native_release_payload ( int ** refCount )
+{
+	int * c = *refCount;
+
+	if ( c && __sync_sub_and_fetch ( c, 1 ) > 0 ) return 0;
+
+	native_free ( c );
+	*refCount = NULL;
+	return 1;
+}
+
+
+/**
+ * Returns non-zero if the payload is still shared with other clones and
+ * must be copied before it is modified.
+ */
+int native_payload_shared ( int ** refCount )
+{
+	int * c = *refCount;
+
+	if ( c == NULL ) return 0;
+	if ( *c > 1 ) return 1;
+
+	native_free ( c );
+	*refCount = NULL;
+	return 0;
+}
+
 static char *value2CharsUri(CMPIType type, CMPIValue * value, int uri)
 {
-   char str[2048], *p;
+   char str[64], *p;
    unsigned int size;
    CMPIString *cStr;
 
@@ -170,7 +306,7 @@ static char *value2CharsUri(CMPIType type, CMPIValue * value, int uri)
          break;
 
       case CMPI_ref:
-         return strdup(value->ref ? pathToChars(value->ref, NULL, str, uri) : "NULL");
+         return strdup(value->ref ? getPathChars(value->ref, uri) : "NULL");
 
       case CMPI_args:
          break;
@@ -260,6 +396,137 @@ char *value2Chars(CMPIType type, CMPIValue * value)
    return value2CharsUri(type,value,0);
 }
 
+static const char digitPairs[] =
+   "00010203040506070809101112131415161718192021222324252627282930313233"
+   "34353637383940414243444546474849505152535455565758596061626364656667"
+   "6869707172737475767778798081828384858687888990919293949596979899";
+
+/* formats v backwards into the bytes before end, returns the first byte */
+static char *uint64ToChars(char *end, CMPIUint64 v)
+{
+   char *p = end;
+
+   while (v >= 100) {
+      unsigned int i = (unsigned int) (v % 100) * 2;
+      v /= 100;
+      *--p = digitPairs[i + 1];
+      *--p = digitPairs[i];
+   }
+   if (v >= 10) {
+      *--p = digitPairs[v * 2 + 1];
+      *--p = digitPairs[v * 2];
+   }
+   else *--p = '0' + (char) v;
+   return p;
+}
+
+static void appendUint64(UtilStringBuffer *sb, CMPIUint64 v)
+{
+   char str[24], *end = str + sizeof(str);
+   char *p = uint64ToChars(end, v);
+
+   sb->ft->appendBlock(sb, p, end - p);
+}
+
+static void appendSint64(UtilStringBuffer *sb, CMPISint64 v)
+{
+   char str[24], *end = str + sizeof(str);
+   char *p;
+
+   if (v < 0) {
+      p = uint64ToChars(end, 0 - (CMPIUint64) v);
+      *--p = '-';
+   }
+   else p = uint64ToChars(end, (CMPIUint64) v);
+   sb->ft->appendBlock(sb, p, end - p);
+}
+
+static void appendReal(UtilStringBuffer *sb, double d)
+{
+   char str[32];
+
+   /* integral values of up to six digits look the same with %g */
+   if (d > -1e6 && d < 1e6 && d == (CMPISint64) d && (d != 0 || 1 / d > 0)) {
+      appendSint64(sb, (CMPISint64) d);
+      return;
+   }
+   sb->ft->appendBlock(sb, str, snprintf(str, sizeof(str), "%g", d));
+}
+
+/*
+ * Same as value2Chars(), but appends the value to sb instead of
+ * returning a malloc'ed string
+ */
+void value2StringBuffer(UtilStringBuffer *sb, CMPIType type, CMPIValue * value)
+{
+   CMPIString *cStr;
+
+   switch (type) {
+   case CMPI_ref:
+      if (value->ref)
+         pathToStringBuffer(sb, value->ref, 0);
+      else
+         sb->ft->appendChars(sb, "NULL");
+      break;
+
+   case CMPI_chars:
+      sb->ft->appendChars(sb, value->chars ? (char*)value->chars : "NULL");
+      break;
+
+   case CMPI_string:
+   case CMPI_numericString:
+   case CMPI_booleanString:
+   case CMPI_dateTimeString:
+      sb->ft->appendChars(sb, value->string ? (char*)value->string->hdl : "NULL");
+      break;
+
+   case CMPI_dateTime:
+      if (value->dateTime) {
+         cStr = CMGetStringFormat(value->dateTime, NULL);
+         sb->ft->appendChars(sb, (char *) cStr->hdl);
+         CMRelease(cStr);
+      }
+      else sb->ft->appendChars(sb, "NULL");
+      break;
+
+   case CMPI_boolean:
+      sb->ft->appendChars(sb, value->boolean ? "true" : "false");
+      break;
+
+   case CMPI_uint8:
+      appendUint64(sb, value->uint8);
+      break;
+   case CMPI_sint8:
+      appendSint64(sb, value->sint8);
+      break;
+   case CMPI_uint16:
+      appendUint64(sb, value->uint16);
+      break;
+   case CMPI_sint16:
+      appendSint64(sb, value->sint16);
+      break;
+   case CMPI_uint32:
+      appendUint64(sb, value->uint32);
+      break;
+   case CMPI_sint32:
+      appendSint64(sb, value->sint32);
+      break;
+   case CMPI_uint64:
+      appendUint64(sb, value->uint64);
+      break;
+   case CMPI_sint64:
+      appendSint64(sb, value->sint64);
+      break;
+
+   case CMPI_real32:
+      appendReal(sb, value->real32);
+      break;
+   case CMPI_real64:
+      appendReal(sb, value->real64);
+      break;
+   }
+}
+
 char *keytype2Chars(CMPIType type)
 {
    if (type == CMPI_boolean) return "boolean";
@@ -335,8 +602,9 @@ CMPIValue *getKeyValueTypePtr(char *type, char *value, XtokValueReference *ref,
       }
    }
    
+   /* a string KEYVALUE is only converted once, decode it where it is */
    *typ = CMPI_chars;
-   return (CMPIValue *) value;
+   return (CMPIValue *) XmlToAsciiStrInPlace(value);
 }
 
 CMPIInstance *getInstFromEmbedded(XtokInstance *inst)
@@ -351,6 +619,8 @@ CMPIInstance *getInstFromEmbedded(XtokInstance *inst)
 CMPIType guessType(char *val)
 {
    /* TODO: Currently doesn't guess right for real values (3.175e+00) */
+   if (val == NULL)
+     return CMPI_string;
    if (((*val=='-' || *val=='+') && strlen(val)>1) || isdigit(*val)) {
       char *c;
       for (c=val+1; ; c++) {
@@ -389,7 +659,7 @@ CMPIValue str2CMPIValue(CMPIType type, char *val, XtokValueReference *ref)
        t = type & ~CMPI_ARRAY;
      } else {
        /* the guess type can go wrong */
-       t = guessType(arr->values[0]);
+       t = max ? guessType(arr->values[0]) : CMPI_string;
      }
      /* build an array by looping thru the elements */
      value.array = native_new_CMPIArray(max,t,NULL);
@@ -403,6 +673,10 @@ CMPIValue str2CMPIValue(CMPIType type, char *val, XtokValueReference *ref)
      }
    }   
    
+   /* an empty VALUE element */
+   if (val == NULL && type != CMPI_ref && type != CMPI_instance)
+      val = "";
+
    switch (type) {
    case CMPI_char16:
       value.char16 = *val;
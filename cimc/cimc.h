@@ -98,7 +98,8 @@ extern "C" {
 	@param cl Client this pointer.
 	@param op ObjectPath containing nameSpace and classname components.
 	@param flags Any combination of the following flags are supported: CIMC_FLAG_LocalOnly, 
-	CIMC_FLAG_DeepInheritance, CIMC_FLAG_IncludeQualifiers and CIMC_FLAG_IncludeClassOrigin.
+	CIMC_FLAG_DeepInheritance, CIMC_FLAG_IncludeQualifiers, CIMC_FLAG_IncludeClassOrigin and
+	CIMC_FLAG_ArenaResult (see enumInstances).
 	@param rc Output: Service return status (suppressed when NULL).
 	@return Enumeration of Instances.
     */
@@ -185,7 +186,11 @@ extern "C" {
 	@param cl Client this pointer.
 	@param op ObjectPath containing nameSpace and classname components.
 	@param flags Any combination of the following flags are supported: CIMC_FLAG_LocalOnly, 
-	CIMC_FLAG_DeepInheritance, CIMC_FLAG_IncludeQualifiers and CIMC_FLAG_IncludeClassOrigin.
+	CIMC_FLAG_DeepInheritance, CIMC_FLAG_IncludeQualifiers, CIMC_FLAG_IncludeClassOrigin and
+	CIMC_FLAG_ArenaResult. With CIMC_FLAG_ArenaResult all objects of the result are
+	kept in one arena and released at once with the enumeration. They must not be
+	released one by one; what is added to them when modified is kept in the arena
+	too. Clones of them are independent objects.
 	@param properties If not NULL, the members of the array define one or more Property
 	names. Each returned Object MUST NOT include elements for any Properties
 	missing from this list
@@ -220,7 +225,8 @@ extern "C" {
 	(i.e. the name of the Property in the Association Class that refers to
 	the returned Object MUST match the value of this parameter).
 	@param flags Any combination of the following flags are supported: 
-	CIMC_FLAG_IncludeQualifiers and CIMC_FLAG_IncludeClassOrigin.
+	CIMC_FLAG_IncludeQualifiers, CIMC_FLAG_IncludeClassOrigin and
+	CIMC_FLAG_ArenaResult (see enumInstances).
 	@param properties If not NULL, the members of the array define one or more Property
 	names. Each returned Object MUST NOT include elements for any Properties
 	missing from this list
@@ -279,7 +285,8 @@ extern "C" {
 	(i.e. the name of the Property in the Association Class that refers
 	to the source Object MUST match the value of this parameter).
 	@param flags Any combination of the following flags are supported: 
-	CIMC_FLAG_IncludeQualifiers and CIMC_FLAG_IncludeClassOrigin.
+	CIMC_FLAG_IncludeQualifiers, CIMC_FLAG_IncludeClassOrigin and
+	CIMC_FLAG_ArenaResult (see enumInstances).
 	@param properties If not NULL, the members of the array define one or more Property
 	names. Each returned Object MUST NOT include elements for any Properties
 	missing from this list
@@ -399,6 +406,12 @@ extern "C" {
     CIMCIndicationListener* (*newIndicationListener)
       (CIMCEnv *ce, int sslMode, int *portNumber, char **socketName, 
        void (*fp) (CIMCInstance *indInstance), CIMCStatus* rc);
+    /* Hash of an object path, equal for paths sameObjectPath() finds
+       equal: names ignore case, keys may be in any order */
+    CIMCUint64 (*hashObjectPath)
+      (CIMCEnv *ce, const CIMCObjectPath *op);
+    int (*sameObjectPath)
+      (CIMCEnv *ce, const CIMCObjectPath *op1, const CIMCObjectPath *op2);
   } CIMCEnvFT;
 
   struct _CIMCEnv {
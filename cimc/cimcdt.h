@@ -279,6 +279,40 @@ extern "C" {
    #define CIMC_FLAG_DeepInheritance    2
    #define CIMC_FLAG_IncludeQualifiers  4
    #define CIMC_FLAG_IncludeClassOrigin 8
+   /* sfcc extension: the objects of the result are kept in one arena
+      and released all at once with the enumeration */
+   #define CIMC_FLAG_ArenaResult          256
+
+   /* Indication listener options, see CIMCIndicationListenerFT.setOption */
+
+   #define CIMC_IL_OPT_Backlog          1
+   #define CIMC_IL_OPT_Workers          2
+   #define CIMC_IL_OPT_KeepAliveTimeout 3   /* seconds, at least 1 */
+   #define CIMC_IL_OPT_KeepAliveMax     4
+   #define CIMC_IL_OPT_QueueSize        5
+   #define CIMC_IL_OPT_Overflow         6
+   #define CIMC_IL_OPT_BatchSize        7
+   #define CIMC_IL_OPT_CoalesceWindow   8   /* milliseconds, 0 for none */
+   #define CIMC_IL_OPT_JournalSegmentSize 9 /* bytes per journal file */
+   #define CIMC_IL_OPT_JournalSync     10   /* milliseconds between syncs */
+   #define CIMC_IL_OPT_MaxPayload      11   /* bytes, larger requests get 413 */
+
+   /* What the listener does with an indication when its queue is full */
+
+   #define CIMC_IL_OVERFLOW_Block       0
+   #define CIMC_IL_OVERFLOW_DropOldest  1
+   #define CIMC_IL_OVERFLOW_DropNewest  2
+
+   /* Tests an indication must pass, see CIMCIndicationListenerFT.addFilter() */
+
+   #define CIMC_IL_FILTER_Equal         1   /* property == values[0] */
+   #define CIMC_IL_FILTER_NotEqual      2   /* property != values[0] */
+   #define CIMC_IL_FILTER_Range         3   /* values[0] <= property <= values[1] */
+   #define CIMC_IL_FILTER_In            4   /* property is one of values[] */
+
+   /* uint32 property of coalesced indications, the number received */
+
+   #define CIMC_IL_RepeatCount "SFCC_RepeatCount"
 
    #define CIMCInvocationFlags "CIMCInvocationFlags"
    #define CIMCPrincipal "CIMCPrincipal"
@@ -313,6 +347,25 @@ extern "C" {
       CIMCString *msg;
    } CIMCStatus;
 
+   typedef struct _CIMCIndicationListenerStats {
+      CIMCUint64 enqueued;      /* indications queued for delivery */
+      CIMCUint64 delivered;     /* indications passed to the callback */
+      CIMCUint64 dropped;       /* indications lost to the overflow policy */
+      CIMCUint64 latencyTotal;  /* microseconds from queueing to delivery */
+      CIMCUint64 latencyMax;
+      CIMCUint64 connections;   /* connections accepted */
+      CIMCUint64 requests;      /* requests received */
+      CIMCUint64 badRequests;   /* requests refused as malformed */
+      CIMCUint64 timeouts;      /* requests not received in time */
+      CIMCUint64 disconnects;   /* senders gone within a request */
+      CIMCUint64 acceptErrors;  /* failed accept() calls */
+      CIMCUint64 pollErrors;    /* failed epoll_wait() calls */
+      CIMCUint64 filtered;      /* indications failing a filter */
+      CIMCUint64 coalesced;     /* duplicates collapsed into another */
+      CIMCUint64 journaled;     /* indications written to the journal */
+      CIMCUint64 parseErrors;   /* requests that are no CIM-XML export */
+   } CIMCIndicationListenerStats;
+
 
    /* Management Broker classification and feature support */
 
@@ -745,8 +745,10 @@ extern "C" {
     CIMCIndicationListener* (*clone)
       (CIMCIndicationListener* il, CIMCStatus* rc);
 
-    /** Start listening.
+    /** Start listening. Fails if the listening socket cannot be set up,
+        for example because the port is in use.
 	@param il pointer to this indication listener.
+	@return Service return status, with a message on failure.
     */
     CIMCStatus (*start)
       (CIMCIndicationListener* il);
@@ -756,6 +758,119 @@ extern "C" {
     */
     CIMCStatus (*stop)
       (CIMCIndicationListener* il);      
+
+    /** Set a listener option, one of the CIMC_IL_OPT_ constants. Options
+        take effect on the next start.
+	@param il pointer to this indication listener.
+	@param option the option to set.
+	@param value the new value of the option.
+	@return Service return status.
+    */
+    CIMCStatus (*setOption)
+      (CIMCIndicationListener* il, int option, long value);
+
+    /** Deliver indications in batches of up to CIMC_IL_OPT_BatchSize
+        instead of one by one. As with the single indication callback,
+        the callback releases the instances.
+	@param il pointer to this indication listener.
+	@param fp the batch callback, NULL to deliver one by one.
+	@return Service return status.
+    */
+    CIMCStatus (*setBatchCallback)
+      (CIMCIndicationListener* il,
+       void (*fp) (CIMCInstance **indInstances, int count));
+
+    /** Get the listener's counters.
+	@param il pointer to this indication listener.
+	@param stats Output: the counters since the listener was created.
+	@return Service return status.
+    */
+    CIMCStatus (*getStatistics)
+      (CIMCIndicationListener* il, CIMCIndicationListenerStats* stats);
+
+    /** Add a test on a property that indications must pass to be
+        delivered. An indication is delivered if it passes all tests; one
+        without the property, or with a null value, fails. The tests are
+        made on the received properties before an instance is built.
+        Strings compare case sensitively. Not possible while listening.
+	@param il pointer to this indication listener.
+	@param name the property name.
+	@param test one of the CIMC_IL_FILTER_ constants.
+	@param values the values to test with, two for CIMC_IL_FILTER_Range.
+	@param count the number of values.
+	@param type the type of the values, a string, boolean, integer or
+	       real type.
+	@return Service return status.
+    */
+    CIMCStatus (*addFilter)
+      (CIMCIndicationListener* il, const char *name, int test,
+       const CIMCValue *values, int count, CIMCType type);
+
+    /** Remove all tests added with addFilter(). Not possible while
+        listening.
+	@param il pointer to this indication listener.
+	@return Service return status.
+    */
+    CIMCStatus (*clearFilters)
+      (CIMCIndicationListener* il);
+
+    /** Build delivered indications with the given properties only. Not
+        possible while listening.
+	@param il pointer to this indication listener.
+	@param propertyList NULL terminated list of property names, NULL
+	       for all properties.
+	@return Service return status.
+    */
+    CIMCStatus (*setProjection)
+      (CIMCIndicationListener* il, const char **propertyList);
+
+    /** Set the properties whose values, along with the class name,
+        identify duplicate indications when the CIMC_IL_OPT_CoalesceWindow
+        option is set. The first indication of a kind is held for the
+        window, duplicates received meanwhile are dropped, and it is
+        delivered with the number received in its CIMC_IL_RepeatCount
+        property. Absent and null properties match each other. By
+        default indications of a class are duplicates if they agree in
+        SourceInstanceModelPath, SourceInstanceHost,
+        AlertingManagedElement and AlertType, i.e. come from the same
+        source. Not possible while listening.
+	@param il pointer to this indication listener.
+	@param propertyList NULL terminated list of property names, NULL
+	       for the default.
+	@return Service return status.
+    */
+    CIMCStatus (*setCoalesceKeys)
+      (CIMCIndicationListener* il, const char **propertyList);
+
+    /** Journal the indications received in directory, so that they can
+        be replayed after a restart. The journal is written to files of
+        CIMC_IL_OPT_JournalSegmentSize bytes, named by the journal offset
+        they start at, and synced to disk every CIMC_IL_OPT_JournalSync
+        milliseconds. Files wholly before an offset already replayed may
+        be removed. Not possible while listening.
+	@param il pointer to this indication listener.
+	@param directory the journal directory, created if needed, NULL for
+	       no journal.
+	@return Service return status.
+    */
+    CIMCStatus (*setJournal)
+      (CIMCIndicationListener* il, const char *directory);
+
+    /** Pass the journaled indications from offset on to fp, after the
+        listener's filters and projection, together with the offset to
+        resume after each. The callback releases the instances. Possible
+        while listening.
+	@param il pointer to this indication listener.
+	@param offset 0 or an offset passed to fp before.
+	@param fp the callback.
+	@param end Output: the offset following the last indication
+	       replayed (suppressed when NULL).
+	@return Service return status.
+    */
+    CIMCStatus (*replayJournal)
+      (CIMCIndicationListener* il, CIMCUint64 offset,
+       void (*fp) (CIMCInstance *indInstance, CIMCUint64 next),
+       CIMCUint64 *end);
   };
 #ifdef __cplusplus
 };
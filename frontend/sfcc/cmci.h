@@ -109,7 +109,8 @@ typedef struct _CMCIClientFT {
 	 @param cl Client this pointer.
 	 @param op ObjectPath containing nameSpace and classname components.
 	 @param flags Any combination of the following flags are supported: CMPI_FLAG_LocalOnly, 
-	     CMPI_FLAG_DeepInheritance, CMPI_FLAG_IncludeQualifiers and CMPI_FLAG_IncludeClassOrigin.
+	     CMPI_FLAG_DeepInheritance, CMPI_FLAG_IncludeQualifiers, CMPI_FLAG_IncludeClassOrigin and
+	     CMPI_FLAG_ArenaResult (see enumInstances).
 	 @param rc Output: Service return status (suppressed when NULL).
 	 @return Enumeration of Instances.
      */
@@ -196,7 +197,11 @@ typedef struct _CMCIClientFT {
 	 @param cl Client this pointer.
 	 @param op ObjectPath containing nameSpace and classname components.
 	 @param flags Any combination of the following flags are supported: CMPI_FLAG_LocalOnly, 
-	     CMPI_FLAG_DeepInheritance, CMPI_FLAG_IncludeQualifiers and CMPI_FLAG_IncludeClassOrigin.
+	     CMPI_FLAG_DeepInheritance, CMPI_FLAG_IncludeQualifiers, CMPI_FLAG_IncludeClassOrigin and
+	     CMPI_FLAG_ArenaResult. With CMPI_FLAG_ArenaResult all objects of the result are
+	     kept in one arena and released at once with the enumeration. They must not be
+	     released one by one; what is added to them when modified is kept in the arena
+	     too. Clones of them are independent objects.
 	 @param properties If not NULL, the members of the array define one or more Property
 	     names. Each returned Object MUST NOT include elements for any Properties
 	     missing from this list
@@ -231,7 +236,8 @@ typedef struct _CMCIClientFT {
 	    (i.e. the name of the Property in the Association Class that refers to
 	    the returned Object MUST match the value of this parameter).
 	 @param flags Any combination of the following flags are supported: 
-	    CMPI_FLAG_IncludeQualifiers and CMPI_FLAG_IncludeClassOrigin.
+	    CMPI_FLAG_IncludeQualifiers, CMPI_FLAG_IncludeClassOrigin and
+	    CMPI_FLAG_ArenaResult (see enumInstances).
 	 @param properties If not NULL, the members of the array define one or more Property
 	     names. Each returned Object MUST NOT include elements for any Properties
 	     missing from this list
@@ -290,7 +296,8 @@ typedef struct _CMCIClientFT {
 	    (i.e. the name of the Property in the Association Class that refers
 	    to the source Object MUST match the value of this parameter).
 	 @param flags Any combination of the following flags are supported: 
-	    CMPI_FLAG_IncludeQualifiers and CMPI_FLAG_IncludeClassOrigin.
+	    CMPI_FLAG_IncludeQualifiers, CMPI_FLAG_IncludeClassOrigin and
+	    CMPI_FLAG_ArenaResult (see enumInstances).
 	 @param properties If not NULL, the members of the array define one or more Property
 	     names. Each returned Object MUST NOT include elements for any Properties
 	     missing from this list
@@ -408,6 +415,7 @@ CMPIObjectPath * newCMPIObjectPath ( const char * my_nameSpace,
 					     const char * classname,
 					     CMPIStatus * rc );
 int sameCMPIObjectPath ( const CMPIObjectPath *cop1, const CMPIObjectPath *cop2);
+CMPIUint64 hashCMPIObjectPath ( const CMPIObjectPath *cop );
    
 #ifdef __cplusplus
  };
@@ -337,6 +337,9 @@ extern "C" {
    #define CMPI_FLAG_DeepInheritance    2
    #define CMPI_FLAG_IncludeQualifiers  4
    #define CMPI_FLAG_IncludeClassOrigin 8
+   /* sfcc extension: the objects of the result are kept in one arena
+      and released all at once with the enumeration */
+   #define CMPI_FLAG_ArenaResult          256
 
    #define CMPIInvocationFlags "CMPIInvocationFlags"
    #define CMPIPrincipal "CMPIPrincipal"
@@ -18,6 +18,7 @@ struct _CMCIConnection {
     UtilStringBuffer *mBody;     // The body of the request
     UtilStringBuffer *mUri;      // The uri of the request
     UtilStringBuffer *mUserPass; // The username/password used in authentication
+    UtilStringBuffer *mCimObject; // The CIMObject header of the request
     UtilStringBuffer *mResponse; // Used to store the HTTP response
     CMPIStatus        mStatus;   // returned request status (via HTTP trailers)               
     struct _TimeoutControl mTimeout; /* Used for timeout control */
@@ -30,6 +31,7 @@ struct _CMCIConnection {
     UtilStringBuffer *mBody;     // The body of the request
     UtilStringBuffer *mUri;      // The uri of the request
     UtilStringBuffer *mUserPass; // The username/password used in authentication
+    UtilStringBuffer *mCimObject; // The CIMObject header of the request
     UtilStringBuffer *mResponse; // Used to store the HTTP response
     CMPIStatus        mStatus;   // returned request status (via HTTP trailers)               
     struct _TimeoutControl mTimeout; /* Used for timeout control */
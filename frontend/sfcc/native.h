@@ -47,6 +47,7 @@ struct native_enum {
 
 	CMPICount current;
 	CMPIArray * data;
+	struct native_arena * arena;	//!< Holds data and its elements, or NULL.
 };
 #else
 struct native_enum {
@@ -56,12 +57,15 @@ struct native_enum {
 	CMPIArray * data;
 	CMCIConnection * econ;
 	CMPIObjectPath * ecop;
+	struct native_arena * arena;	//!< Holds data and its elements, or NULL.
 };
 #endif
 
 //! Forward declaration for anonymous struct.
 struct native_property;
 struct native_qualifier;
+struct native_layout;
+struct native_arena;
 
 struct native_constClass {
 	CMPIConstClass ccls;
@@ -70,6 +74,8 @@ struct native_constClass {
 
 	struct native_property * props;
         struct native_qualifier *qualifiers;
+
+	int * refCount;			//!< Clones sharing this payload, or NULL.
 };
 
 struct native_instance {
@@ -84,6 +90,37 @@ struct native_instance {
 
 	struct native_property * props;
         struct native_qualifier *qualifiers;
+
+	struct native_layout * layout;	//!< Shared class layout, or NULL.
+	CMPIValue * values;		//!< One value per layout slot.
+	unsigned char * bits;		//!< Present, null and qualified bits per slot.
+	unsigned int hint;		//!< Next slot expected to be set.
+
+	int * refCount;			//!< Clones sharing this payload, or NULL.
+};
+
+//! Description of one property slot within a native_layout.
+struct native_slot {
+	char * name;			//!< Property identifier, kept by nameString.
+	CMPIString * nameString;	//!< Handed out as clones by getPropertyAt().
+	CMPIType type;			//!< Associated CMPIType.
+	CMPIValueState state;		//!< CMPI_keyValue for key properties.
+	struct native_qualifier *qualifiers;	//!< Property qualifiers.
+};
+
+//! Immutable per-class property layout shared by flat instances.
+/*!
+  Instances built from a layout keep their values in a contiguous array
+  indexed by slot, with bits per slot telling whether the property is
+  present, whether it is null and whether it has the layout's qualifiers.
+  Names, types, key flags and property qualifiers are kept once in the
+  layout. Properties that do not fit the layout, or whose qualifiers
+  differ from it, are kept in the instance's own props list.
+*/
+struct native_layout {
+	int refCount;			//!< Number of users of this layout.
+	unsigned int count;		//!< Number of slots.
+	struct native_slot * slots;	//!< Slot descriptions.
 };
 
 struct native_property {
@@ -194,24 +231,45 @@ struct native_qualifierFT
 	//! Yields the number of native_qualifier items in a list.
 	CMPICount (* getQualifierCount) ( struct native_qualifier *,
 					 CMPIStatus * );
+
+	//! Tells whether two lists hold equal qualifiers in the same order.
+	int (* sameQualifiers) ( struct native_qualifier *,
+				 struct native_qualifier * );
 };
 
 extern int addInstQualifier( CMPIInstance* ci, char * name,
 				      CMPIValue * value,
 				      CMPIType type);
+extern int setInstPropertyQualifiers( CMPIInstance* ci, char * pname,
+				       struct native_qualifier * q );
 
 
 /****************************************************************************/
 
 void native_release_CMPIValue ( CMPIType, CMPIValue * val );
 CMPIValue native_clone_CMPIValue ( CMPIType, CMPIValue * val, CMPIStatus * );
+int native_same_CMPIValue ( CMPIType, CMPIValue *, CMPIValue * );
+int * native_share_payload ( int ** );
+int native_release_payload ( int ** );
+int native_payload_shared ( int ** );
 CMPIString * native_new_CMPIString ( const char *, CMPIStatus * );
+CMPIString * native_new_CMPIString_borrowed ( const char *, CMPIStatus * );
 CMPIArray * native_new_CMPIArray ( CMPICount size,
 				   CMPIType type,
 				   CMPIStatus * );
 void native_array_increase_size ( CMPIArray *, CMPICount );
+const void * native_array_packed ( const CMPIArray *, CMPICount *,
+				   const unsigned char ** );
 CMPIEnumeration * native_new_CMPIEnumeration ( CMPIArray *, CMPIStatus * );
+CMPIEnumeration * native_new_CMPIEnumeration_fromArena ( CMPIArray *,
+							 struct native_arena *,
+							 CMPIStatus * );
 CMPIInstance * native_new_CMPIInstance ( CMPIObjectPath *, CMPIStatus * );
+CMPIInstance * native_new_CMPIInstance_fromLayout ( CMPIObjectPath *,
+						    struct native_layout *,
+						    CMPIStatus * );
+struct native_layout * native_new_layout ( CMPIInstance *, CMPIStatus * );
+void native_release_layout ( struct native_layout * );
 CMPIObjectPath * native_new_CMPIObjectPath ( const char *,
 					     const char *,
 					     CMPIStatus * );
@@ -223,10 +281,27 @@ CMPIDateTime * native_new_CMPIDateTime_fromBinary ( CMPIUint64,
 CMPIDateTime * native_new_CMPIDateTime_fromChars ( const char *,
 						   CMPIStatus * );
 
+struct native_arena * native_new_arena ( void );
+void native_release_arena ( struct native_arena * );
+struct native_arena * native_use_arena ( struct native_arena * );
+struct native_arena * native_enter_arena ( const void * );
+void native_leave_arena ( struct native_arena * );
+int native_in_arena ( const void * );
+int native_arena_local ( const void * );
+int native_arena_adopt ( const void *, void * );
+void * native_malloc ( size_t );
+void * native_calloc ( size_t, size_t );
+void * native_realloc ( void *, size_t );
+char * native_strdup ( const char * );
+void native_free ( void * );
+void * native_new_node ( size_t );
+void native_release_node ( void *, size_t );
+
 struct xtokValueReference;
 CMPIValue str2CMPIValue(CMPIType type, char *val, struct xtokValueReference *ref);
 void setInstNsAndCn(CMPIInstance *ci, const char *ns, char *cn);
 CMPIStatus simpleArrayAdd(CMPIArray * array, CMPIValue * val, CMPIType type);
+CMPIData simpleArrayTake(CMPIArray * array, CMPICount index);
 const char *getNameSpaceChars(CMPIObjectPath * cop);
 CMPIValue *getKeyValueTypePtr(char *type, char *value, struct xtokValueReference *ref,
                               CMPIValue * val, CMPIType * typ);
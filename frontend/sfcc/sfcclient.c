@@ -130,6 +130,20 @@ CMPIObjectPath *newCMPIObjectPath( const char * namespace,
 		  (CIMCStatus*)rc);
 }
 
+CMPIUint64 hashCMPIObjectPath( const CMPIObjectPath *cop )
+{
+  return ConnectionControl.ccEnv->ft->
+    hashObjectPath(ConnectionControl.ccEnv,(const CIMCObjectPath *)cop);
+}
+
+int sameCMPIObjectPath( const CMPIObjectPath *cop1,
+			const CMPIObjectPath *cop2 )
+{
+  return ConnectionControl.ccEnv->ft->
+    sameObjectPath(ConnectionControl.ccEnv,(const CIMCObjectPath *)cop1,
+		   (const CIMCObjectPath *)cop2);
+}
+
 CMPIInstance *native_new_CMPIInstance( CMPIObjectPath *op,
 					CMPIStatus * rc )
 {